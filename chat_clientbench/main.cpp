@@ -0,0 +1,291 @@
+// this is a headless benchmark of the chat client's receive path
+// a fake server on loopback answers the client's HELLO and then sends a burst of chat lines as fast as the socket
+// takes them, the client parses them on its receive thread and this thread pumps them into the chat state like a UI
+// --audio picks what happens for every incoming message from someone else:
+//   off     no notification at all
+//   inline  the sound is "played" right on the receive thread under a lock, as the Windows client used to do
+//   worker  the receive thread only posts a sound id to a NotificationWorker which plays it on its own thread
+// --policy on puts a NotificationPolicy in front of either, so a storm plays one sound per conversation and window
+// --sink picks the INotificationAudio the sounds are played on:
+//   spin     (default) playing a sound is simulated by holding a lock and spinning for --play-us microseconds, about
+//            what handing a buffer to an XAudio2 source voice costs the calling thread
+//   null     plays nothing and only counts
+//   capture  mixes the sounds from --sounds into the WAV file --capture at the time they were played
+// the results are printed as JSON on stdout
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "chat_audio.h"
+#include "chat_client.h"
+#include "chat_notify.h"
+
+namespace {
+
+struct Options {
+    int lines = 50000;
+    double dmRatio = 0.1;  // share of the lines that are DMs to us
+    std::string audio = "worker";
+    int playUs = 100;
+    bool policy = false;
+    std::string sink = "spin";
+    std::string sounds = "../example_win32_directx11";
+    std::string capture = "capture.wav";
+};
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::atomic<uint64_t> g_sessionSentNs{ 0 }; // the clock starts when the server starts the session, the burst follows it
+
+// the sink for --sink spin
+class SpinNotificationAudio : public INotificationAudio {
+public:
+    explicit SpinNotificationAudio(int playUs) : m_playUs(playUs) {}
+
+    bool Load(NotificationSound, const std::string&) override { return true; }
+    void Play(NotificationSound) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t until = NowNs() + (uint64_t)m_playUs * 1000;
+        while (NowNs() < until) {
+        }
+    }
+
+private:
+    int m_playUs;
+    std::mutex m_mutex;
+};
+
+// counts what reaches the sink whichever it is
+class CountingNotificationAudio : public INotificationAudio {
+public:
+    explicit CountingNotificationAudio(INotificationAudio& sink) : m_sink(sink) {}
+
+    bool Load(NotificationSound sound, const std::string& path) override { return m_sink.Load(sound, path); }
+    void Play(NotificationSound sound) override {
+        m_sink.Play(sound);
+        m_played.fetch_add(1, std::memory_order_relaxed);
+    }
+    void ThreadStart() override { m_sink.ThreadStart(); }
+    void ThreadStop() override { m_sink.ThreadStop(); }
+
+    uint64_t Played() const { return m_played.load(std::memory_order_relaxed); }
+
+private:
+    INotificationAudio& m_sink;
+    std::atomic<uint64_t> m_played{ 0 };
+};
+
+// the burst the fake server sends after the SESSION line, built up front so the server is never the bottleneck
+std::string BuildBurst(const Options& opt) {
+    std::string burst;
+    uint32_t seed = 12345;
+    for (int i = 0; i < opt.lines; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        std::string sender = "user" + std::to_string(i % 100);
+        if ((double)(seed >> 8) / (double)(1u << 24) < opt.dmRatio) {
+            burst += "DM|" + sender + "|are you there " + std::to_string(i) + "\n";
+        }
+        else {
+            burst += sender + ": the quick brown fox jumps over the lazy dog " + std::to_string(i) + "\n";
+        }
+    }
+    return burst;
+}
+
+// accepts one client, reads its HELLO and username lines, starts the session and sends the burst
+// it keeps the connection open until the client disconnects, a closed socket would make the client reconnect
+void FakeServer(int listener, const std::string& burst) {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+    int newlines = 0;
+    char c;
+    while (newlines < 2 && recv(fd, &c, 1, 0) == 1) {
+        newlines += c == '\n';
+    }
+    std::string session = "SESSION|bench|1|0\n";
+    g_sessionSentNs.store(NowNs());
+    send(fd, session.data(), session.size(), MSG_NOSIGNAL);
+    size_t sent = 0;
+    while (sent < burst.size()) {
+        ssize_t n = send(fd, burst.data() + sent, burst.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += (size_t)n;
+    }
+    char drain[256];
+    while (recv(fd, drain, sizeof(drain), 0) > 0) {
+    }
+    close(fd);
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--lines n] [--dm-ratio 0..1] [--audio off|inline|worker] [--play-us n] [--policy on|off]\n"
+                    "          [--sink spin|null|capture] [--sounds dir] [--capture file.wav]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--lines") opt.lines = atoi(value);
+        else if (arg == "--dm-ratio") opt.dmRatio = atof(value);
+        else if (arg == "--audio") opt.audio = value;
+        else if (arg == "--play-us") opt.playUs = atoi(value);
+        else if (arg == "--policy") opt.policy = std::string_view(value) == "on";
+        else if (arg == "--sink") opt.sink = value;
+        else if (arg == "--sounds") opt.sounds = value;
+        else if (arg == "--capture") opt.capture = value;
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.lines < 1 || (opt.audio != "off" && opt.audio != "inline" && opt.audio != "worker") ||
+        (opt.sink != "spin" && opt.sink != "null" && opt.sink != "capture")) {
+        Usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1) != 0 || getsockname(listener, (sockaddr*)&address, &length) != 0) {
+        fprintf(stderr, "cannot listen on loopback\n");
+        return 1;
+    }
+    std::string burst = BuildBurst(opt);
+    std::thread server(FakeServer, listener, std::cref(burst));
+
+    NotificationWorker worker;
+    ChatClient client;
+    // the receive thread stamps every line it hands to the UI, the last one stops the clock
+    std::atomic<uint64_t> lastReceivedNs{ 0 };
+    client.onUpdate = [&lastReceivedNs] { lastReceivedNs.store(NowNs(), std::memory_order_relaxed); };
+    SpinNotificationAudio spin(opt.playUs);
+    NullNotificationAudio null;
+    WavCaptureNotificationAudio capture(opt.capture);
+    INotificationAudio* sink = &spin;
+    if (opt.sink == "null") {
+        sink = &null;
+    }
+    else if (opt.sink == "capture") {
+        sink = &capture;
+    }
+    CountingNotificationAudio audio(*sink);
+    for (NotificationSound sound : { NotificationSound::Message, NotificationSound::DirectMessage, NotificationSound::Send }) {
+        std::string path = opt.sounds + "/" + NotificationSoundFile(sound);
+        if (!audio.Load(sound, path)) {
+            fprintf(stderr, "cannot load %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    bool usePolicy = opt.policy;
+    NotificationPolicy policy;
+    auto allow = [usePolicy, &policy](NotificationSound sound, std::string_view peer) {
+        return !usePolicy || policy.Allow(sound, peer, NotificationPolicy::Clock::now());
+    };
+    auto soundFor = [](ChatNotification notification) {
+        return notification == ChatNotification::DirectMessage ? NotificationSound::DirectMessage : NotificationSound::Message;
+    };
+    if (opt.audio == "inline") {
+        client.onNotification = [&audio, allow, soundFor](ChatNotification notification, std::string_view peer) {
+            if (allow(soundFor(notification), peer)) {
+                audio.Play(soundFor(notification));
+            }
+        };
+    }
+    else if (opt.audio == "worker") {
+        worker.Start(audio);
+        client.onNotification = [&worker, allow, soundFor](ChatNotification notification, std::string_view peer) {
+            if (allow(soundFor(notification), peer)) {
+                worker.Post(soundFor(notification));
+            }
+        };
+    }
+
+    uint64_t start = NowNs();
+    if (!client.Connect("127.0.0.1", ntohs(address.sin_port), "bench")) {
+        fprintf(stderr, "connect failed: %s\n", client.LastError().c_str());
+        return 1;
+    }
+    uint64_t connected = NowNs();
+    // we pump like a UI would until every line of the burst is in the chat state, the receive thread may
+    // well be through part of it before Connect() returns
+    auto inHistory = [&client] {
+        uint64_t count = client.state.globalChat.TotalCount();
+        for (const auto& dm : client.state.dmHistory) {
+            count += dm.second.TotalCount();
+        }
+        return count;
+    };
+    uint64_t deadline = connected + 120ull * 1000000000ull;
+    while (inHistory() < (uint64_t)opt.lines && NowNs() < deadline) {
+        if (client.PumpEvents() == 0) {
+            std::this_thread::yield();
+        }
+    }
+    uint64_t lines = inHistory();
+    double seconds = (double)(lastReceivedNs.load() - g_sessionSentNs.load()) / 1e9;
+
+    client.Disconnect();
+    // Stop() drops what is still queued, we give the worker a moment to play it first so a capture has every sound
+    uint64_t drainDeadline = NowNs() + 5ull * 1000000000ull;
+    while (true) {
+        NotificationWorker::Stats queued = worker.GetStats();
+        if (queued.played + queued.dropped >= queued.posted || NowNs() >= drainDeadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    worker.Stop();
+    server.join();
+    close(listener);
+
+    NotificationWorker::Stats stats = worker.GetStats();
+    printf("{\n");
+    printf("  \"audio\": \"%s\",\n  \"play_us\": %d,\n  \"lines\": %d,\n  \"received\": %llu,\n", opt.audio.c_str(), opt.playUs, opt.lines, (unsigned long long)lines);
+    printf("  \"connect_ms\": %.2f,\n  \"receive_seconds\": %.4f,\n  \"lines_per_sec\": %.0f,\n",
+        (double)(connected - start) / 1e6, seconds, seconds > 0 ? (double)lines / seconds : 0.0);
+    NotificationPolicy::Stats limited = policy.GetStats();
+    printf("  \"sink\": \"%s\",\n", opt.sink.c_str());
+    if (opt.sink == "capture") {
+        bool written = capture.Finish();
+        printf("  \"capture\": { \"file\": \"%s\", \"written\": %s, \"clipped_samples\": %llu },\n", opt.capture.c_str(), written ? "true" : "false",
+            (unsigned long long)capture.Clipped());
+    }
+    printf("  \"sounds\": { \"played\": %llu, \"posted\": %llu, \"dropped\": %llu, \"wakeups\": %llu },\n",
+        (unsigned long long)audio.Played(), (unsigned long long)stats.posted, (unsigned long long)stats.dropped, (unsigned long long)stats.wakeups);
+    printf("  \"policy\": { \"on\": %s, \"allowed\": %llu, \"coalesced\": %llu, \"voice_limited\": %llu }\n", opt.policy ? "true" : "false",
+        (unsigned long long)limited.allowed, (unsigned long long)limited.coalesced, (unsigned long long)limited.voiceLimited);
+    printf("}\n");
+    return lines == (uint64_t)opt.lines ? 0 : 1;
+}
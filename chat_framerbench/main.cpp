@@ -0,0 +1,213 @@
+// this is a benchmark of the client's line framing, what it costs to cut a large server burst into lines
+// a burst of --mb megabytes of server traffic (chat lines, DMs, user list deltas and system lines) is built up front
+// and replayed in --chunk byte reads, the size of the client's recv() calls, through:
+//   legacy  the loop ReceiveLoop() used to run: append every read to a std::string, then substr() and erase() per line
+//   framer  LineFramer as ReceiveLoop() uses it now: the read lands in the framer's tail and the lines are views
+// every run is repeated --repeat times and the best one counts, both must find the same lines
+// the framer indexes every read with ScanStructural(), the burst is also scanned in one go by every implementation
+// of it this cpu has (scalar, SSE2, AVX2), which must all find the same delimiters
+// the results are printed as JSON on stdout
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "chat_framer.h"
+#include "chat_scan.h"
+
+namespace {
+
+struct Options {
+    int mb = 10;
+    int chunk = 4096;
+    int repeat = 5;
+};
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// a mix of what a busy server sends, with sequence numbers as a resumable session has them
+std::string BuildBurst(size_t bytes) {
+    std::string burst;
+    burst.reserve(bytes + 256);
+    uint32_t seed = 12345;
+    for (uint64_t seq = 1; burst.size() < bytes; seq++) {
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t pick = (seed >> 8) % 100;
+        std::string sender = "user" + std::to_string((seed >> 16) % 500);
+        std::string line = "#" + std::to_string(seq) + " ";
+        if (pick < 80) {
+            line += sender + ": the quick brown fox jumps over the lazy dog " + std::to_string(seq);
+        }
+        else if (pick < 90) {
+            line += "DM|" + sender + "|are you there, " + std::to_string(seq) + "?";
+        }
+        else if (pick < 97) {
+            line += (pick & 1 ? "USERS+|" : "USERS-|") + sender;
+        }
+        else {
+            line += "SYS|" + sender + " joined the chat";
+        }
+        burst += line;
+        burst += '\n';
+    }
+    return burst;
+}
+
+struct Result {
+    uint64_t lines = 0;
+    uint64_t bytes = 0; // of all lines together, so both sides are checked to find the same text
+    uint64_t ns = 0;
+};
+
+Result RunLegacy(const std::string& burst, size_t chunk) {
+    Result result;
+    uint64_t start = NowNs();
+    std::string accumulatedData = "";
+    for (size_t offset = 0; offset < burst.size(); offset += chunk) {
+        size_t bytes = std::min(chunk, burst.size() - offset);
+        accumulatedData += std::string(burst.data() + offset, bytes);
+        size_t pos;
+        while ((pos = accumulatedData.find('\n')) != std::string::npos) {
+            std::string incomingMsg = accumulatedData.substr(0, pos);
+            accumulatedData.erase(0, pos + 1);
+            result.lines++;
+            result.bytes += incomingMsg.size();
+        }
+    }
+    result.ns = NowNs() - start;
+    return result;
+}
+
+Result RunFramer(const std::string& burst, size_t chunk) {
+    Result result;
+    uint64_t start = NowNs();
+    LineFramer framer;
+    for (size_t offset = 0; offset < burst.size(); offset += chunk) {
+        size_t bytes = std::min(chunk, burst.size() - offset);
+        // the memcpy stands in for recv() writing into the framer's tail
+        memcpy(framer.PrepareWrite(chunk), burst.data() + offset, bytes);
+        framer.CommitWrite(bytes);
+        FramedLine line;
+        while (framer.NextLine(line)) {
+            result.lines++;
+            result.bytes += line.text.size();
+        }
+    }
+    result.ns = NowNs() - start;
+    return result;
+}
+
+template <typename Run>
+Result Best(Run run, const std::string& burst, size_t chunk, int repeat) {
+    Result best;
+    for (int r = 0; r < repeat; r++) {
+        Result result = run(burst, chunk);
+        if (r == 0 || result.ns < best.ns) {
+            best = result;
+        }
+    }
+    return best;
+}
+
+struct ScanResult {
+    const char* name;
+    uint64_t ns = 0;
+    bool identical = true; // to the scalar scanner
+};
+
+std::vector<ScanResult> RunScanners(const std::string& burst, int repeat) {
+    std::vector<ScanResult> results;
+    StructuralIndex scalar;
+    StructuralIndex index;
+    for (const StructuralScanner& scanner : StructuralScanners()) {
+        ScanResult result{ scanner.name };
+        for (int r = 0; r < repeat; r++) {
+            index.Clear();
+            uint64_t start = NowNs();
+            scanner.scan(burst.data(), burst.size(), 0, index);
+            uint64_t ns = NowNs() - start;
+            if (r == 0 || ns < result.ns) {
+                result.ns = ns;
+            }
+        }
+        // the scalar scanner comes first, its index is the reference for the others
+        if (results.empty()) {
+            std::swap(scalar, index);
+        }
+        else {
+            result.identical = index.newlines == scalar.newlines && index.separators == scalar.separators;
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+void PrintResult(const char* name, const Result& result, size_t burstBytes, const char* tail) {
+    double seconds = (double)result.ns / 1e9;
+    printf("  \"%s\": { \"lines\": %llu, \"ms\": %.2f, \"lines_per_sec\": %.0f, \"mb_per_sec\": %.1f }%s\n", name,
+        (unsigned long long)result.lines, seconds * 1e3, (double)result.lines / seconds, (double)burstBytes / 1e6 / seconds, tail);
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--mb n] [--chunk bytes] [--repeat n]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--mb") opt.mb = atoi(value);
+        else if (arg == "--chunk") opt.chunk = atoi(value);
+        else if (arg == "--repeat") opt.repeat = atoi(value);
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.mb < 1 || opt.chunk < 1 || opt.repeat < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    std::string burst = BuildBurst((size_t)opt.mb * 1000 * 1000);
+    Result legacy = Best(RunLegacy, burst, (size_t)opt.chunk, opt.repeat);
+    Result framer = Best(RunFramer, burst, (size_t)opt.chunk, opt.repeat);
+    std::vector<ScanResult> scanners = RunScanners(burst, opt.repeat);
+    bool identical = legacy.lines == framer.lines && legacy.bytes == framer.bytes;
+    for (const ScanResult& scanner : scanners) {
+        identical = identical && scanner.identical;
+    }
+
+    printf("{\n");
+    printf("  \"burst_bytes\": %zu,\n  \"chunk\": %d,\n  \"repeat\": %d,\n", burst.size(), opt.chunk, opt.repeat);
+    PrintResult("legacy", legacy, burst.size(), ",");
+    PrintResult("framer", framer, burst.size(), ",");
+    printf("  \"speedup\": %.2f,\n", (double)legacy.ns / (double)framer.ns);
+    printf("  \"scanner\": \"%s\",\n  \"scanners\": {\n", StructuralScannerName());
+    for (size_t i = 0; i < scanners.size(); i++) {
+        const ScanResult& scanner = scanners[i];
+        double seconds = (double)scanner.ns / 1e9;
+        printf("    \"%s\": { \"ms\": %.2f, \"mb_per_sec\": %.1f, \"speedup\": %.2f, \"identical\": %s }%s\n", scanner.name, seconds * 1e3,
+            (double)burst.size() / 1e6 / seconds, (double)scanners[0].ns / (double)scanner.ns, scanner.identical ? "true" : "false",
+            i + 1 < scanners.size() ? "," : "");
+    }
+    printf("  },\n  \"identical\": %s\n", identical ? "true" : "false");
+    printf("}\n");
+    return identical ? 0 : 1;
+}
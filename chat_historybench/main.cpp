@@ -0,0 +1,693 @@
+// this is a benchmark of how the chat client stores its history, it needs neither ImGui nor a server
+// --mode picks what is measured:
+//   frame  what deciding the colour of the visible lines costs per frame, for the global chat and one DM window
+//          legacy   the history is a vector of "alice: hi" strings, every frame builds username + ":" and
+//                   username + " :" and compares them with the start of every visible global line, a DM line is ours
+//                   when it starts with "Me:", as the Windows client did before messages became records
+//          records  the history is a ChatHistory and DrawChatLines() only tests the flags the client set on arrival
+//          the full frame of the real UI, ImGui included, is measured by example_null
+//   memory what --messages messages cost on the heap, stored as
+//          strings   one std::string per display line, the layout before messages became records
+//          records   fixed size records and one std::string that all of the text is appended to
+//          arena     records and a TextArena, the text in chunks that never move
+//          history   a ChatHistory, the arena plus the ring and the search index the client keeps with it
+//          for each: allocations, bytes live afterwards and at the peak while appending, the largest block, the
+//          time to append and the time to walk every message once
+//   retention  a ChatHistory under the retention limits the Windows client sets for the global chat takes --messages
+//          messages, then pages back to the first one and forward to the tail again as a user scrolling would, every
+//          message that comes back from the spill file is checked against the one that went in
+//   startup    a ChatLog in --log-dir takes --messages messages (every tenth a DM), then the log is opened again and
+//          its newest --reload messages loaded into the histories as ChatClient::OpenLog() does, against loading every
+//          record the log has, the segments are in the page cache by then so this is the warm start of a client
+//          decode_tail is the log alone, load_tail adds what the histories cost
+// every allocation goes through a counting operator new that also tracks the bytes malloc handed out, the results
+// are printed as JSON on stdout
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <malloc.h>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat_history.h"
+#include "chat_log.h"
+
+namespace {
+
+std::atomic<uint64_t> g_newCalls{ 0 };
+// what malloc really handed out, so rounding and the small string buffer show up as they do in the process
+std::atomic<uint64_t> g_liveBytes{ 0 };
+std::atomic<uint64_t> g_peakBytes{ 0 };
+std::atomic<uint64_t> g_largestBlock{ 0 };
+
+}
+
+// out of line, once inlined into the library code GCC takes the free() below for a mismatch with the new that
+// allocated the block
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1)) {
+        uint64_t usable = malloc_usable_size(ptr);
+        uint64_t live = g_liveBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+        if (live > g_peakBytes.load(std::memory_order_relaxed)) {
+            g_peakBytes.store(live, std::memory_order_relaxed);
+        }
+        if (usable > g_largestBlock.load(std::memory_order_relaxed)) {
+            g_largestBlock.store(usable, std::memory_order_relaxed);
+        }
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+    if (ptr) {
+        g_liveBytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    }
+    free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+namespace {
+
+struct Options {
+    std::string mode = "frame";
+    size_t messages = 0;        // global chat lines, 0 is 100000 and 1000000 for --mode retention
+    size_t dmMessages = 1000;   // lines of the open DM window
+    size_t visible = 40;        // lines on screen per window
+    int frames = 100000;
+    std::string username = "alice";
+    size_t maxMessages = 20000;
+    size_t maxBytes = 8 * 1024 * 1024;
+    std::string spillDirectory;
+    std::string logDirectory;   // empty is a scratch directory that is removed afterwards
+    size_t reload = 20000;
+    int runs = 3;
+};
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the same generated conversation for every layout: 500 senders, sentences of 3 to 20 words and every tenth line ours
+const char* const kWords[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliet", "kilo", "lima",
+    "mike", "november", "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey",
+    "xray", "yankee", "zulu", "the", "a", "is", "and", "server", "message", "window", "frame", "later", "now",
+};
+
+struct Line {
+    std::string sender;
+    std::string body;
+    bool mine;
+};
+
+std::vector<Line> MakeLines(size_t count, const std::string& me, uint32_t seed) {
+    std::vector<Line> lines;
+    lines.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        Line line;
+        line.mine = i % 10 == 9;
+        line.sender = line.mine ? me : "user" + std::to_string((seed >> 8) % 500);
+        int words = 3 + (int)((seed >> 16) % 18);
+        for (int w = 0; w < words; w++) {
+            seed = seed * 1664525u + 1013904223u;
+            if (w) {
+                line.body += ' ';
+            }
+            line.body += kWords[(seed >> 8) % (sizeof(kWords) / sizeof(kWords[0]))];
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+// our own DM lines read "Me: ...", as ChatClient writes them
+void FillHistory(ChatHistory& history, NameTable& names, const std::vector<Line>& lines, MessageKind kind) {
+    for (const Line& line : lines) {
+        ChatMessage message;
+        message.sender = names.Intern(line.sender);
+        message.kind = kind;
+        message.flags = line.mine ? MessageFromMe : 0;
+        history.Append(message, (line.mine && kind == MessageKind::Direct ? std::string("Me") : line.sender) + ": ", line.body);
+    }
+}
+
+struct FrameResult {
+    double usPerFrame = 0;
+    double allocationsPerFrame = 0;
+    uint64_t highlighted = 0; // lines drawn in our colour, both layouts have to agree
+};
+
+// the first visible line, the view scrolls up a line per frame and jumps back to the bottom every 64 frames
+size_t FirstVisible(size_t size, size_t visible, int frame) {
+    size_t first = size - std::min(visible, size);
+    return first - std::min(first, (size_t)(frame % 64));
+}
+
+// the legacy render loop minus the drawing, isMine decides the colour of one line
+template <typename IsMine>
+size_t LegacyWindow(const std::vector<std::string>& history, size_t visible, int frame, IsMine isMine) {
+    size_t highlighted = 0;
+    size_t first = FirstVisible(history.size(), visible, frame);
+    for (size_t i = first; i < first + std::min(visible, history.size()); i++) {
+        if (isMine(history[i])) {
+            highlighted++;
+        }
+    }
+    return highlighted;
+}
+
+size_t RecordsWindow(const ChatHistory& history, uint8_t highlightFlags, size_t visible, int frame) {
+    size_t highlighted = 0;
+    size_t first = FirstVisible(history.size(), visible, frame);
+    for (size_t i = first; i < first + std::min(visible, history.size()); i++) {
+        if (history[i].flags & highlightFlags) {
+            highlighted++;
+        }
+    }
+    return highlighted;
+}
+
+template <typename Frame>
+FrameResult MeasureFrames(const Options& opt, Frame frame) {
+    FrameResult result;
+    uint64_t callsBefore = g_newCalls.load(std::memory_order_relaxed);
+    uint64_t start = NowNs();
+    for (int i = 0; i < opt.frames; i++) {
+        result.highlighted += frame(i);
+    }
+    result.usPerFrame = (double)(NowNs() - start) / 1e3 / opt.frames;
+    result.allocationsPerFrame = (double)(g_newCalls.load(std::memory_order_relaxed) - callsBefore) / opt.frames;
+    return result;
+}
+
+int RunFrame(const Options& opt) {
+    std::vector<Line> global = MakeLines(opt.messages, opt.username, 12345);
+    std::vector<Line> dm = MakeLines(opt.dmMessages, opt.username, 777);
+
+    std::vector<std::string> legacyGlobal;
+    std::vector<std::string> legacyDm;
+    for (const Line& line : global) {
+        legacyGlobal.push_back(line.sender + ": " + line.body);
+    }
+    for (const Line& line : dm) {
+        legacyDm.push_back((line.mine ? std::string("Me") : line.sender) + ": " + line.body);
+    }
+    NameTable names;
+    ChatHistory recordsGlobal;
+    ChatHistory recordsDm;
+    FillHistory(recordsGlobal, names, global, MessageKind::Chat);
+    FillHistory(recordsDm, names, dm, MessageKind::Direct);
+
+    FrameResult legacy = MeasureFrames(opt, [&](int frame) {
+        std::string myPrefix = opt.username + ":";
+        std::string myPrefixSpaced = opt.username + " :";
+        return LegacyWindow(legacyGlobal, opt.visible, frame, [&](const std::string& msg) {
+            return msg.compare(0, myPrefix.size(), myPrefix) == 0 || msg.compare(0, myPrefixSpaced.size(), myPrefixSpaced) == 0;
+        }) + LegacyWindow(legacyDm, opt.visible, frame, [](const std::string& msg) { return msg.rfind("Me:", 0) == 0; });
+    });
+    FrameResult records = MeasureFrames(opt, [&](int frame) {
+        return RecordsWindow(recordsGlobal, MessageFromMe, opt.visible, frame) + RecordsWindow(recordsDm, MessageFromMe, opt.visible, frame);
+    });
+
+    printf("{\n");
+    printf("  \"mode\": \"frame\",\n  \"username\": \"%s\",\n  \"messages\": %zu,\n  \"dm_messages\": %zu,\n  \"visible\": %zu,\n  \"frames\": %d,\n",
+        opt.username.c_str(), opt.messages, opt.dmMessages, opt.visible, opt.frames);
+    printf("  \"legacy\": { \"us_per_frame\": %.3f, \"allocations_per_frame\": %.2f },\n", legacy.usPerFrame, legacy.allocationsPerFrame);
+    printf("  \"records\": { \"us_per_frame\": %.3f, \"allocations_per_frame\": %.2f },\n", records.usPerFrame, records.allocationsPerFrame);
+    printf("  \"same_lines_highlighted\": %s\n}\n", legacy.highlighted == records.highlighted ? "true" : "false");
+    return legacy.highlighted == records.highlighted ? 0 : 1;
+}
+
+// the layout records replaced text with at first: a record per message with the offset of its line in one string
+// that grows, we keep it here to compare the arena with
+struct OneStringHistory {
+    struct Record {
+        int64_t timestamp;
+        uint32_t sender;
+        uint32_t offset;
+        uint32_t length;
+        uint16_t bodyOffset;
+        MessageKind kind;
+        uint8_t flags;
+    };
+    std::vector<Record> records;
+    std::string text;
+
+    void Append(const ChatMessage& message, std::string_view prefix, std::string_view body) {
+        records.push_back({ message.timestamp, message.sender, (uint32_t)text.size(), (uint32_t)(prefix.size() + body.size()),
+            (uint16_t)prefix.size(), message.kind, message.flags });
+        text.append(prefix);
+        text.append(body);
+    }
+    std::string_view Text(size_t index) const { return std::string_view(text).substr(records[index].offset, records[index].length); }
+};
+
+// records and a TextArena without anything else ChatHistory keeps
+struct ArenaHistory {
+    std::vector<ChatMessage> records;
+    TextArena text;
+
+    void Append(ChatMessage message, std::string_view prefix, std::string_view body) {
+        std::string_view line = text.Store(prefix, body);
+        message.text = line.data();
+        message.textLength = (uint32_t)line.size();
+        message.bodyOffset = (uint16_t)prefix.size();
+        records.push_back(message);
+    }
+};
+
+struct MemoryResult {
+    uint64_t allocations = 0;
+    uint64_t liveBytes = 0;
+    uint64_t peakBytes = 0;
+    uint64_t largestBlock = 0;
+    double appendMs = 0;
+    double walkUs = 0;
+};
+
+// append(line) stores one message, walk() reads a byte from the middle of every message and returns their sum
+template <typename Append, typename Walk>
+MemoryResult MeasureLayout(const std::vector<Line>& lines, Append append, Walk walk) {
+    MemoryResult result;
+    uint64_t base = g_liveBytes.load();
+    uint64_t calls = g_newCalls.load();
+    g_peakBytes.store(base);
+    g_largestBlock.store(0);
+    uint64_t start = NowNs();
+    for (const Line& line : lines) {
+        append(line);
+    }
+    result.appendMs = (double)(NowNs() - start) / 1e6;
+    result.allocations = g_newCalls.load() - calls;
+    result.liveBytes = g_liveBytes.load() - base;
+    result.peakBytes = g_peakBytes.load() - base;
+    result.largestBlock = g_largestBlock.load();
+    const int walks = 10;
+    uint64_t sum = 0;
+    start = NowNs();
+    for (int i = 0; i < walks; i++) {
+        sum += walk();
+    }
+    result.walkUs = (double)(NowNs() - start) / 1e3 / walks;
+    // the sum only keeps the compiler from dropping the walk
+    if (sum == 1) {
+        printf("\n");
+    }
+    return result;
+}
+
+void PrintLayout(const char* name, const MemoryResult& result, size_t messages, bool last) {
+    printf("    \"%s\": { \"allocations\": %llu, \"live_mib\": %.2f, \"peak_mib\": %.2f, \"bytes_per_message\": %.1f, "
+           "\"largest_block_kib\": %.1f, \"append_ms\": %.1f, \"walk_us\": %.0f }%s\n",
+        name, (unsigned long long)result.allocations, (double)result.liveBytes / 1048576.0, (double)result.peakBytes / 1048576.0,
+        (double)result.liveBytes / (double)messages, (double)result.largestBlock / 1024.0, result.appendMs, result.walkUs, last ? "" : ",");
+}
+
+int RunMemory(const Options& opt) {
+    std::vector<Line> lines = MakeLines(opt.messages, opt.username, 12345);
+    size_t textBytes = 0;
+    for (const Line& line : lines) {
+        textBytes += line.sender.size() + 2 + line.body.size();
+    }
+    // the prefixes are built up front, so appending measures only the storage
+    std::vector<std::string> prefixes;
+    prefixes.reserve(lines.size());
+    for (const Line& line : lines) {
+        prefixes.push_back(line.sender + ": ");
+    }
+    NameTable names;
+    std::vector<ChatMessage> messages(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        messages[i].timestamp = 1700000000000 + (int64_t)i * 1000;
+        messages[i].sender = names.Intern(lines[i].sender);
+        messages[i].flags = lines[i].mine ? MessageFromMe : 0;
+    }
+
+    size_t next = 0;
+    auto middle = [](std::string_view text) -> uint64_t { return text.empty() ? 0 : (uint8_t)text[text.size() / 2]; };
+
+    std::vector<std::string>* strings = new std::vector<std::string>();
+    next = 0;
+    MemoryResult stringsResult = MeasureLayout(lines, [&](const Line& line) {
+        strings->push_back(prefixes[next++] + line.body);
+    }, [&] {
+        uint64_t sum = 0;
+        for (const std::string& text : *strings) {
+            sum += middle(text);
+        }
+        return sum;
+    });
+    delete strings;
+
+    OneStringHistory* records = new OneStringHistory();
+    next = 0;
+    MemoryResult recordsResult = MeasureLayout(lines, [&](const Line& line) {
+        records->Append(messages[next], prefixes[next], line.body);
+        next++;
+    }, [&] {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < records->records.size(); i++) {
+            sum += middle(records->Text(i));
+        }
+        return sum;
+    });
+    delete records;
+
+    ArenaHistory* arena = new ArenaHistory();
+    next = 0;
+    MemoryResult arenaResult = MeasureLayout(lines, [&](const Line& line) {
+        arena->Append(messages[next], prefixes[next], line.body);
+        next++;
+    }, [&] {
+        uint64_t sum = 0;
+        for (const ChatMessage& message : arena->records) {
+            sum += middle(message.Text());
+        }
+        return sum;
+    });
+    TextArena::Stats arenaStats = arena->text.GetStats();
+    delete arena;
+
+    ChatHistory* history = new ChatHistory();
+    next = 0;
+    MemoryResult historyResult = MeasureLayout(lines, [&](const Line& line) {
+        history->Append(messages[next], prefixes[next], line.body);
+        next++;
+    }, [&] {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < history->size(); i++) {
+            sum += middle((*history)[i].Text());
+        }
+        return sum;
+    });
+    SearchIndex::Stats searchStats = history->SearchStats();
+    delete history;
+
+    printf("{\n");
+    printf("  \"mode\": \"memory\",\n  \"messages\": %zu,\n  \"text_mib\": %.2f,\n  \"average_line_bytes\": %.1f,\n",
+        opt.messages, (double)textBytes / 1048576.0, (double)textBytes / (double)opt.messages);
+    printf("  \"layouts\": {\n");
+    PrintLayout("strings", stringsResult, opt.messages, false);
+    PrintLayout("records", recordsResult, opt.messages, false);
+    PrintLayout("arena", arenaResult, opt.messages, false);
+    PrintLayout("history", historyResult, opt.messages, true);
+    printf("  },\n");
+    printf("  \"arena\": { \"chunks\": %zu, \"reserved_mib\": %.2f, \"used_mib\": %.2f, \"slack_percent\": %.1f },\n", arenaStats.chunks,
+        (double)arenaStats.bytesReserved / 1048576.0, (double)arenaStats.bytesUsed / 1048576.0,
+        arenaStats.bytesReserved ? 100.0 * (double)(arenaStats.bytesReserved - arenaStats.bytesUsed) / (double)arenaStats.bytesReserved : 0.0);
+    printf("  \"search\": { \"words\": %zu, \"postings\": %zu, \"posting_mib\": %.2f }\n}\n", searchStats.words, searchStats.postings,
+        (double)searchStats.postingBytes / 1048576.0);
+    return 0;
+}
+
+// message index of the retention run, made up again from the index when it is checked so the run never holds more
+// than the history does, the timestamp is the index so a message that comes back in the wrong place is caught too
+void RetentionLine(uint64_t index, std::string& prefix, std::string& body) {
+    uint32_t seed = (uint32_t)(index * 2654435761u) ^ 12345u;
+    prefix = "user" + std::to_string(index % 500) + ": ";
+    body.clear();
+    int words = 3 + (int)(index % 18);
+    for (int w = 0; w < words; w++) {
+        seed = seed * 1664525u + 1013904223u;
+        if (w) {
+            body += ' ';
+        }
+        body += kWords[(seed >> 8) % (sizeof(kWords) / sizeof(kWords[0]))];
+    }
+}
+
+// checks the window messages [from, to) of history
+uint64_t WrongMessages(const ChatHistory& history, uint64_t from, uint64_t to) {
+    uint64_t wrong = 0;
+    std::string prefix;
+    std::string body;
+    for (uint64_t index = from; index < to; index++) {
+        const ChatMessage& message = history[(size_t)(index - history.FirstIndex())];
+        RetentionLine(index, prefix, body);
+        wrong += message.timestamp != (int64_t)index || message.Body() != body || message.Text().substr(0, prefix.size()) != prefix;
+    }
+    return wrong;
+}
+
+struct PageResult {
+    int pages = 0;
+    double averageMs = 0;
+    double worstMs = 0;
+};
+
+int RunRetention(const Options& opt) {
+    HistoryRetention retention;
+    retention.maxMessages = opt.maxMessages;
+    retention.maxBytes = opt.maxBytes;
+    retention.spillDirectory = opt.spillDirectory;
+    uint64_t base = g_liveBytes.load();
+
+    ChatHistory* history = new ChatHistory();
+    history->SetRetention(retention);
+    g_peakBytes.store(g_liveBytes.load());
+    std::string prefix;
+    std::string body;
+    uint64_t appendNs = 0;
+    for (uint64_t index = 0; index < opt.messages; index++) {
+        RetentionLine(index, prefix, body);
+        ChatMessage message;
+        message.timestamp = (int64_t)index;
+        message.sender = (uint32_t)(index % 500) + 1;
+        uint64_t start = NowNs();
+        history->Append(message, prefix, body);
+        appendNs += NowNs() - start;
+    }
+    size_t window = history->size();
+    size_t accounted = history->ResidentBytes();
+    uint64_t liveBytes = g_liveBytes.load() - base;
+    uint64_t peakBytes = g_peakBytes.load() - base;
+    uint64_t wrong = WrongMessages(*history, history->FirstIndex(), history->FirstIndex() + history->size());
+
+    // only the paging is timed, the check of what came in is not
+    auto page = [&](bool older) {
+        PageResult result;
+        double totalMs = 0;
+        while (older ? history->HasOlder() : !history->AtTail()) {
+            uint64_t first = history->FirstIndex();
+            uint64_t end = first + history->size();
+            uint64_t start = NowNs();
+            bool moved = older ? history->PageOlder() : history->PageNewer();
+            double ms = (double)(NowNs() - start) / 1e6;
+            if (!moved) {
+                wrong++;
+                break;
+            }
+            totalMs += ms;
+            result.worstMs = std::max(result.worstMs, ms);
+            result.pages++;
+            uint64_t newFirst = history->FirstIndex();
+            uint64_t newEnd = newFirst + history->size();
+            if (older) {
+                wrong += WrongMessages(*history, newFirst, std::min(first, newEnd));
+            }
+            else {
+                wrong += WrongMessages(*history, std::max(end, newFirst), newEnd);
+            }
+        }
+        result.averageMs = result.pages ? totalMs / result.pages : 0.0;
+        return result;
+    };
+    PageResult back = page(true);
+    bool reachedStart = history->FirstIndex() == 0;
+    PageResult forward = page(false);
+    bool reachedTail = history->FirstIndex() + history->size() == opt.messages;
+    uint64_t peakWhilePaging = g_peakBytes.load() - base;
+    SearchIndex::Stats search = history->SearchStats();
+    delete history;
+    uint64_t leftBytes = g_liveBytes.load() - base;
+
+    bool ok = wrong == 0 && reachedStart && reachedTail && (opt.messages <= opt.maxMessages || back.pages > 0);
+    printf("{\n");
+    printf("  \"mode\": \"retention\",\n  \"messages\": %zu,\n  \"max_messages\": %zu,\n  \"max_bytes\": %zu,\n", opt.messages, opt.maxMessages, opt.maxBytes);
+    printf("  \"append_ns\": %.0f,\n", (double)appendNs / (double)opt.messages);
+    printf("  \"window\": { \"messages\": %zu, \"accounted_mib\": %.2f, \"heap_mib\": %.2f, \"heap_peak_mib\": %.2f, \"heap_peak_paging_mib\": %.2f },\n",
+        window, (double)accounted / 1048576.0, (double)liveBytes / 1048576.0, (double)peakBytes / 1048576.0, (double)peakWhilePaging / 1048576.0);
+    // the index covers the spilled messages too, so unlike the window it grows with the conversation
+    printf("  \"search\": { \"words\": %zu, \"postings\": %zu, \"posting_mib\": %.2f },\n", search.words, search.postings,
+        (double)search.postingBytes / 1048576.0);
+    printf("  \"page_back\": { \"pages\": %d, \"average_ms\": %.2f, \"worst_ms\": %.2f, \"reached_start\": %s },\n", back.pages, back.averageMs,
+        back.worstMs, reachedStart ? "true" : "false");
+    printf("  \"page_forward\": { \"pages\": %d, \"average_ms\": %.2f, \"worst_ms\": %.2f, \"reached_tail\": %s },\n", forward.pages,
+        forward.averageMs, forward.worstMs, reachedTail ? "true" : "false");
+    printf("  \"wrong_messages\": %llu,\n  \"heap_left_bytes\": %llu\n}\n", (unsigned long long)wrong, (unsigned long long)leftBytes);
+    return ok ? 0 : 1;
+}
+
+// what one reload of the log took and whether the newest message came back last
+struct LoadResult {
+    double bestMs = 0;
+    double worstMs = 0;
+    size_t loaded = 0;
+    bool newestLast = false;
+};
+
+// opens the log and loads its newest count records into a global chat and DM histories under the Windows client's
+// limits, the way ChatClient::OpenLog() does, without intoHistories it only decodes them
+LoadResult LoadLog(const Options& opt, size_t count, int64_t newest, bool intoHistories) {
+    LoadResult result;
+    for (int run = 0; run < opt.runs; run++) {
+        uint64_t start = NowNs();
+        ChatLog log;
+        NameTable names;
+        ChatHistory global;
+        ChatHistory dm;
+        HistoryRetention retention;
+        retention.maxMessages = 20000;
+        retention.maxBytes = 8 * 1024 * 1024;
+        global.SetRetention(retention);
+        dm.SetRetention(retention);
+        int64_t last = -1;
+        bool opened = log.Open(opt.logDirectory);
+        size_t loaded = log.LoadTail(count, [&](const LoggedMessage& logged) {
+            last = logged.message.timestamp;
+            if (!intoHistories) {
+                return;
+            }
+            ChatMessage message = logged.message;
+            message.sender = names.Intern(logged.sender);
+            std::string_view text = message.Text();
+            size_t bodyOffset = std::min<size_t>(message.bodyOffset, text.size());
+            (logged.conversation.empty() ? global : dm).Append(message, text.substr(0, bodyOffset), text.substr(bodyOffset));
+        });
+        double ms = (double)(NowNs() - start) / 1e6;
+        log.Close();
+        result.bestMs = run == 0 ? ms : std::min(result.bestMs, ms);
+        result.worstMs = std::max(result.worstMs, ms);
+        result.loaded = loaded;
+        result.newestLast = opened && last == newest;
+    }
+    return result;
+}
+
+int RunStartup(Options opt) {
+    bool scratch = opt.logDirectory.empty();
+    if (scratch) {
+        opt.logDirectory = (std::filesystem::temp_directory_path() / ("chat_historybench_log_" + std::to_string(NowNs()))).string();
+    }
+    std::error_code error;
+    std::filesystem::remove_all(opt.logDirectory, error);
+
+    ChatLog log;
+    if (!log.Open(opt.logDirectory)) {
+        fprintf(stderr, "cannot open the log in %s\n", opt.logDirectory.c_str());
+        return 1;
+    }
+    std::string prefix;
+    std::string body;
+    uint64_t start = NowNs();
+    for (uint64_t index = 0; index < opt.messages; index++) {
+        RetentionLine(index, prefix, body);
+        ChatMessage message;
+        message.timestamp = (int64_t)index;
+        message.kind = index % 10 == 0 ? MessageKind::Direct : MessageKind::Chat;
+        std::string_view sender = std::string_view(prefix).substr(0, prefix.size() - 2);
+        log.Append(index % 10 == 0 ? sender : std::string_view(), sender, message, prefix, body);
+    }
+    double appendMs = (double)(NowNs() - start) / 1e6;
+    log.Close();
+    double writtenMs = (double)(NowNs() - start) / 1e6;
+    ChatLog::Stats written = log.GetStats();
+
+    int64_t newest = (int64_t)opt.messages - 1;
+    LoadResult decode = LoadLog(opt, opt.reload, newest, false);
+    LoadResult tail = LoadLog(opt, opt.reload, newest, true);
+    LoadResult all = LoadLog(opt, opt.messages, newest, true);
+    if (scratch) {
+        std::filesystem::remove_all(opt.logDirectory, error);
+    }
+
+    bool ok = written.recordsWritten == opt.messages && decode.newestLast && tail.newestLast && all.newestLast && tail.loaded == std::min(opt.reload, opt.messages) &&
+        all.loaded == opt.messages;
+    printf("{\n");
+    printf("  \"mode\": \"startup\",\n  \"messages\": %zu,\n  \"reload\": %zu,\n", opt.messages, opt.reload);
+    printf("  \"write\": { \"append_ns\": %.0f, \"written_ms\": %.1f, \"records\": %llu, \"mib\": %.1f, \"syncs\": %llu, \"segments\": %llu },\n",
+        appendMs * 1e6 / (double)opt.messages, writtenMs, (unsigned long long)written.recordsWritten, (double)written.bytesWritten / 1048576.0,
+        (unsigned long long)written.syncs, (unsigned long long)written.segments);
+    // the histories index every message for search as it goes in, decoding alone is what the log costs
+    printf("  \"decode_tail\": { \"loaded\": %zu, \"best_ms\": %.2f, \"worst_ms\": %.2f },\n", decode.loaded, decode.bestMs, decode.worstMs);
+    printf("  \"load_tail\": { \"loaded\": %zu, \"best_ms\": %.2f, \"worst_ms\": %.2f, \"newest_last\": %s },\n", tail.loaded, tail.bestMs,
+        tail.worstMs, tail.newestLast ? "true" : "false");
+    printf("  \"load_all\": { \"loaded\": %zu, \"best_ms\": %.2f, \"worst_ms\": %.2f, \"newest_last\": %s }\n}\n", all.loaded, all.bestMs,
+        all.worstMs, all.newestLast ? "true" : "false");
+    return ok ? 0 : 1;
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--mode frame|memory|retention|startup] [--messages n] [--dm-messages n] [--visible n] [--frames n] [--username name]\n"
+                    "          [--max-messages n] [--max-bytes n] [--spill-dir dir] [--log-dir dir] [--reload n] [--runs n]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--mode") opt.mode = value;
+        else if (arg == "--messages") opt.messages = strtoull(value, nullptr, 10);
+        else if (arg == "--dm-messages") opt.dmMessages = strtoull(value, nullptr, 10);
+        else if (arg == "--visible") opt.visible = strtoull(value, nullptr, 10);
+        else if (arg == "--frames") opt.frames = atoi(value);
+        else if (arg == "--username") opt.username = value;
+        else if (arg == "--max-messages") opt.maxMessages = strtoull(value, nullptr, 10);
+        else if (arg == "--max-bytes") opt.maxBytes = strtoull(value, nullptr, 10);
+        else if (arg == "--spill-dir") opt.spillDirectory = value;
+        else if (arg == "--log-dir") opt.logDirectory = value;
+        else if (arg == "--reload") opt.reload = strtoull(value, nullptr, 10);
+        else if (arg == "--runs") opt.runs = atoi(value);
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.messages == 0) {
+        opt.messages = opt.mode == "retention" || opt.mode == "startup" ? 1000000 : 100000;
+    }
+    if ((opt.mode != "frame" && opt.mode != "memory" && opt.mode != "retention" && opt.mode != "startup") || opt.frames < 1 ||
+        opt.runs < 1 || opt.username.empty()) {
+        Usage(argv[0]);
+        return 1;
+    }
+    if (opt.mode == "retention") {
+        return RunRetention(opt);
+    }
+    if (opt.mode == "startup") {
+        return RunStartup(opt);
+    }
+    return opt.mode == "memory" ? RunMemory(opt) : RunFrame(opt);
+}
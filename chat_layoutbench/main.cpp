@@ -0,0 +1,258 @@
+// this is a benchmark of what laying out the chat list costs per frame as the history grows, it needs neither ImGui
+// nor a window: ChatListLayout is driven the way DrawChatLines() drives it, with a stand-in for ImGui::CalcTextSize()
+// that walks the glyphs of a line and wraps it at word boundaries with a fixed advance per character
+// for every history size from 1000 lines up to --max-lines, ten times more each step:
+//   first_sync  the first frame, every line is measured once
+//   resize      the wrap width changed, every line is measured again
+//   frames      --frames frames, each one gets a new line at the bottom, then Sync() measures it, two LineAt() calls find
+//               the visible range for a scroll position that moves over the whole list and the visible lines are walked
+//               as DrawChatLines() submits them
+//   legacy      the layout before ChatListLayout: every line is measured every frame, as TextWrapped() per entry did,
+//               run for --legacy-frames frames only since it grows with the history
+// --window adds a run where the history keeps only its newest lines in memory, as under the client's retention limits,
+// so every new line evicts one at the front and Sync() has to drop offsets and compact them now and then
+// the results are printed as JSON on stdout
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat_view.h"
+
+namespace {
+
+struct Options {
+    size_t maxLines = 1000000;
+    int frames = 2000;
+    int legacyFrames = 5;
+    size_t window = 20000; // 0 skips the bounded run
+    float wrapWidth = 600.0f;
+    float viewHeight = 700.0f;
+};
+
+// what the stand-in for the default ImGui font measures
+const float kAdvance = 7.0f;
+const float kLineHeight = 13.0f;
+const float kSpacing = 4.0f; // ItemSpacing.y
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* const kWords[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliet", "kilo", "lima",
+    "mike", "november", "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey",
+    "xray", "yankee", "zulu", "the", "a", "is", "and", "server", "message", "window", "frame", "later", "now",
+};
+
+// "userN: " and 3 to 40 words, so some lines wrap once or twice at the default width
+std::vector<std::string> MakeLines(size_t count) {
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        std::string line = "user" + std::to_string((seed >> 8) % 500) + ":";
+        int words = 3 + (int)((seed >> 16) % 38);
+        for (int w = 0; w < words; w++) {
+            seed = seed * 1664525u + 1013904223u;
+            line += ' ';
+            line += kWords[(seed >> 8) % (sizeof(kWords) / sizeof(kWords[0]))];
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+// the height of line wrapped at width plus the spacing to the next one, a word that does not fit goes to the next row
+float Measure(std::string_view line, float width) {
+    int rows = 1;
+    float x = 0.0f;
+    size_t i = 0;
+    while (i < line.size()) {
+        size_t end = line.find(' ', i);
+        if (end == std::string_view::npos) {
+            end = line.size();
+        }
+        float word = 0.0f;
+        for (size_t c = i; c < end; c++) {
+            word += kAdvance; // a glyph lookup in ImGui
+        }
+        if (x > 0.0f && x + word > width) {
+            rows++;
+            x = 0.0f;
+        }
+        x += word + kAdvance;
+        i = end + 1;
+    }
+    return (float)rows * kLineHeight + kSpacing;
+}
+
+struct Result {
+    size_t lines = 0;
+    double firstSyncMs = 0;
+    double resizeMs = 0;
+    uint64_t p50 = 0; // per frame in nanoseconds
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+    double legacyMs = 0; // per frame
+    uint64_t drawn = 0;  // visible lines walked over all frames, the layouts have to see the same text
+};
+
+// where the top of the view is in frame, it moves down the list in 64 steps and then starts at the top again
+double ScrollY(const ChatListLayout& layout, int frame, float viewHeight) {
+    double range = std::max(0.0, layout.TotalHeight() - viewHeight);
+    return range * (double)(frame % 64) / 63.0;
+}
+
+// one frame of DrawChatLines() minus the ImGui calls, the lines firstLine .. firstLine + count of lines are in memory
+uint64_t Frame(ChatListLayout& layout, const std::vector<std::string>& lines, uint64_t firstLine, size_t count, float wrapWidth,
+    float viewHeight, int frame) {
+    auto measure = [&](size_t index, float width) { return Measure(lines[firstLine + index], width); };
+    layout.Sync(firstLine, count, wrapWidth, nullptr, kLineHeight, measure);
+    double from = ScrollY(layout, frame, viewHeight);
+    size_t first = layout.LineAt(from);
+    size_t last = std::min(layout.LineAt(from + viewHeight) + 1, layout.Count());
+    uint64_t drawn = 0;
+    for (size_t i = first; i < last; i++) {
+        drawn += lines[firstLine + i].size() != 0;
+    }
+    return drawn;
+}
+
+void Summarise(std::vector<uint64_t>& frames, Result& result) {
+    std::sort(frames.begin(), frames.end());
+    result.p50 = frames[frames.size() / 2];
+    result.p99 = frames[frames.size() * 99 / 100];
+    result.max = frames.back();
+}
+
+// the whole history in memory, it grows by a line a frame
+Result RunGrowing(const Options& opt, const std::vector<std::string>& lines, size_t size) {
+    Result result;
+    result.lines = size;
+    ChatListLayout layout;
+    uint64_t t0 = NowNs();
+    Frame(layout, lines, 0, size, opt.wrapWidth, opt.viewHeight, 0);
+    result.firstSyncMs = (double)(NowNs() - t0) / 1e6;
+    t0 = NowNs();
+    Frame(layout, lines, 0, size, opt.wrapWidth - 50.0f, opt.viewHeight, 0);
+    result.resizeMs = (double)(NowNs() - t0) / 1e6;
+
+    std::vector<uint64_t> frames;
+    frames.reserve((size_t)opt.frames);
+    for (int frame = 0; frame < opt.frames; frame++) {
+        t0 = NowNs();
+        result.drawn += Frame(layout, lines, 0, size + (size_t)frame + 1, opt.wrapWidth - 50.0f, opt.viewHeight, frame);
+        frames.push_back(NowNs() - t0);
+    }
+    Summarise(frames, result);
+
+    // every line measured and summed every frame, the height of the list is all the old loop learned from it
+    t0 = NowNs();
+    double height = 0;
+    for (int frame = 0; frame < opt.legacyFrames; frame++) {
+        for (size_t i = 0; i < size + (size_t)frame + 1; i++) {
+            height += Measure(lines[i], opt.wrapWidth);
+        }
+    }
+    result.legacyMs = (double)(NowNs() - t0) / 1e6 / opt.legacyFrames;
+    if (height < 0) {
+        printf("%f", height); // keeps the loop from being optimised away
+    }
+    return result;
+}
+
+// only the newest window lines in memory, every frame evicts the oldest and appends a new one
+Result RunBounded(const Options& opt, const std::vector<std::string>& lines, size_t size) {
+    Result result;
+    result.lines = size;
+    size_t window = std::min(opt.window, size);
+    ChatListLayout layout;
+    uint64_t t0 = NowNs();
+    Frame(layout, lines, size - window, window, opt.wrapWidth, opt.viewHeight, 0);
+    result.firstSyncMs = (double)(NowNs() - t0) / 1e6;
+    std::vector<uint64_t> frames;
+    frames.reserve((size_t)opt.frames);
+    for (int frame = 0; frame < opt.frames; frame++) {
+        t0 = NowNs();
+        result.drawn += Frame(layout, lines, size - window + (size_t)frame + 1, window, opt.wrapWidth, opt.viewHeight, frame);
+        frames.push_back(NowNs() - t0);
+    }
+    Summarise(frames, result);
+    return result;
+}
+
+void PrintResult(const Result& result, bool legacy, bool last) {
+    printf("    { \"lines\": %zu, \"first_sync_ms\": %.3f, ", result.lines, result.firstSyncMs);
+    if (legacy) {
+        printf("\"resize_ms\": %.3f, ", result.resizeMs);
+    }
+    printf("\"frame_p50_us\": %.3f, \"frame_p99_us\": %.3f, \"frame_max_us\": %.3f, ", (double)result.p50 / 1e3, (double)result.p99 / 1e3,
+        (double)result.max / 1e3);
+    if (legacy) {
+        printf("\"legacy_frame_ms\": %.3f, ", result.legacyMs);
+    }
+    printf("\"visible_lines_walked\": %llu }%s\n", (unsigned long long)result.drawn, last ? "" : ",");
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--max-lines n] [--frames n] [--legacy-frames n] [--window n] [--wrap-width px] [--view-height px]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--max-lines") opt.maxLines = strtoull(value, nullptr, 10);
+        else if (arg == "--frames") opt.frames = atoi(value);
+        else if (arg == "--legacy-frames") opt.legacyFrames = atoi(value);
+        else if (arg == "--window") opt.window = strtoull(value, nullptr, 10);
+        else if (arg == "--wrap-width") opt.wrapWidth = (float)atof(value);
+        else if (arg == "--view-height") opt.viewHeight = (float)atof(value);
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.maxLines < 1000 || opt.frames < 1 || opt.legacyFrames < 1 || opt.wrapWidth <= 100.0f || opt.viewHeight <= 0.0f) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<size_t> sizes;
+    for (size_t size = 1000; size <= opt.maxLines; size *= 10) {
+        sizes.push_back(size);
+    }
+    std::vector<std::string> lines = MakeLines(sizes.back() + (size_t)opt.frames + 1);
+
+    printf("{\n");
+    printf("  \"frames\": %d,\n  \"legacy_frames\": %d,\n  \"wrap_width\": %.0f,\n  \"view_height\": %.0f,\n", opt.frames, opt.legacyFrames,
+        opt.wrapWidth, opt.viewHeight);
+    printf("  \"growing\": [\n");
+    for (size_t i = 0; i < sizes.size(); i++) {
+        PrintResult(RunGrowing(opt, lines, sizes[i]), true, i + 1 == sizes.size());
+    }
+    printf("  ]");
+    if (opt.window > 0) {
+        printf(",\n  \"window\": %zu,\n  \"bounded\": [\n", opt.window);
+        for (size_t i = 0; i < sizes.size(); i++) {
+            PrintResult(RunBounded(opt, lines, sizes[i]), false, i + 1 == sizes.size());
+        }
+        printf("  ]");
+    }
+    printf("\n}\n");
+    return 0;
+}
@@ -0,0 +1,576 @@
+// this is a headless load generator for the chat server
+// it opens N loopback connections, joins with generated usernames and then sends global messages and DMs
+// at a fixed aggregate rate using the same framing, parsing and formatting code as the client
+// every message carries its send time so each delivery gives a send-to-receive latency sample
+// the results (latency percentiles, throughput and connection setup times) are printed as JSON on stdout
+// --churn adds extra users joining and leaving during the run and --user-deltas asks for USERS+|/USERS-| deltas,
+// running it with and without --user-deltas compares what keeping the user list current costs on the wire and in CPU
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "chat_framer.h"
+#include "chat_protocol.h"
+#include "chat_users.h"
+
+namespace {
+
+struct Options {
+    const char* host = "127.0.0.1";
+    int port = 65432;
+    int clients = 100;
+    double rate = 100.0;     // messages per second summed over all clients
+    double dmRatio = 0.1;    // share of the messages that are sent as DMs
+    double duration = 10.0;  // seconds of messaging after everyone joined
+    int connectBatch = 256;  // connections in flight at the same time during setup
+    double setupTimeout = 60.0;
+    const char* prefix = "load";
+    double churn = 0.0;      // extra joins per second during the run, every churn user leaves again a second after it joined
+    bool userDeltas = false; // ask the server for user list deltas in a HELLO line
+};
+
+// log-linear histogram over nanoseconds, 64 sub buckets per power of two keeps the error under 2%
+// and the memory fixed no matter how many samples a broadcast storm produces
+class LatencyHistogram {
+public:
+    void Record(uint64_t ns) {
+        m_counts[Index(ns)]++;
+        m_total++;
+        m_max = std::max(m_max, ns);
+    }
+    uint64_t Count() const { return m_total; }
+    uint64_t Max() const { return m_max; }
+
+    uint64_t Percentile(double p) const {
+        if (m_total == 0) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)std::ceil(p / 100.0 * (double)m_total);
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; i++) {
+            seen += m_counts[i];
+            if (seen >= rank) {
+                return std::min(UpperBound(i), m_max);
+            }
+        }
+        return m_max;
+    }
+
+private:
+    static const int kSubBits = 6;
+    static const size_t kBuckets = (64 - kSubBits + 1) << kSubBits;
+
+    static size_t Index(uint64_t ns) {
+        if (ns < (1ull << kSubBits)) {
+            return (size_t)ns;
+        }
+        int exponent = 63 - __builtin_clzll(ns);
+        int shift = exponent - kSubBits;
+        size_t sub = (size_t)(ns >> shift) & ((1u << kSubBits) - 1);
+        return ((size_t)(shift + 1) << kSubBits) + sub;
+    }
+    static uint64_t UpperBound(size_t index) {
+        size_t block = index >> kSubBits;
+        uint64_t sub = index & ((1u << kSubBits) - 1);
+        if (block == 0) {
+            return sub;
+        }
+        int shift = (int)block - 1;
+        return (((1ull << kSubBits) + sub + 1) << shift) - 1;
+    }
+
+    uint64_t m_counts[kBuckets] = {};
+    uint64_t m_total = 0;
+    uint64_t m_max = 0;
+};
+
+struct Connection {
+    int fd = -1;
+    int id = 0;
+    std::string username;
+    LineFramer in;
+    std::string out;
+    size_t outOffset = 0;
+    bool tcpConnected = false;
+    bool joined = false;
+    uint64_t connectStart = 0;
+};
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int g_epoll = -1;
+std::vector<Connection> g_connections;
+int g_clientCount = 0; // connections at or above this id are churn users, they are not measured
+bool g_userDeltas = false;
+sockaddr_in g_server{};
+int g_joinedCount = 0;
+int g_failed = 0;
+
+LatencyHistogram g_globalLatency;
+LatencyHistogram g_dmLatency;
+LatencyHistogram g_tcpConnectTime;
+LatencyHistogram g_joinTime;
+uint64_t g_globalSent = 0;
+uint64_t g_dmSent = 0;
+uint64_t g_globalReceived = 0;
+uint64_t g_dmReceived = 0;
+uint64_t g_bytesReceived = 0;
+uint64_t g_malformed = 0;
+
+// user list upkeep, every connection parses what it receives but only connection 0 keeps a real directory
+// (thousands of full copies of the list would not fit in memory), it also checks the server's checksums
+struct UserListStats {
+    uint64_t snapshots = 0;
+    uint64_t deltas = 0;
+    uint64_t checksums = 0;
+    uint64_t bytes = 0;
+    uint64_t names = 0;  // names split out of snapshots
+    uint64_t cpuNs = 0;  // time spent parsing and applying user list lines on all connections
+    uint64_t mismatches = 0;
+};
+UserListStats g_userStats;
+UserDirectory g_observer;
+
+// a churn user leaving on purpose, unlike Fail() it is not counted as a failure
+void Close(Connection& c) {
+    if (c.fd >= 0) {
+        epoll_ctl(g_epoll, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+        c.joined = false;
+    }
+}
+
+void Fail(Connection& c) {
+    if (c.fd >= 0) {
+        epoll_ctl(g_epoll, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+        if (c.joined) {
+            g_joinedCount--;
+        }
+        c.joined = false;
+        g_failed++;
+    }
+}
+
+void Flush(Connection& c) {
+    while (c.fd >= 0 && c.outOffset < c.out.size()) {
+        ssize_t sent = send(c.fd, c.out.data() + c.outOffset, c.out.size() - c.outOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            c.outOffset += (size_t)sent;
+        }
+        else if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        else {
+            Fail(c);
+            return;
+        }
+    }
+    c.out.clear();
+    c.outOffset = 0;
+}
+
+void Queue(Connection& c, const std::string& packet) {
+    bool wasIdle = c.outOffset == c.out.size();
+    c.out += packet;
+    if (wasIdle) {
+        Flush(c);
+    }
+}
+
+bool StartConnect(Connection& c) {
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    c.connectStart = NowNs();
+    if (connect(c.fd, (sockaddr*)&g_server, sizeof(g_server)) != 0 && errno != EINPROGRESS) {
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u32 = (uint32_t)c.id;
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, c.fd, &ev);
+    return true;
+}
+
+// the payload is "lg <send time ns> <sender id>", anything else on the wire is ignored
+bool ReadStamp(std::string_view text, uint64_t& sentAt) {
+    if (text.size() < 4 || text.compare(0, 3, "lg ") != 0) {
+        return false;
+    }
+    sentAt = 0;
+    size_t i = 3;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+        sentAt = sentAt * 10 + (uint64_t)(text[i] - '0');
+    }
+    return i > 3;
+}
+
+void HandleLine(Connection& c, const FramedLine& line, uint64_t now) {
+    uint64_t parseStart = NowNs();
+    ServerMessage message = ParseServerLine(line);
+    uint64_t sentAt = 0;
+    bool measured = c.id < g_clientCount;
+    if (const UsersUpdate* users = std::get_if<UsersUpdate>(&message)) {
+        g_userStats.snapshots++;
+        g_userStats.bytes += line.text.size() + 1;
+        if (c.id == 0) {
+            g_observer.Clear();
+            ForEachUserName(*users, [](std::string_view name) { g_observer.Add(name); g_userStats.names++; });
+        }
+        else {
+            ForEachUserName(*users, [](std::string_view) { g_userStats.names++; });
+        }
+        g_userStats.cpuNs += NowNs() - parseStart;
+    }
+    else if (const UserAdded* added = std::get_if<UserAdded>(&message)) {
+        g_userStats.deltas++;
+        g_userStats.bytes += line.text.size() + 1;
+        if (c.id == 0) {
+            g_observer.Add(added->name);
+        }
+        g_userStats.cpuNs += NowNs() - parseStart;
+    }
+    else if (const UserRemoved* removed = std::get_if<UserRemoved>(&message)) {
+        g_userStats.deltas++;
+        g_userStats.bytes += line.text.size() + 1;
+        if (c.id == 0) {
+            g_observer.Remove(removed->name);
+        }
+        g_userStats.cpuNs += NowNs() - parseStart;
+    }
+    else if (const UserListChecksum* sum = std::get_if<UserListChecksum>(&message)) {
+        g_userStats.checksums++;
+        g_userStats.bytes += line.text.size() + 1;
+        if (c.id == 0 && (g_observer.size() != sum->count || g_observer.Checksum() != sum->checksum)) {
+            g_userStats.mismatches++;
+            Queue(c, FormatUserListRequest());
+        }
+        g_userStats.cpuNs += NowNs() - parseStart;
+    }
+    else if (!measured) {
+        // churn users receive the chat as well but they are not part of the expected counts
+    }
+    else if (const ChatLine* chat = std::get_if<ChatLine>(&message)) {
+        if (ReadStamp(chat->text, sentAt)) {
+            g_globalReceived++;
+            g_globalLatency.Record(now - sentAt);
+        }
+        else {
+            g_malformed++;
+        }
+    }
+    else if (const DirectMessage* dm = std::get_if<DirectMessage>(&message)) {
+        if (ReadStamp(dm->text, sentAt)) {
+            g_dmReceived++;
+            g_dmLatency.Record(now - sentAt);
+        }
+        else {
+            g_malformed++;
+        }
+    }
+    else if (const SystemNotice* notice = std::get_if<SystemNotice>(&message)) {
+        // our own join announcement tells us the server accepted the login
+        if (!c.joined && notice->text.size() > c.username.size() && notice->text.compare(0, c.username.size(), c.username) == 0
+            && notice->text.substr(c.username.size()) == " joined the chat") {
+            c.joined = true;
+            g_joinedCount++;
+            g_joinTime.Record(now - c.connectStart);
+        }
+    }
+}
+
+void HandleEvent(Connection& c, uint32_t flags) {
+    if (c.fd < 0) {
+        return;
+    }
+    if (!c.tcpConnected && (flags & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            Fail(c);
+            return;
+        }
+        c.tcpConnected = true;
+        g_tcpConnectTime.Record(NowNs() - c.connectStart);
+        // unlike a human at the login window we could send a message right after the name
+        // so we terminate the name with a newline, the server accepts both forms
+        if (g_userDeltas) {
+            HelloRequest hello;
+            hello.userDeltas = true;
+            Queue(c, FormatHello(hello));
+        }
+        Queue(c, c.username + "\n");
+    }
+    if (flags & EPOLLOUT) {
+        Flush(c);
+    }
+    if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        while (c.fd >= 0) {
+            char* buffer = c.in.PrepareWrite(65536);
+            ssize_t bytes = recv(c.fd, buffer, 65536, 0);
+            if (bytes > 0) {
+                g_bytesReceived += (uint64_t)bytes;
+                c.in.CommitWrite((size_t)bytes);
+                uint64_t now = NowNs();
+                FramedLine line;
+                while (c.in.NextLine(line)) {
+                    HandleLine(c, line, now);
+                }
+            }
+            else if (bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            else if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            else {
+                Fail(c);
+            }
+        }
+    }
+}
+
+void Poll(int timeoutMs) {
+    static std::vector<epoll_event> events(4096);
+    int count = epoll_wait(g_epoll, events.data(), (int)events.size(), timeoutMs);
+    for (int i = 0; i < count; i++) {
+        HandleEvent(g_connections[events[i].data.u32], events[i].events);
+    }
+}
+
+void PrintHistogram(const char* name, const LatencyHistogram& h, bool last) {
+    printf("    \"%s\": { \"count\": %llu, \"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f }%s\n",
+        name, (unsigned long long)h.Count(), h.Percentile(50) / 1e3, h.Percentile(99) / 1e3, h.Percentile(99.9) / 1e3, h.Max() / 1e3, last ? "" : ",");
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--host ip] [--port port] [--clients n] [--rate msgs/sec] [--dm-ratio 0..1]\n"
+        "          [--duration sec] [--connect-batch n] [--setup-timeout sec] [--prefix name]\n"
+        "          [--churn joins/sec] [--user-deltas 0|1]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--host") opt.host = value;
+        else if (arg == "--port") opt.port = atoi(value);
+        else if (arg == "--clients") opt.clients = atoi(value);
+        else if (arg == "--rate") opt.rate = atof(value);
+        else if (arg == "--dm-ratio") opt.dmRatio = atof(value);
+        else if (arg == "--duration") opt.duration = atof(value);
+        else if (arg == "--connect-batch") opt.connectBatch = atoi(value);
+        else if (arg == "--setup-timeout") opt.setupTimeout = atof(value);
+        else if (arg == "--prefix") opt.prefix = value;
+        else if (arg == "--churn") opt.churn = atof(value);
+        else if (arg == "--user-deltas") opt.userDeltas = atoi(value) != 0;
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.clients < 1 || opt.rate <= 0 || opt.connectBatch < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    g_server.sin_family = AF_INET;
+    g_server.sin_port = htons((uint16_t)opt.port);
+    if (inet_pton(AF_INET, opt.host, &g_server.sin_addr) != 1) {
+        fprintf(stderr, "invalid host %s\n", opt.host);
+        return 1;
+    }
+    g_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+    // the churn users get their slots up front so g_connections never moves while epoll refers to it by index
+    int churnSlots = opt.churn > 0 ? (int)std::ceil(opt.churn * opt.duration) + 1 : 0;
+    g_clientCount = opt.clients;
+    g_userDeltas = opt.userDeltas;
+    g_connections.resize((size_t)(opt.clients + churnSlots));
+    for (int i = 0; i < opt.clients + churnSlots; i++) {
+        char name[64];
+        if (i < opt.clients) {
+            snprintf(name, sizeof(name), "%s%06d", opt.prefix, i);
+        }
+        else {
+            snprintf(name, sizeof(name), "%sc%06d", opt.prefix, i - opt.clients);
+        }
+        g_connections[i].id = i;
+        g_connections[i].username = name;
+    }
+
+    // setup phase: we keep at most connectBatch handshakes in flight so the listen backlog does not overflow
+    uint64_t setupStart = NowNs();
+    int next = 0;
+    while (g_joinedCount + g_failed < opt.clients) {
+        int inFlight = next - g_joinedCount - g_failed;
+        while (next < opt.clients && inFlight < opt.connectBatch) {
+            if (!StartConnect(g_connections[next])) {
+                g_failed++;
+            }
+            next++;
+            inFlight++;
+        }
+        Poll(10);
+        if ((NowNs() - setupStart) / 1e9 > opt.setupTimeout) {
+            fprintf(stderr, "setup timed out with %d of %d clients joined\n", g_joinedCount, opt.clients);
+            break;
+        }
+    }
+    double setupSeconds = (NowNs() - setupStart) / 1e9;
+    fprintf(stderr, "%d clients joined in %.2f s (%d failed)\n", g_joinedCount, setupSeconds, g_failed);
+
+    // we drain the join announcements and user lists the setup produced before measuring
+    for (int i = 0; i < 50; i++) {
+        Poll(10);
+    }
+    uint64_t bytesBeforeRun = g_bytesReceived;
+    g_userStats = UserListStats();
+
+    std::vector<int> live;
+    for (const Connection& c : g_connections) {
+        if (c.joined) {
+            live.push_back(c.id);
+        }
+    }
+    if (live.empty()) {
+        fprintf(stderr, "no client joined, is the server running on %s:%d?\n", opt.host, opt.port);
+        return 1;
+    }
+
+    // messaging phase: every poll we send however many messages are due to keep the aggregate rate
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pick(0, live.size() - 1);
+    uint64_t runStart = NowNs();
+    uint64_t runEnd = runStart + (uint64_t)(opt.duration * 1e9);
+    uint64_t sent = 0;
+    int churned = 0;
+    int churnLifetime = std::max(1, (int)std::ceil(opt.churn));
+    while (true) {
+        uint64_t now = NowNs();
+        if (now >= runEnd) {
+            break;
+        }
+        // every churn step brings a new user in and sends the one that joined a second ago away, one join and one leave
+        int churnDue = std::min(churnSlots, (int)((now - runStart) / 1e9 * opt.churn));
+        for (; churned < churnDue; churned++) {
+            if (churned >= churnLifetime) {
+                Close(g_connections[opt.clients + churned - churnLifetime]);
+            }
+            if (!StartConnect(g_connections[opt.clients + churned])) {
+                g_failed++;
+            }
+        }
+        uint64_t due = (uint64_t)((now - runStart) / 1e9 * opt.rate);
+        for (; sent < due; sent++) {
+            Connection& from = g_connections[live[pick(rng)]];
+            if (from.fd < 0) {
+                continue;
+            }
+            char text[64];
+            snprintf(text, sizeof(text), "lg %llu %d", (unsigned long long)NowNs(), from.id);
+            if (live.size() > 1 && coin(rng) < opt.dmRatio) {
+                const Connection* to = &g_connections[live[pick(rng)]];
+                while (to->id == from.id) {
+                    to = &g_connections[live[pick(rng)]];
+                }
+                Queue(from, FormatDirectMessage(to->username, text));
+                g_dmSent++;
+            }
+            else {
+                Queue(from, FormatGlobalMessage(text));
+                g_globalSent++;
+            }
+        }
+        Poll(1);
+    }
+    // we give in-flight messages a moment to arrive, they still count toward latency but not toward the run time
+    for (int i = 0; i < 200; i++) {
+        Poll(5);
+    }
+    double runSeconds = opt.duration;
+
+    uint64_t expectedGlobal = g_globalSent * (uint64_t)(live.size() - 1);
+    printf("{\n");
+    printf("  \"clients\": %d,\n  \"joined\": %zu,\n  \"failed\": %d,\n", opt.clients, live.size(), g_failed);
+    printf("  \"setup_seconds\": %.3f,\n  \"connections_per_sec\": %.1f,\n", setupSeconds, live.size() / setupSeconds);
+    printf("  \"run_seconds\": %.3f,\n", runSeconds);
+    printf("  \"sent\": { \"global\": %llu, \"dm\": %llu, \"per_sec\": %.1f },\n",
+        (unsigned long long)g_globalSent, (unsigned long long)g_dmSent, (g_globalSent + g_dmSent) / runSeconds);
+    printf("  \"received\": { \"global\": %llu, \"global_expected\": %llu, \"dm\": %llu, \"per_sec\": %.1f, \"bytes_per_sec\": %.1f, \"unrecognised\": %llu },\n",
+        (unsigned long long)g_globalReceived, (unsigned long long)expectedGlobal, (unsigned long long)g_dmReceived,
+        (g_globalReceived + g_dmReceived) / runSeconds, (g_bytesReceived - bytesBeforeRun) / runSeconds, (unsigned long long)g_malformed);
+    printf("  \"latency\": {\n");
+    PrintHistogram("global", g_globalLatency, false);
+    PrintHistogram("dm", g_dmLatency, true);
+    printf("  },\n");
+    printf("  \"connection_setup\": {\n");
+    PrintHistogram("tcp_connect", g_tcpConnectTime, false);
+    PrintHistogram("join", g_joinTime, true);
+    printf("  },\n");
+    printf("  \"user_list\": { \"mode\": \"%s\", \"churn_joins\": %d, \"snapshots\": %llu, \"deltas\": %llu, \"checksums\": %llu,\n",
+        opt.userDeltas ? "deltas" : "snapshots", churned, (unsigned long long)g_userStats.snapshots, (unsigned long long)g_userStats.deltas,
+        (unsigned long long)g_userStats.checksums);
+    printf("    \"bytes\": %llu, \"bytes_per_sec\": %.1f, \"names_split\": %llu, \"cpu_ms\": %.1f, \"observer_users\": %zu, \"observer_mismatches\": %llu }\n",
+        (unsigned long long)g_userStats.bytes, g_userStats.bytes / runSeconds, (unsigned long long)g_userStats.names, g_userStats.cpuNs / 1e6,
+        g_observer.size(), (unsigned long long)g_userStats.mismatches);
+    printf("}\n");
+
+    for (Connection& c : g_connections) {
+        if (c.fd >= 0) {
+            close(c.fd);
+        }
+    }
+    close(g_epoll);
+    return 0;
+}
@@ -0,0 +1,193 @@
+// this is a benchmark of the notification mixer, what it costs to render one block of output while every voice plays
+// it loads message.wav, dm.wav and send.wav through a SampleCache, keeps --voices of them playing (a sound that ends is
+// started again right away) and renders --blocks blocks of --block-ms each on this thread, timing every block
+// the same blocks are mixed with the scalar kernels as well, to show what the SSE2/AVX2 kernels save and to check that
+// both give exactly the same samples
+// the results are printed as JSON on stdout
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat_mixer.h"
+#include "chat_samples.h"
+
+namespace {
+
+struct Options {
+    int voices = 32;
+    int blocks = 20000;
+    int blockMs = 10;
+    std::string sounds = "../example_win32_directx11";
+};
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const NotificationSound kSounds[] = { NotificationSound::Message, NotificationSound::DirectMessage, NotificationSound::Send };
+
+struct Timing {
+    double meanNs = 0;
+    double p50Ns = 0;
+    double p99Ns = 0;
+    double maxNs = 0;
+};
+
+Timing Summarise(std::vector<uint64_t>& ns) {
+    Timing timing;
+    std::sort(ns.begin(), ns.end());
+    uint64_t total = 0;
+    for (uint64_t t : ns) {
+        total += t;
+    }
+    timing.meanNs = (double)total / (double)ns.size();
+    timing.p50Ns = (double)ns[ns.size() / 2];
+    timing.p99Ns = (double)ns[ns.size() * 99 / 100];
+    timing.maxNs = (double)ns.back();
+    return timing;
+}
+
+void PrintTiming(const char* name, const Timing& timing, double blockNs, const char* tail) {
+    printf("  \"%s\": { \"mean_ns\": %.0f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %.0f, \"realtime_share\": %.5f }%s\n",
+        name, timing.meanNs, timing.p50Ns, timing.p99Ns, timing.maxNs, timing.meanNs / blockNs, tail);
+}
+
+// the voices of the mixer as plain offsets, so the kernels can be timed on their own with the same work
+struct KernelVoice {
+    const std::vector<int16_t>* samples;
+    size_t position;
+};
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--voices n] [--blocks n] [--block-ms n] [--sounds dir]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--voices") opt.voices = atoi(value);
+        else if (arg == "--blocks") opt.blocks = atoi(value);
+        else if (arg == "--block-ms") opt.blockMs = atoi(value);
+        else if (arg == "--sounds") opt.sounds = value;
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.voices < 1 || opt.blocks < 1 || opt.blockMs < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    SampleCache cache;
+    if (!cache.Load(opt.sounds)) {
+        for (NotificationSound sound : kSounds) {
+            if (!cache.Error(sound).empty()) {
+                fprintf(stderr, "%s: %s\n", cache.Path(sound).c_str(), cache.Error(sound).c_str());
+            }
+        }
+        return 1;
+    }
+    const SampleFormat& format = cache.Format();
+    size_t frames = (size_t)format.sampleRate * opt.blockMs / 1000;
+    size_t count = frames * format.channels;
+    double blockNs = opt.blockMs * 1e6;
+
+    // the mixer as the client runs it, voices started through its queue, message quieter than the DMs
+    NotificationMixer mixer(format, (size_t)opt.voices);
+    for (NotificationSound sound : kSounds) {
+        mixer.LoadCached(sound, cache);
+    }
+    mixer.SetVolume(NotificationSound::Message, 0.5f);
+    mixer.SetVolume(NotificationSound::DirectMessage, 0.8f);
+    std::vector<int16_t> out(count);
+    std::vector<uint64_t> renderNs;
+    renderNs.reserve(opt.blocks);
+    size_t next = 0;
+    for (int b = 0; b < opt.blocks; b++) {
+        // the pool stays full, a sound that ended is replaced before the block, as in a storm the policy let through
+        for (size_t active = b == 0 ? 0 : mixer.ActiveVoices(); active < (size_t)opt.voices; active++) {
+            mixer.Play(kSounds[next++ % 3]);
+        }
+        uint64_t start = NowNs();
+        mixer.Render(out.data(), frames);
+        renderNs.push_back(NowNs() - start);
+    }
+    NotificationMixer::Stats stats = mixer.GetStats();
+
+    // the kernels alone on the same kind of work, every voice at another offset into its sound
+    std::vector<KernelVoice> voices;
+    for (int v = 0; v < opt.voices; v++) {
+        const std::vector<int16_t>& samples = cache.Samples(kSounds[v % 3]);
+        voices.push_back({ &samples, (size_t)v * 7 * count % samples.size() / format.channels * format.channels });
+    }
+    std::vector<float> accumulator(count);
+    std::vector<int16_t> simdOut(count);
+    std::vector<int16_t> scalarOut(count);
+    std::vector<uint64_t> simdNs;
+    std::vector<uint64_t> scalarNs;
+    simdNs.reserve(opt.blocks);
+    scalarNs.reserve(opt.blocks);
+    bool identical = true;
+    const float gains[3] = { 0.5f, 0.8f, 1.0f };
+    for (int b = 0; b < opt.blocks; b++) {
+        for (int pass = 0; pass < 2; pass++) {
+            uint64_t start = NowNs();
+            std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+            for (size_t v = 0; v < voices.size(); v++) {
+                const KernelVoice& voice = voices[v];
+                size_t n = std::min(count, voice.samples->size() - voice.position);
+                if (pass == 0) {
+                    MixSamples(accumulator.data(), voice.samples->data() + voice.position, n, gains[v % 3]);
+                }
+                else {
+                    MixSamplesScalar(accumulator.data(), voice.samples->data() + voice.position, n, gains[v % 3]);
+                }
+            }
+            if (pass == 0) {
+                ConvertMix(accumulator.data(), simdOut.data(), count);
+                simdNs.push_back(NowNs() - start);
+            }
+            else {
+                ConvertMixScalar(accumulator.data(), scalarOut.data(), count);
+                scalarNs.push_back(NowNs() - start);
+            }
+        }
+        identical = identical && simdOut == scalarOut;
+        for (KernelVoice& voice : voices) {
+            voice.position += count;
+            if (voice.position >= voice.samples->size()) {
+                voice.position = 0;
+            }
+        }
+    }
+
+    Timing render = Summarise(renderNs);
+    Timing simd = Summarise(simdNs);
+    Timing scalar = Summarise(scalarNs);
+    printf("{\n");
+    printf("  \"kernel\": \"%s\",\n  \"voices\": %d,\n  \"blocks\": %d,\n  \"block_ms\": %d,\n  \"block_frames\": %zu,\n",
+        MixerKernelName(), opt.voices, opt.blocks, opt.blockMs, frames);
+    printf("  \"mixer\": { \"started\": %llu, \"stolen\": %llu, \"dropped\": %llu },\n",
+        (unsigned long long)stats.started, (unsigned long long)stats.stolen, (unsigned long long)stats.dropped);
+    PrintTiming("render", render, blockNs, ",");
+    PrintTiming("kernels", simd, blockNs, ",");
+    PrintTiming("kernels_scalar", scalar, blockNs, ",");
+    printf("  \"speedup\": %.2f,\n  \"identical\": %s\n", scalar.meanNs / simd.meanNs, identical ? "true" : "false");
+    printf("}\n");
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// this is a contention benchmark of the two lock-free rings in chatcore against the mutex and deque they replaced
+// --queue picks which one:
+//   spsc  the receive thread hands lines to the UI thread, it delivers --rate lines per second in 1 ms bursts while the
+//         UI takes --frame-ms per frame, with the mutex the UI holds the lock for the whole frame as ChatState did
+//         we time every push, a push that waits for a frame to end is what used to stall the socket reader
+//   mpsc  --producers threads post one-byte sound ids as fast as they can to one consumer, as the receive thread and
+//         the UI thread do with the notification worker, we time every push and count the items per second
+// every mode runs --runs times and keeps the run with the lowest worst-case push
+// the results are printed as JSON on stdout
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "chat_mpsc.h"
+#include "chat_spsc.h"
+
+namespace {
+
+struct Options {
+    std::string queue = "spsc";
+    int items = 200000;
+    int rate = 100000;   // lines per second the receive thread delivers
+    int frameMs = 8;
+    int producers = 2;
+    int capacity = 16384;
+    int runs = 3;
+};
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SpinFor(uint64_t ns) {
+    uint64_t until = NowNs() + ns;
+    while (NowNs() < until) {
+    }
+}
+
+struct Result {
+    uint64_t items = 0;
+    double seconds = 0;
+    // push latencies in nanoseconds
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+void Summarise(std::vector<uint64_t>& latencies, Result& result) {
+    std::sort(latencies.begin(), latencies.end());
+    size_t n = latencies.size();
+    result.p50 = latencies[n / 2];
+    result.p99 = latencies[n * 99 / 100];
+    result.p999 = latencies[n * 999 / 1000];
+    result.max = latencies.back();
+}
+
+// the receive thread to UI thread handoff, lockFree picks SpscQueue over the mutex protected deque
+Result RunSpsc(const Options& opt, bool lockFree) {
+    SpscQueue<std::string> ring((size_t)opt.capacity);
+    std::mutex mutex;
+    std::deque<std::string> locked;
+    std::vector<uint64_t> latencies;
+    latencies.reserve((size_t)opt.items);
+
+    uint64_t start = NowNs();
+    std::thread producer([&] {
+        int perBurst = std::max(1, opt.rate / 1000);
+        auto next = std::chrono::steady_clock::now();
+        for (int i = 0; i < opt.items; i++) {
+            if (i % perBurst == 0) {
+                next += std::chrono::milliseconds(1);
+                std::this_thread::sleep_until(next);
+            }
+            std::string line = "alice: the quick brown fox jumps over the lazy dog " + std::to_string(i);
+            uint64_t t0 = NowNs();
+            if (lockFree) {
+                // ReceiveLoop() waits in 1 ms steps when the ring is full
+                while (!ring.TryPush(std::move(line))) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            else {
+                std::lock_guard<std::mutex> lock(mutex);
+                locked.push_back(std::move(line));
+            }
+            latencies.push_back(NowNs() - t0);
+        }
+    });
+
+    uint64_t received = 0;
+    std::string line;
+    while (received < (uint64_t)opt.items) {
+        if (lockFree) {
+            while (ring.TryPop(line)) {
+                received++;
+            }
+            SpinFor((uint64_t)opt.frameMs * 1000000);
+        }
+        else {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (!locked.empty()) {
+                line = std::move(locked.front());
+                locked.pop_front();
+                received++;
+            }
+            // the rest of the frame is drawn with the lock still held
+            SpinFor((uint64_t)opt.frameMs * 1000000);
+        }
+    }
+    producer.join();
+
+    Result result;
+    result.items = received;
+    result.seconds = (double)(NowNs() - start) / 1e9;
+    Summarise(latencies, result);
+    return result;
+}
+
+// several producers to one consumer, lockFree picks MpscQueue over the mutex protected deque
+Result RunMpsc(const Options& opt, bool lockFree) {
+    MpscQueue<uint8_t> ring((size_t)opt.capacity);
+    std::mutex mutex;
+    std::deque<uint8_t> locked;
+    std::vector<std::vector<uint64_t>> latencies((size_t)opt.producers);
+    int perProducer = opt.items / opt.producers;
+    std::atomic<bool> go{ false };
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < opt.producers; p++) {
+        producers.emplace_back([&, p] {
+            std::vector<uint64_t>& mine = latencies[(size_t)p];
+            mine.reserve((size_t)perProducer);
+            while (!go) {
+            }
+            for (int i = 0; i < perProducer; i++) {
+                uint8_t sound = (uint8_t)(i % 3);
+                uint64_t t0 = NowNs();
+                if (lockFree) {
+                    while (!ring.TryPush(std::move(sound))) {
+                        std::this_thread::yield();
+                    }
+                }
+                else {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    locked.push_back(sound);
+                }
+                mine.push_back(NowNs() - t0);
+            }
+        });
+    }
+
+    uint64_t start = NowNs();
+    go = true;
+    uint64_t received = 0;
+    uint64_t total = (uint64_t)perProducer * (uint64_t)opt.producers;
+    uint8_t sound;
+    while (received < total) {
+        if (lockFree) {
+            while (ring.TryPop(sound)) {
+                received++;
+            }
+        }
+        else {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (!locked.empty()) {
+                locked.pop_front();
+                received++;
+            }
+        }
+    }
+    double seconds = (double)(NowNs() - start) / 1e9;
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    std::vector<uint64_t> all;
+    for (const std::vector<uint64_t>& mine : latencies) {
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    Result result;
+    result.items = received;
+    result.seconds = seconds;
+    Summarise(all, result);
+    return result;
+}
+
+void PrintResult(const char* name, const Result& result, bool last) {
+    printf("    \"%s\": { \"items\": %llu, \"seconds\": %.4f, \"items_per_sec\": %.0f, \"push_p50_us\": %.3f, \"push_p99_us\": %.3f, "
+           "\"push_p999_us\": %.3f, \"push_max_us\": %.1f }%s\n",
+        name, (unsigned long long)result.items, result.seconds, result.seconds > 0 ? (double)result.items / result.seconds : 0.0,
+        (double)result.p50 / 1e3, (double)result.p99 / 1e3, (double)result.p999 / 1e3, (double)result.max / 1e3, last ? "" : ",");
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--queue spsc|mpsc] [--items n] [--rate lines/s] [--frame-ms n] [--producers n] [--capacity n] [--runs n]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--queue") opt.queue = value;
+        else if (arg == "--items") opt.items = atoi(value);
+        else if (arg == "--rate") opt.rate = atoi(value);
+        else if (arg == "--frame-ms") opt.frameMs = atoi(value);
+        else if (arg == "--producers") opt.producers = atoi(value);
+        else if (arg == "--capacity") opt.capacity = atoi(value);
+        else if (arg == "--runs") opt.runs = atoi(value);
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((opt.queue != "spsc" && opt.queue != "mpsc") || opt.items < 1 || opt.rate < 1 || opt.frameMs < 0 || opt.producers < 1 ||
+        opt.items < opt.producers || opt.capacity < 2 || opt.runs < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    bool spsc = opt.queue == "spsc";
+    Result best[2];
+    for (int lockFree = 0; lockFree < 2; lockFree++) {
+        for (int run = 0; run < opt.runs; run++) {
+            Result result = spsc ? RunSpsc(opt, lockFree != 0) : RunMpsc(opt, lockFree != 0);
+            if (run == 0 || result.max < best[lockFree].max) {
+                best[lockFree] = result;
+            }
+        }
+    }
+
+    printf("{\n");
+    printf("  \"queue\": \"%s\",\n  \"items\": %d,\n  \"capacity\": %d,\n", opt.queue.c_str(), opt.items, opt.capacity);
+    if (spsc) {
+        printf("  \"rate\": %d,\n  \"frame_ms\": %d,\n", opt.rate, opt.frameMs);
+    }
+    else {
+        printf("  \"producers\": %d,\n", opt.producers);
+    }
+    printf("  \"results\": {\n");
+    PrintResult("mutex", best[0], false);
+    PrintResult(spsc ? "spsc" : "mpsc", best[1], true);
+    printf("  }\n}\n");
+    return 0;
+}
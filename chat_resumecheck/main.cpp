@@ -0,0 +1,382 @@
+// this is a check that a reconnecting client neither loses nor duplicates a line in either direction
+// it starts chat_server with --kick-interval, so the server drops every sequenced connection that often, then:
+//   alice  a plain connection (not sequenced, so never kicked) sends --lines numbered lines "m <i>" at --rate lines
+//          per second
+//   bob    a ChatClient that is kicked over and over while the burst comes in, it resumes its session every time
+//          and sends --own numbered lines of its own through SendGlobal() meanwhile, some with a '\n' inside
+// bob must show every line of alice exactly once and in order, alice must receive every line of bob exactly once and
+// in order, bob must not have told the user that anything went missing and he must have been kicked at least once
+// every run starts a fresh server, --server none uses the one already listening on --port instead
+// the results are printed as JSON on stdout and the exit code is non zero when a run lost or duplicated a line
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "chat_client.h"
+#include "chat_framer.h"
+#include "chat_protocol.h"
+#include "chat_socket.h"
+
+namespace {
+
+struct Options {
+    std::string server = "../chat_server/chat_server";
+    int port = 0;            // 0 picks a free one for the server we start
+    int kickIntervalMs = 100;
+    int lines = 20000;
+    int rate = 10000;        // alice's lines per second, so the burst spans a good number of kicks
+    int own = 200;
+    int runs = 3;
+    int timeoutMs = 60000;   // per run
+};
+
+uint64_t NowMs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// a loopback port nobody listens on right now
+int FreePort() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    int port = 0;
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) == 0 && getsockname(fd, (sockaddr*)&address, &length) == 0) {
+        port = ntohs(address.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+// starts the server and waits until it takes connections, returns its pid or -1
+pid_t StartServer(const Options& opt, int port) {
+    std::string portText = std::to_string(port);
+    std::string kickText = std::to_string(opt.kickIntervalMs);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        execl(opt.server.c_str(), opt.server.c_str(), "--port", portText.c_str(), "--kick-interval", kickText.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    if (pid < 0) {
+        return -1;
+    }
+    for (int attempt = 0; attempt < 100; attempt++) {
+        ChatSocket probe = ConnectTcp("127.0.0.1", (uint16_t)port, 1000);
+        if (probe != CHAT_INVALID_SOCKET) {
+            CloseSocket(probe);
+            return pid;
+        }
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    return -1;
+}
+
+void StopServer(pid_t pid) {
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+// bob's line i, every tenth one has a line break inside that has to arrive as a space
+std::string OwnLine(int i) {
+    return i % 10 == 0 ? "b " + std::to_string(i) + "\nsecond half" : "b " + std::to_string(i);
+}
+
+std::string OwnLineReceived(int i) {
+    return i % 10 == 0 ? "b " + std::to_string(i) + " second half" : "b " + std::to_string(i);
+}
+
+// counts numbered lines as they come: next is the one we wait for, anything else is a gap or a duplicate
+struct Sequence {
+    int next = 0;
+    int duplicates = 0;
+    int gaps = 0;
+    int garbled = 0; // the right number with the wrong text
+
+    void See(int value, bool textOk) {
+        if (value == next) {
+            next++;
+            garbled += !textOk;
+        }
+        else if (value < next) {
+            duplicates++;
+        }
+        else {
+            gaps++;
+            next = value + 1;
+        }
+    }
+};
+
+// parses the number after prefix, -1 when the text does not start with it
+int Numbered(std::string_view text, std::string_view prefix) {
+    if (text.substr(0, prefix.size()) != prefix) {
+        return -1;
+    }
+    return atoi(std::string(text.substr(prefix.size(), 12)).c_str());
+}
+
+// alice's side: a plain blocking connection, a thread reads everything the server sends her
+class PlainUser {
+public:
+    bool Join(int port, const std::string& username) {
+        m_socket = ConnectTcp("127.0.0.1", (uint16_t)port, 2000);
+        if (m_socket == CHAT_INVALID_SOCKET) {
+            return false;
+        }
+        std::string join = username + "\n";
+        if (!SendAll(m_socket, join.data(), join.size())) {
+            return false;
+        }
+        m_reader = std::thread(&PlainUser::ReadLoop, this);
+        return true;
+    }
+
+    bool Send(const std::string& text) {
+        std::string frame = FormatGlobalMessage(text);
+        return SendAll(m_socket, frame.data(), frame.size());
+    }
+
+    void Stop() {
+        m_stop = true;
+        if (m_reader.joinable()) {
+            m_reader.join();
+        }
+        if (m_socket != CHAT_INVALID_SOCKET) {
+            CloseSocket(m_socket);
+        }
+    }
+
+    int Received() const { return m_received.load(); }
+    Sequence Result() const { return m_sequence; } // after Stop()
+
+private:
+    void ReadLoop() {
+        LineFramer framer;
+        while (!m_stop) {
+            pollfd pfd{};
+            pfd.fd = m_socket;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, 50) <= 0) {
+                continue;
+            }
+            char* buffer = framer.PrepareWrite(16384);
+            int bytes = RecvSome(m_socket, buffer, 16384);
+            if (bytes <= 0) {
+                return;
+            }
+            framer.CommitWrite((size_t)bytes);
+            FramedLine line;
+            while (framer.NextLine(line)) {
+                ServerMessage message = ParseServerLine(line);
+                const ChatLine* chat = std::get_if<ChatLine>(&message);
+                if (!chat || chat->sender != "bob") {
+                    continue;
+                }
+                int value = Numbered(chat->text, "b ");
+                if (value >= 0) {
+                    m_sequence.See(value, chat->text == OwnLineReceived(value));
+                    m_received++;
+                }
+            }
+        }
+    }
+
+    ChatSocket m_socket = CHAT_INVALID_SOCKET;
+    std::thread m_reader;
+    std::atomic<bool> m_stop{ false };
+    std::atomic<int> m_received{ 0 };
+    Sequence m_sequence; // the reader's until Stop()
+};
+
+struct RunResult {
+    bool started = false;
+    Sequence bobSaw;   // alice's lines as bob shows them
+    Sequence aliceSaw; // bob's lines as alice received them
+    int reconnects = 0;
+    int lossNotices = 0;
+    uint64_t ms = 0;
+    bool timedOut = false;
+
+    bool Ok(const Options& opt) const {
+        return started && !timedOut && reconnects > 0 && bobSaw.next == opt.lines && bobSaw.duplicates == 0 && bobSaw.gaps == 0 && bobSaw.garbled == 0 &&
+            aliceSaw.next == opt.own && aliceSaw.duplicates == 0 && aliceSaw.gaps == 0 && aliceSaw.garbled == 0 && lossNotices == 0;
+    }
+};
+
+RunResult Run(const Options& opt) {
+    RunResult result;
+    int port = opt.port;
+    pid_t server = -1;
+    if (opt.server != "none") {
+        port = port ? port : FreePort();
+        server = StartServer(opt, port);
+        if (server < 0) {
+            fprintf(stderr, "cannot start %s\n", opt.server.c_str());
+            return result;
+        }
+    }
+
+    ChatClient bob;
+    bob.reconnectBaseMs = 20;
+    bob.reconnectMaxMs = 200;
+    PlainUser alice;
+    if (!bob.Connect("127.0.0.1", (uint16_t)port, "bob") || !alice.Join(port, "alice")) {
+        fprintf(stderr, "cannot join: %s\n", bob.LastError().c_str());
+        alice.Stop();
+        bob.Disconnect();
+        StopServer(server);
+        return result;
+    }
+    result.started = true;
+
+    // bob goes through his history as it grows, like a UI would
+    uint64_t seen = 0;
+    ConnectionState last = bob.GetConnectionState();
+    auto pump = [&] {
+        bob.PumpEvents();
+        ConnectionState state = bob.GetConnectionState();
+        if (state != last && state == ConnectionState::Reconnecting) {
+            result.reconnects++;
+        }
+        last = state;
+        const ChatHistory& chat = bob.state.globalChat;
+        for (; seen < chat.TotalCount(); seen++) {
+            const ChatMessage& message = chat[(size_t)(seen - chat.FirstIndex())];
+            if (message.kind == MessageKind::System) {
+                std::string_view text = message.Text();
+                result.lossNotices += text.find("missing") != std::string_view::npos || text.find("did not reach") != std::string_view::npos;
+                continue;
+            }
+            int value = Numbered(message.Text(), "alice: m ");
+            if (value >= 0) {
+                result.bobSaw.See(value, message.Body() == "m " + std::to_string(value));
+            }
+        }
+    };
+
+    // alice's burst with bob's own lines in between, spread over it so they meet the kicks
+    uint64_t start = NowMs();
+    int ownEvery = opt.own > 0 ? std::max(1, opt.lines / opt.own) : 0;
+    int ownSent = 0;
+    for (int i = 0; i < opt.lines; i++) {
+        if (i % 50 == 0) {
+            auto due = std::chrono::milliseconds(start + (uint64_t)i * 1000 / (uint64_t)opt.rate);
+            std::this_thread::sleep_until(std::chrono::steady_clock::time_point(due));
+        }
+        if (!alice.Send("m " + std::to_string(i))) {
+            break;
+        }
+        if (ownEvery && i % ownEvery == 0 && ownSent < opt.own) {
+            bob.SendGlobal(OwnLine(ownSent++));
+        }
+        if (i % 64 == 0) {
+            pump();
+        }
+    }
+    while (ownSent < opt.own) {
+        bob.SendGlobal(OwnLine(ownSent++));
+    }
+
+    uint64_t deadline = start + (uint64_t)opt.timeoutMs;
+    while ((result.bobSaw.next < opt.lines || alice.Received() < opt.own) && NowMs() < deadline) {
+        pump();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    result.timedOut = result.bobSaw.next < opt.lines || alice.Received() < opt.own;
+    result.ms = NowMs() - start;
+    // anything that would arrive twice arrives now, the kicks go on meanwhile
+    std::this_thread::sleep_for(std::chrono::milliseconds(opt.kickIntervalMs * 3));
+    pump();
+
+    alice.Stop();
+    result.aliceSaw = alice.Result();
+    bob.Disconnect();
+    StopServer(server);
+    return result;
+}
+
+void PrintSequence(const char* name, const Sequence& sequence, const char* tail) {
+    printf("\"%s\": { \"in_order\": %d, \"duplicates\": %d, \"gaps\": %d, \"garbled\": %d }%s", name, sequence.next, sequence.duplicates,
+        sequence.gaps, sequence.garbled, tail);
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--server path|none] [--port n] [--kick-interval ms] [--lines n] [--rate n] [--own n] [--runs n] [--timeout-ms n]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--server") opt.server = value;
+        else if (arg == "--port") opt.port = atoi(value);
+        else if (arg == "--kick-interval") opt.kickIntervalMs = atoi(value);
+        else if (arg == "--lines") opt.lines = atoi(value);
+        else if (arg == "--rate") opt.rate = atoi(value);
+        else if (arg == "--own") opt.own = atoi(value);
+        else if (arg == "--runs") opt.runs = atoi(value);
+        else if (arg == "--timeout-ms") opt.timeoutMs = atoi(value);
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.lines < 1 || opt.rate < 1 || opt.own < 0 || opt.runs < 1 || opt.kickIntervalMs < 1 || (opt.server == "none" && opt.port == 0)) {
+        Usage(argv[0]);
+        return 1;
+    }
+    NetStartup();
+
+    bool ok = true;
+    printf("{\n  \"lines\": %d,\n  \"rate\": %d,\n  \"own\": %d,\n  \"kick_interval_ms\": %d,\n  \"runs\": [\n", opt.lines, opt.rate, opt.own,
+        opt.kickIntervalMs);
+    for (int r = 0; r < opt.runs; r++) {
+        RunResult result = Run(opt);
+        ok = ok && result.Ok(opt);
+        printf("    { \"ok\": %s, \"ms\": %llu, \"reconnects\": %d, \"loss_notices\": %d, ", result.Ok(opt) ? "true" : "false",
+            (unsigned long long)result.ms, result.reconnects, result.lossNotices);
+        PrintSequence("bob_saw_alice", result.bobSaw, ", ");
+        PrintSequence("alice_saw_bob", result.aliceSaw, " }");
+        printf("%s\n", r + 1 < opt.runs ? "," : "");
+        fflush(stdout);
+    }
+    printf("  ],\n  \"ok\": %s\n}\n", ok ? "true" : "false");
+    NetCleanup();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+// this is a benchmark of the search over the chat history, it needs neither ImGui nor a server
+// --messages messages of 3 to 14 words are drawn from a --vocabulary word vocabulary with Zipf frequencies, so a few
+// words are in most messages and most words in a few, then
+//   index    a SearchIndex alone takes every message, the build rate of the index
+//   history  a ChatHistory under the retention limits the Windows client sets for the global chat takes every
+//            message, the index plus the ring and the spill file, which is what the client pays per arriving line
+//   queries  every query runs --runs times against the history as ChatClient::Search() does: the index lookup and
+//            then a copy of each of the newest --max-results hits, most of which come back from the spill file
+// --search-messages bounds the index of both to the newest messages as HistoryRetention::searchMessages does, it then
+// compacts itself while it is built and append_max_us shows what the worst of those rewrites costs
+// every query is checked against a brute force scan of the messages, the match count and the ids of the newest hits
+// have to agree and every copied line has to be the one that went in
+// the slowest run of every query has to finish within --target-ms, the exit code is 1 if a query is wrong or too slow
+// the results are printed as JSON on stdout
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat_history.h"
+#include "chat_search.h"
+
+namespace {
+
+struct Options {
+    int messages = 1000000;
+    int vocabulary = 20000;
+    int maxResults = 100; // what the search box of the client asks for
+    int runs = 20;
+    double targetMs = 10;
+    // the global chat limits of the Windows client
+    int maxMessages = 20000;
+    int maxBytes = 8 * 1024 * 1024;
+    std::string spillDirectory;
+    int searchMessages = 0;
+};
+
+// a common word, a mid-frequency pair, a rare word, the three most common words together, a word that never occurs
+// and a query whose case and punctuation the tokenizer has to fold away
+const char* const kQueries[] = {
+    "xylophone", "meeting", "the", "ok", "meeting tomorrow", "the lol ok", "xylophone the", "nosuchword", "MEETING Tomorrow!",
+};
+const size_t kQueryCount = sizeof(kQueries) / sizeof(kQueries[0]);
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// made up words of 2 to 9 letters, with the ones the queries look for planted at fixed ranks
+std::vector<std::string> Vocabulary(int size) {
+    std::vector<std::string> words;
+    for (int i = 0; i < size; i++) {
+        std::string word;
+        uint64_t x = (uint64_t)i * 2654435761u + 7;
+        for (int k = 0; k < 2 + i % 8; k++) {
+            word.push_back((char)('a' + x % 26));
+            x /= 26;
+            if (x == 0) {
+                x = (uint64_t)(i + k + 3);
+            }
+        }
+        words.push_back(word);
+    }
+    const std::pair<int, const char*> planted[] = { { 0, "the" }, { 1, "lol" }, { 2, "ok" }, { 50, "meeting" }, { 51, "tomorrow" }, { 5000, "xylophone" } };
+    for (const auto& entry : planted) {
+        if (entry.first < size) {
+            words[(size_t)entry.first] = entry.second;
+        }
+    }
+    return words;
+}
+
+std::vector<std::string> Bodies(const Options& opt) {
+    std::vector<std::string> vocabulary = Vocabulary(opt.vocabulary);
+    std::vector<double> cdf(vocabulary.size());
+    double sum = 0;
+    for (size_t i = 0; i < cdf.size(); i++) {
+        sum += 1.0 / (double)(i + 1);
+        cdf[i] = sum;
+    }
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> draw(0, sum);
+    std::vector<std::string> bodies((size_t)opt.messages);
+    for (std::string& body : bodies) {
+        int words = 3 + (int)(rng() % 12);
+        for (int k = 0; k < words; k++) {
+            size_t word = std::min(cdf.size() - 1, (size_t)(std::lower_bound(cdf.begin(), cdf.end(), draw(rng)) - cdf.begin()));
+            if (k > 0) {
+                body += ' ';
+            }
+            body += vocabulary[word];
+        }
+    }
+    return bodies;
+}
+
+// what a scan of every message finds for each query: the number of matches and the ids of the newest maxResults
+struct Expected {
+    size_t matches = 0;
+    std::vector<uint64_t> newest; // newest first
+};
+
+std::vector<Expected> BruteForce(const std::vector<std::string>& bodies, size_t maxResults, size_t oldest) {
+    std::string word;
+    std::vector<std::vector<std::string>> queryWords(kQueryCount);
+    for (size_t q = 0; q < kQueryCount; q++) {
+        SearchIndex::Tokenize(kQueries[q], word, [&](const std::string& w) { queryWords[q].push_back(w); });
+    }
+    std::vector<std::vector<uint64_t>> matching(kQueryCount);
+    std::vector<std::string> words;
+    for (size_t m = oldest; m < bodies.size(); m++) {
+        words.clear();
+        SearchIndex::Tokenize(bodies[m], word, [&](const std::string& w) { words.push_back(w); });
+        for (size_t q = 0; q < kQueryCount; q++) {
+            bool all = !queryWords[q].empty();
+            for (const std::string& w : queryWords[q]) {
+                all = all && std::find(words.begin(), words.end(), w) != words.end();
+            }
+            if (all) {
+                matching[q].push_back(m);
+            }
+        }
+    }
+    std::vector<Expected> expected(kQueryCount);
+    for (size_t q = 0; q < kQueryCount; q++) {
+        expected[q].matches = matching[q].size();
+        for (size_t i = matching[q].size(); i > 0 && expected[q].newest.size() < maxResults; i--) {
+            expected[q].newest.push_back(matching[q][i - 1]);
+        }
+    }
+    return expected;
+}
+
+struct QueryResult {
+    size_t matches = 0;
+    size_t hits = 0;
+    bool correct = true;
+    // per run in nanoseconds, the lookup alone and the lookup with the copies of the hits
+    uint64_t searchBest = UINT64_MAX, searchSum = 0, searchWorst = 0;
+    uint64_t totalBest = UINT64_MAX, totalSum = 0, totalWorst = 0;
+};
+
+QueryResult RunQuery(ChatHistory& history, const std::vector<std::string>& bodies, const Options& opt, const char* query, const Expected& expected) {
+    QueryResult result;
+    std::vector<uint64_t> ids;
+    ChatMessage message;
+    std::string line;
+    for (int run = 0; run < opt.runs; run++) {
+        uint64_t t0 = NowNs();
+        result.matches = history.Search(query, (size_t)opt.maxResults, ids);
+        uint64_t t1 = NowNs();
+        bool copied = true;
+        for (uint64_t id : ids) {
+            // the message text points into line, the prefix comes first
+            copied = copied && history.CopyMessage(id, message, line) && id < bodies.size() && line == "user: " + bodies[id];
+        }
+        uint64_t t2 = NowNs();
+        result.correct = result.correct && copied && result.matches == expected.matches && ids == expected.newest;
+        result.searchBest = std::min(result.searchBest, t1 - t0);
+        result.searchWorst = std::max(result.searchWorst, t1 - t0);
+        result.searchSum += t1 - t0;
+        result.totalBest = std::min(result.totalBest, t2 - t0);
+        result.totalWorst = std::max(result.totalWorst, t2 - t0);
+        result.totalSum += t2 - t0;
+    }
+    result.hits = ids.size();
+    return result;
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr,
+        "usage: %s [--messages n] [--vocabulary n] [--max-results n] [--runs n] [--target-ms ms] [--max-messages n] [--max-bytes n] "
+        "[--spill-dir path] [--search-messages n]\n",
+        exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--messages") opt.messages = atoi(value);
+        else if (arg == "--vocabulary") opt.vocabulary = atoi(value);
+        else if (arg == "--max-results") opt.maxResults = atoi(value);
+        else if (arg == "--runs") opt.runs = atoi(value);
+        else if (arg == "--target-ms") opt.targetMs = atof(value);
+        else if (arg == "--max-messages") opt.maxMessages = atoi(value);
+        else if (arg == "--max-bytes") opt.maxBytes = atoi(value);
+        else if (arg == "--spill-dir") opt.spillDirectory = value;
+        else if (arg == "--search-messages") opt.searchMessages = atoi(value);
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    // the planted query words need a vocabulary that reaches rank 5000
+    if (opt.messages < 1 || opt.vocabulary < 5001 || opt.maxResults < 1 || opt.runs < 1 || opt.targetMs <= 0 || opt.maxMessages < 0 ||
+        opt.maxBytes < 0 || opt.searchMessages < 0) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> bodies = Bodies(opt);
+    size_t words = 0;
+    for (const std::string& body : bodies) {
+        words += (size_t)std::count(body.begin(), body.end(), ' ') + 1;
+    }
+
+    SearchIndex index;
+    index.SetHorizon((size_t)opt.searchMessages);
+    uint64_t t0 = NowNs();
+    for (size_t m = 0; m < bodies.size(); m++) {
+        index.Add(m, bodies[m]);
+    }
+    double indexSeconds = (double)(NowNs() - t0) / 1e9;
+    SearchIndex::Stats stats = index.GetStats();
+    index.Clear();
+
+    NameTable names;
+    ChatHistory history;
+    HistoryRetention retention;
+    retention.maxMessages = (size_t)opt.maxMessages;
+    retention.maxBytes = (size_t)opt.maxBytes;
+    retention.spillDirectory = opt.spillDirectory;
+    retention.searchMessages = (size_t)opt.searchMessages;
+    history.SetRetention(retention);
+    ChatMessage message;
+    message.sender = names.Intern("user");
+    uint64_t appendMax = 0;
+    t0 = NowNs();
+    for (const std::string& body : bodies) {
+        uint64_t t1 = NowNs();
+        history.Append(message, "user: ", body);
+        appendMax = std::max(appendMax, NowNs() - t1);
+    }
+    double historySeconds = (double)(NowNs() - t0) / 1e9;
+    SearchIndex::Stats historyStats = history.SearchStats();
+
+    std::vector<Expected> expected = BruteForce(bodies, (size_t)opt.maxResults, historyStats.oldest);
+    std::vector<QueryResult> results;
+    bool correct = true;
+    uint64_t worst = 0;
+    for (size_t q = 0; q < kQueryCount; q++) {
+        results.push_back(RunQuery(history, bodies, opt, kQueries[q], expected[q]));
+        correct = correct && results.back().correct;
+        worst = std::max(worst, results.back().totalWorst);
+    }
+    bool withinTarget = (double)worst / 1e6 <= opt.targetMs;
+
+    printf("{\n");
+    printf("  \"messages\": %d,\n  \"vocabulary\": %d,\n  \"words\": %zu,\n  \"max_results\": %d,\n  \"runs\": %d,\n", opt.messages, opt.vocabulary,
+        words, opt.maxResults, opt.runs);
+    printf("  \"index\": { \"seconds\": %.3f, \"ns_per_message\": %.0f, \"messages_per_sec\": %.0f, \"distinct_words\": %zu, \"postings\": %zu, "
+           "\"posting_bytes\": %zu, \"bytes_per_posting\": %.2f },\n",
+        indexSeconds, indexSeconds * 1e9 / opt.messages, opt.messages / indexSeconds, stats.words, stats.postings, stats.postingBytes,
+        (double)stats.postingBytes / (double)std::max<size_t>(1, stats.postings));
+    printf("  \"history\": { \"max_messages\": %d, \"max_bytes\": %d, \"search_messages\": %d, \"seconds\": %.3f, \"ns_per_message\": %.0f, "
+           "\"append_max_us\": %.1f, \"window\": %zu, \"search_oldest\": %llu, \"search_words\": %zu, \"search_postings\": %zu, "
+           "\"search_posting_bytes\": %zu },\n",
+        opt.maxMessages, opt.maxBytes, opt.searchMessages, historySeconds, historySeconds * 1e9 / opt.messages, (double)appendMax / 1e3,
+        history.size(), (unsigned long long)historyStats.oldest, historyStats.words, historyStats.postings, historyStats.postingBytes);
+    printf("  \"queries\": [\n");
+    for (size_t q = 0; q < kQueryCount; q++) {
+        const QueryResult& result = results[q];
+        printf("    { \"query\": \"%s\", \"matches\": %zu, \"expected\": %zu, \"hits\": %zu, \"correct\": %s, \"search_best_us\": %.1f, "
+               "\"search_mean_us\": %.1f, \"search_worst_us\": %.1f, \"with_copies_best_us\": %.1f, \"with_copies_mean_us\": %.1f, "
+               "\"with_copies_worst_us\": %.1f }%s\n",
+            kQueries[q], result.matches, expected[q].matches, result.hits, result.correct ? "true" : "false", (double)result.searchBest / 1e3,
+            (double)result.searchSum / 1e3 / opt.runs, (double)result.searchWorst / 1e3, (double)result.totalBest / 1e3,
+            (double)result.totalSum / 1e3 / opt.runs, (double)result.totalWorst / 1e3, q + 1 < kQueryCount ? "," : "");
+    }
+    printf("  ],\n");
+    printf("  \"correct\": %s,\n  \"target_ms\": %.1f,\n  \"worst_ms\": %.3f,\n  \"within_target\": %s\n}\n", correct ? "true" : "false", opt.targetMs,
+        (double)worst / 1e6, withinTarget ? "true" : "false");
+    return correct && withinTarget ? 0 : 1;
+}
@@ -0,0 +1,672 @@
+// this is a reference chat server for Linux that speaks exactly the line protocol the client expects
+//   client -> server: "username" as the first message, then "text\n" for the global chat and "DM|target|text\n"
+//   server -> client: "USERS|a,b,c", "DM|sender|text", "SYS|text" and "sender: text", one per line
+// a client that starts with "HELLO|token|lastSeq" gets "SESSION|token|nextSeq|received" back and every history line prefixed with
+// "#<seq> ", its session outlives a dropped connection for a grace period and a reconnect replays the lines it missed
+// a client that lists "udelta" in its HELLO gets one snapshot and then "USERS+|name" and "USERS-|name" deltas,
+// with a "USERS=|count|checksum" line now and then so it can spot a divergence and ask for a snapshot with "USERS|?"
+// it runs on a single thread with edge-triggered epoll and non-blocking sockets so it can hold tens of thousands of connections
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "chat_framer.h"
+#include "chat_protocol.h"
+#include "chat_users.h"
+
+namespace {
+
+// a client that stops reading gets disconnected once this much output is waiting for it
+const size_t kMaxOutboundBytes = 8 * 1024 * 1024;
+
+// a sequenced session keeps this many of its last history lines around for a reconnect to replay
+const size_t kMaxHistoryLines = 4096;
+const size_t kMaxHistoryBytes = 1024 * 1024;
+
+// how long a sequenced user stays in the chat after its connection dropped before we announce that it left
+const std::chrono::seconds kResumeGracePeriod(30);
+
+struct Session;
+
+// one TCP connection, it belongs to a session once the username was accepted
+struct Client {
+    int fd = -1;
+    LineFramer in;
+    std::string out;      // bytes waiting to be written
+    size_t outOffset = 0; // first byte of out that was not written yet
+    Session* session = nullptr;
+    bool closing = false;     // close once the pending output is flushed (rejected logins)
+    bool flushQueued = false; // already listed in g_pendingFlush
+    // what the HELLO line asked for, a client without one gets the plain unsequenced protocol
+    bool hello = false;
+    bool sequenced = false;
+    bool userDeltas = false;
+    std::string resumeToken;
+    uint64_t resumeSeq = 0;
+};
+
+// a user in the chat, for a sequenced client it survives reconnects and buffers the lines sent while it was away
+struct Session {
+    std::string username;
+    Client* client = nullptr; // null while a sequenced session waits to be resumed
+    size_t joinedIndex = 0;   // position in g_joined for O(1) removal
+    bool sequenced = false;
+    std::string token;
+    uint64_t nextSeq = 1;
+    uint64_t linesReceived = 0; // lines this user sent us, a resuming client resends the ones after it
+    std::deque<std::string> history; // the last sequenced lines with their prefix, history.front() carries firstSeq
+    uint64_t firstSeq = 1;
+    size_t historyBytes = 0;
+    std::chrono::steady_clock::time_point detachedAt;
+};
+
+int g_epoll = -1;
+std::unordered_map<int, Client*> g_clients;
+std::unordered_map<std::string, Session*> g_byName; // keyed by the lowercase username
+std::vector<Session*> g_joined;                     // sessions in the order the user list is sent
+std::vector<Session*> g_detached;                   // sequenced sessions whose connection dropped, waiting for a resume
+std::vector<Client*> g_doomed;                      // disconnected clients that Reap() removes at the end of the event batch
+std::vector<Client*> g_dead;                        // reaped clients, deleted once nothing can reference them any more
+std::vector<Client*> g_pendingFlush;                // clients with output queued during the current event batch
+bool g_userListDirty = false; // a snapshot is owed to the clients that do not take deltas
+std::chrono::steady_clock::time_point g_nextUserListPush;
+uint64_t g_userChecksum = 0;     // sum of UserNameHash() over g_joined, kept up to date in O(1)
+bool g_userChecksumDirty = false; // the delta clients have not been sent the current checksum yet
+std::chrono::steady_clock::time_point g_nextUserChecksum;
+std::mt19937_64 g_tokenRandom{ std::random_device{}() };
+
+std::string Lowercase(std::string_view str) {
+    std::string result(str);
+    for (char& c : result) {
+        if (c >= 'A' && c <= 'Z') {
+            c = (char)(c - 'A' + 'a');
+        }
+    }
+    return result;
+}
+
+void Disconnect(Client* client);
+
+// we write as much of the pending output as the socket takes right now, the rest waits for EPOLLOUT
+void Flush(Client* client) {
+    while (client->outOffset < client->out.size()) {
+        ssize_t sent = send(client->fd, client->out.data() + client->outOffset, client->out.size() - client->outOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            client->outOffset += (size_t)sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        Disconnect(client);
+        return;
+    }
+    client->out.clear();
+    client->outOffset = 0;
+    if (client->closing) {
+        Disconnect(client);
+    }
+}
+
+// output is only appended here and written once per event batch by FlushPending()
+// so a client that receives a hundred broadcast lines in one batch costs one send() instead of a hundred
+void Queue(Client* client, std::string_view data) {
+    if (client->fd < 0) {
+        return;
+    }
+    if (client->out.size() - client->outOffset + data.size() > kMaxOutboundBytes) {
+        fprintf(stderr, "dropping slow client %s\n", client->session ? client->session->username.c_str() : "");
+        Disconnect(client);
+        return;
+    }
+    if (!client->flushQueued) {
+        client->flushQueued = true;
+        g_pendingFlush.push_back(client);
+    }
+    client->out.append(data.data(), data.size());
+}
+
+void FlushPending() {
+    // flushing can drop clients, which only adds them to g_doomed, so iterating by index is safe
+    for (size_t i = 0; i < g_pendingFlush.size(); i++) {
+        Client* client = g_pendingFlush[i];
+        client->flushQueued = false;
+        if (client->fd >= 0) {
+            Flush(client);
+        }
+        // we drop the already written prefix so the buffer does not keep growing while the socket is full
+        if (client->outOffset > 0) {
+            client->out.erase(0, client->outOffset);
+            client->outOffset = 0;
+        }
+    }
+    g_pendingFlush.clear();
+}
+
+// every history line for a user goes through here, a sequenced session numbers it and keeps it for a later replay
+void Deliver(Session* session, std::string_view line) {
+    if (!session->sequenced) {
+        if (session->client) {
+            Queue(session->client, line);
+        }
+        return;
+    }
+    std::string framed;
+    framed.reserve(line.size() + 22);
+    framed.append("#").append(std::to_string(session->nextSeq++)).append(" ").append(line);
+    if (session->client) {
+        Queue(session->client, framed);
+    }
+    session->historyBytes += framed.size();
+    session->history.push_back(std::move(framed));
+    while (session->history.size() > kMaxHistoryLines || session->historyBytes > kMaxHistoryBytes) {
+        session->historyBytes -= session->history.front().size();
+        session->history.pop_front();
+        session->firstSeq++;
+    }
+}
+
+void Broadcast(std::string_view line, const Session* except = nullptr) {
+    for (Session* session : g_joined) {
+        if (session != except) {
+            Deliver(session, line);
+        }
+    }
+}
+
+std::string UserListLine() {
+    std::string line = "USERS|";
+    for (size_t i = 0; i < g_joined.size(); i++) {
+        if (i > 0) {
+            line += ',';
+        }
+        line += g_joined[i]->username;
+    }
+    line += '\n';
+    return line;
+}
+
+// the delta clients get their checksum at most this often, and only when the list changed since the last one
+const std::chrono::seconds kUserChecksumInterval(5);
+
+// a USERS| snapshot costs O(users) bytes for each of the users, so a join storm with full snapshots is quadratic
+// we push it at most every 50 ms and stretch the interval so snapshots stay under ~64 MB/s of total output
+// everyone still ends up with the current list and the SYS| join and leave lines are never delayed
+const double kUserListBytesPerSecond = 64.0 * 1024 * 1024;
+
+std::chrono::milliseconds UserListInterval(size_t lineBytes) {
+    double seconds = (double)lineBytes * (double)g_joined.size() / kUserListBytesPerSecond;
+    return std::chrono::milliseconds(50 + (long long)(seconds * 1000.0));
+}
+
+// the user list is rebuilt at most once per interval no matter how many users joined or left in it
+// it is a snapshot and not history, so it is never sequenced and a detached session does not buffer it
+// clients that take deltas already got every change as it happened and are skipped
+void SendUserListIfDirty() {
+    auto now = std::chrono::steady_clock::now();
+    if (!g_userListDirty || now < g_nextUserListPush) {
+        return;
+    }
+    g_userListDirty = false;
+    std::string line;
+    for (Session* session : g_joined) {
+        if (session->client && !session->client->userDeltas) {
+            if (line.empty()) {
+                line = UserListLine();
+            }
+            Queue(session->client, line);
+        }
+    }
+    g_nextUserListPush = now + UserListInterval(line.size());
+}
+
+// one join or leave costs every delta client a single short line instead of the whole list
+void BroadcastUserDelta(std::string_view line, const Session* except = nullptr) {
+    for (Session* session : g_joined) {
+        if (session != except && session->client && session->client->userDeltas) {
+            Queue(session->client, line);
+        }
+    }
+}
+
+void SendUserChecksumIfDirty() {
+    auto now = std::chrono::steady_clock::now();
+    if (!g_userChecksumDirty || now < g_nextUserChecksum) {
+        return;
+    }
+    g_userChecksumDirty = false;
+    char line[64];
+    snprintf(line, sizeof(line), "USERS=|%zu|%016llx\n", g_joined.size(), (unsigned long long)g_userChecksum);
+    BroadcastUserDelta(line);
+    g_nextUserChecksum = now + kUserChecksumInterval;
+}
+
+std::string NewSessionToken() {
+    char token[17];
+    snprintf(token, sizeof(token), "%016llx", (unsigned long long)g_tokenRandom());
+    return token;
+}
+
+void Disconnect(Client* client);
+
+void Attach(Session* session, Client* client) {
+    session->client = client;
+    client->session = session;
+    if (session->sequenced) {
+        Queue(client, "SESSION|" + session->token + "|" + std::to_string(session->nextSeq) + "|" + std::to_string(session->linesReceived) + "\n");
+    }
+}
+
+// a reconnecting client gets the lines after the last one it saw, a fresh user list and is back in the chat
+// nobody else notices, the user never left the user list while its session was detached
+void Resume(Session* session, Client* client) {
+    if (session->client) {
+        // the old connection is half-open, the client already gave up on it
+        Client* old = session->client;
+        old->session = nullptr;
+        Disconnect(old);
+    }
+    g_detached.erase(std::remove(g_detached.begin(), g_detached.end(), session), g_detached.end());
+    Attach(session, client);
+    Queue(client, UserListLine());
+
+    uint64_t from = client->resumeSeq + 1;
+    bool gap = from < session->firstSeq;
+    for (uint64_t seq = std::max(from, session->firstSeq); seq < session->nextSeq; seq++) {
+        Queue(client, session->history[(size_t)(seq - session->firstSeq)]);
+    }
+    if (gap) {
+        Deliver(session, "SYS|Some messages were lost while you were away\n");
+    }
+}
+
+void Join(Client* client, std::string_view requested) {
+    std::string_view name = trimView(requested);
+    // the name ends up inside USERS| and DM| lines so it must not contain the protocol separators
+    // and a leading '#' would look like the sequence prefix of a chat line
+    if (name.empty() || name.size() > 63 || name[0] == '#' || name.find_first_of("|,:\n") != std::string_view::npos) {
+        Queue(client, "SYS|Invalid username\n");
+        client->closing = true;
+        return;
+    }
+    std::string key = Lowercase(name);
+    auto it = g_byName.find(key);
+    if (it != g_byName.end()) {
+        Session* existing = it->second;
+        if (client->sequenced && existing->sequenced && !client->resumeToken.empty() && client->resumeToken == existing->token) {
+            Resume(existing, client);
+            return;
+        }
+        Queue(client, "SYS|Username already taken\n");
+        client->closing = true;
+        return;
+    }
+
+    Session* session = new Session();
+    session->username.assign(name);
+    session->sequenced = client->sequenced;
+    if (session->sequenced) {
+        session->token = NewSessionToken();
+    }
+    session->joinedIndex = g_joined.size();
+    g_joined.push_back(session);
+    g_byName[key] = session;
+    g_userListDirty = true;
+    g_userChecksum += UserNameHash(session->username);
+    g_userChecksumDirty = true;
+    Attach(session, client);
+    if (client->userDeltas) {
+        // a delta client starts from a snapshot that already includes itself
+        Queue(client, UserListLine());
+    }
+    BroadcastUserDelta("USERS+|" + session->username + "\n", session);
+
+    Broadcast("SYS|" + session->username + " joined the chat\n");
+}
+
+// the user really leaves: out of the user list, everyone is told and the buffered history is gone
+void RemoveSession(Session* session) {
+    // we swap the last session into the hole so removal stays O(1)
+    Session* last = g_joined.back();
+    g_joined[session->joinedIndex] = last;
+    last->joinedIndex = session->joinedIndex;
+    g_joined.pop_back();
+    g_byName.erase(Lowercase(session->username));
+    g_userListDirty = true;
+    g_userChecksum -= UserNameHash(session->username);
+    g_userChecksumDirty = true;
+    BroadcastUserDelta("USERS-|" + session->username + "\n");
+    Broadcast("SYS|" + session->username + " left the chat\n");
+    delete session;
+}
+
+// sessions that were not resumed within the grace period leave the chat for good
+void ExpireSessions() {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < g_detached.size();) {
+        Session* session = g_detached[i];
+        if (now - session->detachedAt < kResumeGracePeriod) {
+            i++;
+            continue;
+        }
+        g_detached[i] = g_detached.back();
+        g_detached.pop_back();
+        RemoveSession(session);
+    }
+}
+
+void HandleLine(Client* client, std::string_view line) {
+    Session* session = client->session;
+    session->linesReceived++;
+    ClientMessage message = ParseClientLine(line);
+    if (const DirectRequest* dm = std::get_if<DirectRequest>(&message)) {
+        // a detached target is still online, the message waits in its history until it resumes
+        auto it = g_byName.find(Lowercase(dm->target));
+        if (it == g_byName.end()) {
+            Deliver(session, "SYS|" + std::string(dm->target) + " is not online\n");
+            return;
+        }
+        std::string packet;
+        packet.reserve(5 + session->username.size() + dm->text.size());
+        packet.append("DM|").append(session->username).append("|").append(dm->text).append("\n");
+        Deliver(it->second, packet);
+    }
+    else if (const GlobalText* global = std::get_if<GlobalText>(&message)) {
+        // the client shows its own messages locally so we do not echo them back
+        std::string packet;
+        packet.reserve(session->username.size() + 3 + global->text.size());
+        packet.append(session->username).append(": ").append(global->text).append("\n");
+        Broadcast(packet, session);
+    }
+    else if (std::holds_alternative<UserListRequest>(message)) {
+        Queue(client, UserListLine());
+    }
+}
+
+void HandleReadable(Client* client) {
+    while (client->fd >= 0) {
+        char* buffer = client->in.PrepareWrite(16384);
+        ssize_t bytes = recv(client->fd, buffer, 16384, 0);
+        if (bytes > 0) {
+            client->in.CommitWrite((size_t)bytes);
+            std::string_view line;
+            while (client->fd >= 0 && client->in.NextLine(line)) {
+                if (client->closing) {
+                    // a rejected login only waits for its error line to be flushed
+                    continue;
+                }
+                if (client->session) {
+                    HandleLine(client, line);
+                    continue;
+                }
+                HelloRequest hello;
+                if (!client->hello && ParseHello(line, hello)) {
+                    client->hello = true;
+                    client->sequenced = hello.sequenced;
+                    client->userDeltas = hello.userDeltas;
+                    client->resumeToken.assign(hello.token);
+                    client->resumeSeq = hello.lastSeq;
+                    continue;
+                }
+                Join(client, line);
+            }
+            // an older client sends its username without a newline, so whatever arrived first is the name
+            // unless it could still turn into a HELLO line, a client that sent HELLO terminates its username
+            std::string_view partial;
+            if (client->fd >= 0 && !client->session && !client->closing && !client->hello && client->in.PeekPartial(partial)) {
+                std::string_view hello = "HELLO|";
+                if (hello.substr(0, std::min(hello.size(), partial.size())) != partial.substr(0, std::min(hello.size(), partial.size()))) {
+                    client->in.TakePartial(line);
+                    Join(client, line);
+                }
+            }
+            continue;
+        }
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        Disconnect(client);
+        return;
+    }
+}
+
+// we only close the socket here, the client stays in the user list until Reap() runs at the end of the event batch
+// so a broadcast that finds a slow client never changes g_joined while it iterates over it
+void Disconnect(Client* client) {
+    if (client->fd < 0) {
+        return;
+    }
+    epoll_ctl(g_epoll, EPOLL_CTL_DEL, client->fd, nullptr);
+    close(client->fd);
+    g_clients.erase(client->fd);
+    client->fd = -1;
+    g_doomed.push_back(client);
+}
+
+// we remove disconnected users and tell everyone they left, a sequenced session is only detached and waits for a resume
+// announcing a leave can drop more slow clients so we repeat until nothing is left to do
+void Reap() {
+    auto now = std::chrono::steady_clock::now();
+    while (!g_doomed.empty()) {
+        std::vector<Client*> doomed;
+        doomed.swap(g_doomed);
+        for (Client* client : doomed) {
+            Session* session = client->session;
+            g_dead.push_back(client);
+            if (!session) {
+                continue;
+            }
+            client->session = nullptr;
+            session->client = nullptr;
+            if (session->sequenced) {
+                session->detachedAt = now;
+                g_detached.push_back(session);
+                continue;
+            }
+            RemoveSession(session);
+        }
+    }
+}
+
+// a reaped client can still sit in g_pendingFlush, so it is only freed after the last flush of the batch
+void FreeDead() {
+    for (Client* client : g_dead) {
+        delete client;
+    }
+    g_dead.clear();
+}
+
+// for testing reconnects: drops the connection of every sequenced client, their sessions stay and get resumed
+void KickSequencedClients() {
+    for (Session* session : g_joined) {
+        if (session->sequenced && session->client) {
+            Disconnect(session->client);
+        }
+    }
+}
+
+void AcceptAll(int listener) {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                fprintf(stderr, "accept: out of file descriptors with %zu clients\n", g_clients.size());
+            }
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Client* client = new Client();
+        client->fd = fd;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = client;
+        if (epoll_ctl(g_epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            delete client;
+            continue;
+        }
+        g_clients[fd] = client;
+    }
+}
+
+// every connection needs a descriptor so we ask for as many as the hard limit allows
+void RaiseFileLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        printf("file descriptor limit: %llu\n", (unsigned long long)limit.rlim_cur);
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    const char* bindAddress = "127.0.0.1";
+    int port = 65432;
+    int kickIntervalMs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            bindAddress = argv[++i];
+        }
+        else if (strcmp(argv[i], "--kick-interval") == 0 && i + 1 < argc) {
+            kickIntervalMs = atoi(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "usage: %s [--bind address] [--port port] [--kick-interval ms]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    RaiseFileLimit();
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, bindAddress, &addr.sin_addr) != 1) {
+        fprintf(stderr, "invalid bind address %s\n", bindAddress);
+        return 1;
+    }
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        perror("bind/listen");
+        return 1;
+    }
+
+    g_epoll = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = nullptr; // a null pointer marks the listening socket
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, listener, &ev);
+    printf("chat server listening on %s:%d\n", bindAddress, port);
+
+    std::vector<epoll_event> events(1024);
+    auto nextKick = std::chrono::steady_clock::now() + std::chrono::milliseconds(kickIntervalMs);
+    while (true) {
+        // clients dropped by the last flush, a pending user list push, a session running out of grace
+        // and the next test kick bound how long we may sleep
+        auto now = std::chrono::steady_clock::now();
+        auto wakeAt = std::chrono::steady_clock::time_point::max();
+        if (g_userListDirty) {
+            wakeAt = g_nextUserListPush;
+        }
+        if (g_userChecksumDirty) {
+            wakeAt = std::min(wakeAt, g_nextUserChecksum);
+        }
+        for (Session* session : g_detached) {
+            wakeAt = std::min(wakeAt, session->detachedAt + kResumeGracePeriod);
+        }
+        if (kickIntervalMs > 0) {
+            wakeAt = std::min(wakeAt, nextKick);
+        }
+        int timeoutMs = -1;
+        if (!g_doomed.empty()) {
+            timeoutMs = 0;
+        }
+        else if (wakeAt != std::chrono::steady_clock::time_point::max()) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(wakeAt - now);
+            timeoutMs = (int)std::max<long long>(0, wait.count() + 1);
+        }
+        int count = epoll_wait(g_epoll, events.data(), (int)events.size(), timeoutMs);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            Client* client = static_cast<Client*>(events[i].data.ptr);
+            if (!client) {
+                AcceptAll(listener);
+                continue;
+            }
+            if (client->fd < 0) {
+                continue;
+            }
+            uint32_t flags = events[i].events;
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                // reading first lets us consume the last lines a client sent before it hung up
+                HandleReadable(client);
+            }
+            if (client->fd >= 0 && (flags & EPOLLOUT)) {
+                Flush(client);
+            }
+        }
+        if (kickIntervalMs > 0 && std::chrono::steady_clock::now() >= nextKick) {
+            KickSequencedClients();
+            nextKick = std::chrono::steady_clock::now() + std::chrono::milliseconds(kickIntervalMs);
+        }
+        SendUserListIfDirty();
+        SendUserChecksumIfDirty();
+        FlushPending();
+        Reap();
+        ExpireSessions();
+        FlushPending();
+        FreeDead();
+    }
+
+    close(listener);
+    close(g_epoll);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+
+// the tests are plain programs: CHECK() reports a condition that does not hold and carries on, so one run shows
+// every failure, and main() returns TestResult() which is non zero when any of them failed
+
+inline int& TestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);  \
+            TestFailures()++;                                                              \
+        }                                                                                  \
+    } while (0)
+
+inline int TestResult(const char* name) {
+    if (TestFailures() != 0) {
+        printf("%s: %d checks failed\n", name, TestFailures());
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
@@ -0,0 +1,231 @@
+// ChatClient against a scripted fake server on loopback, for what a real server does not do on purpose:
+//   a second SESSION line on the same connection drops the link instead of restarting the writer thread
+//   a resume from further back than the client kept its written frames tells the user how many lines were lost
+//   a line break inside a message goes out as a space, so the server counts one line per message
+//   a DM window opened before its first message arrives still holds its conversation to dmRetention
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "chat_client.h"
+#include "chat_framer.h"
+#include "chat_socket.h"
+#include "chat_test.h"
+
+namespace {
+
+// one accepted connection of the fake server, read line by line
+class FakeConnection {
+public:
+    explicit FakeConnection(int listener) : m_fd(accept(listener, nullptr, nullptr)) {
+        timeval timeout{ 5, 0 };
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    ~FakeConnection() {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    bool ReadLine(std::string& line) {
+        std::string_view view;
+        while (!m_framer.NextLine(view)) {
+            char* buffer = m_framer.PrepareWrite(4096);
+            ssize_t bytes = recv(m_fd, buffer, 4096, 0);
+            if (bytes <= 0) {
+                return false;
+            }
+            m_framer.CommitWrite((size_t)bytes);
+        }
+        line.assign(view);
+        return true;
+    }
+
+    void Send(std::string_view text) { SendAll(m_fd, text.data(), text.size()); }
+
+private:
+    int m_fd;
+    LineFramer m_framer;
+};
+
+int Listen(uint16_t& port) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(listener, (sockaddr*)&address, sizeof(address));
+    listen(listener, 4);
+    getsockname(listener, (sockaddr*)&address, &length);
+    port = ntohs(address.sin_port);
+    return listener;
+}
+
+// waits for cond while pumping the client like a UI
+template <typename Cond>
+bool PumpUntil(ChatClient& client, Cond cond, int timeoutMs = 5000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!cond()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        client.PumpEvents();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool HasSystemLine(const ChatHistory& history, std::string_view text) {
+    for (size_t i = 0; i < history.size(); i++) {
+        if (history[i].kind == MessageKind::System && history[i].Text().find(text) != std::string_view::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RepeatedSession() {
+    uint16_t port;
+    int listener = Listen(port);
+    std::atomic<bool> reconnected{ false };
+    std::thread server([&] {
+        std::string line;
+        {
+            FakeConnection first(listener);
+            first.ReadLine(line); // HELLO
+            first.ReadLine(line); // username
+            first.Send("SESSION|tok|1|0\nSESSION|tok|1|0\n");
+            // the client hangs up on the second one
+            while (first.ReadLine(line)) {
+            }
+        }
+        FakeConnection second(listener);
+        reconnected = second.ReadLine(line) && line.rfind("HELLO|tok|", 0) == 0;
+        second.ReadLine(line);
+        second.Send("SESSION|tok|1|0\n");
+        while (second.ReadLine(line)) {
+        }
+    });
+
+    ChatClient client;
+    client.reconnectBaseMs = 10;
+    client.reconnectMaxMs = 20;
+    CHECK(client.Connect("127.0.0.1", port, "bob"));
+    CHECK(PumpUntil(client, [&] { return reconnected && client.GetConnectionState() == ConnectionState::Connected; }));
+    client.Disconnect();
+    server.join();
+    close(listener);
+}
+
+void LostFrames() {
+    const int sent = 5000;
+    const int kept = 4096; // the frames ChatClient keeps for a resend
+    uint16_t port;
+    int listener = Listen(port);
+    std::atomic<int> firstLines{ 0 };
+    std::atomic<int> resent{ 0 };
+    std::atomic<bool> oneLinePerMessage{ true };
+    std::thread server([&] {
+        std::string line;
+        {
+            FakeConnection first(listener);
+            first.ReadLine(line);
+            first.ReadLine(line);
+            first.Send("SESSION|tok|1|0\n");
+            while (firstLines < sent && first.ReadLine(line)) {
+                oneLinePerMessage = oneLinePerMessage && line == "line " + std::to_string(firstLines) + " with a break";
+                firstLines++;
+            }
+        }
+        // we claim to have none of them, far more than the client kept
+        FakeConnection second(listener);
+        second.ReadLine(line);
+        second.ReadLine(line);
+        second.Send("SESSION|tok|1|0\n");
+        while (resent < kept && second.ReadLine(line)) {
+            oneLinePerMessage = oneLinePerMessage && line == "line " + std::to_string(sent - kept + resent) + " with a break";
+            resent++;
+        }
+        while (second.ReadLine(line)) {
+        }
+    });
+
+    ChatClient client;
+    client.reconnectBaseMs = 10;
+    client.reconnectMaxMs = 20;
+    CHECK(client.Connect("127.0.0.1", port, "bob"));
+    for (int i = 0; i < sent; i++) {
+        CHECK(client.SendGlobal("line " + std::to_string(i) + "\nwith a break"));
+    }
+    std::string notice = "Reconnected, " + std::to_string(sent - kept) + " messages you sent";
+    CHECK(PumpUntil(client, [&] { return resent == kept && HasSystemLine(client.state.globalChat, notice); }));
+    client.Disconnect();
+    server.join();
+    close(listener);
+    CHECK(firstLines == sent);
+    CHECK(resent == kept);
+    CHECK(oneLinePerMessage);
+    // what we show for our own line is what went out
+    CHECK(client.state.globalChat[0].Text() == "bob: line 0 with a break");
+}
+
+void DmWindowFirst() {
+    const int received = 300;
+    uint16_t port;
+    int listener = Listen(port);
+    std::atomic<bool> send{ false };
+    std::thread server([&] {
+        std::string line;
+        FakeConnection connection(listener);
+        connection.ReadLine(line);
+        connection.ReadLine(line);
+        connection.Send("SESSION|tok|1|0\n");
+        while (!send) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::string lines;
+        for (int i = 0; i < received; i++) {
+            lines += "DM|alice|line " + std::to_string(i) + "\n";
+        }
+        connection.Send(lines);
+        while (connection.ReadLine(line)) {
+        }
+    });
+
+    ChatClient client;
+    client.dmRetention.maxMessages = 100;
+    CHECK(client.Connect("127.0.0.1", port, "bob"));
+    // the user opens the window from the user list before alice wrote anything, as ChatUi does
+    client.state.openDMs.insert("alice");
+    ChatHistory& history = client.DirectHistory("alice");
+    CHECK(history.empty());
+    send = true;
+    CHECK(PumpUntil(client, [&] { return history.TotalCount() == (uint64_t)received; }));
+    CHECK(&client.DirectHistory("alice") == &history);
+    CHECK(history.size() <= 100);
+    CHECK(history.AtTail());
+    CHECK(history[history.size() - 1].Text() == "alice: line " + std::to_string(received - 1));
+    client.Disconnect();
+    server.join();
+    close(listener);
+}
+
+}
+
+int main() {
+    NetStartup();
+    RepeatedSession();
+    LostFrames();
+    DmWindowFirst();
+    NetCleanup();
+    return TestResult("test_client");
+}
@@ -0,0 +1,267 @@
+// FrameScheduler and WakeSignal without a window: the scheduling runs on time points the test picks, then an event
+// loop whose only input is the wake-up (it sleeps in WakeSignal::Wait(), a poll() on the eventfd) shows that an idle
+// loop blocks without drawing, that a wake-up from another thread ends the wait and draws DataFrames frames, that a
+// frame asked for at a time is drawn once it is due and not before, and that no wake-up is lost however the notifies
+// and the loop interleave, including a notify that lands inside Consume()
+// the Win32 loop waits in MsgWaitForMultipleObjectsEx() on the event handle instead, nothing here covers that path
+
+#include <poll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#include "chat_frame.h"
+#include "chat_test.h"
+
+namespace {
+
+using Clock = FrameScheduler::Clock;
+using std::chrono::milliseconds;
+
+// a guard so a lost wake-up fails the test instead of hanging it
+const int kGuardMs = 2000;
+
+void Settle() {
+    FrameScheduler frames;
+    Clock::time_point now{};
+    // the first frames draw the window at all
+    for (int i = 0; i < FrameScheduler::SettleFrames; i++) {
+        CHECK(frames.TimeoutMs(now) == 0);
+        CHECK(frames.BeginFrame(now));
+    }
+    CHECK(frames.TimeoutMs(now) == -1);
+    CHECK(!frames.BeginFrame(now));
+    CHECK(frames.FramesDrawn() == (uint64_t)FrameScheduler::SettleFrames);
+
+    // a smaller request does not cut a larger one short
+    frames.RequestFrames();
+    frames.RequestFrames(FrameScheduler::DataFrames);
+    for (int i = 0; i < FrameScheduler::SettleFrames; i++) {
+        CHECK(frames.BeginFrame(now));
+    }
+    CHECK(!frames.BeginFrame(now));
+}
+
+void Deadline() {
+    FrameScheduler frames;
+    Clock::time_point start{};
+    while (frames.BeginFrame(start)) {
+    }
+    // the earliest request wins, a later one leaves it alone
+    frames.RequestFrameAt(start + milliseconds(100));
+    frames.RequestFrameAt(start + milliseconds(30));
+    frames.RequestFrameAt(start + milliseconds(200));
+    CHECK(frames.TimeoutMs(start) == 30);
+    // rounded up, so the wait does not end before the frame is due
+    CHECK(frames.TimeoutMs(start + std::chrono::microseconds(29100)) == 1);
+    CHECK(!frames.BeginFrame(start + milliseconds(29)));
+    CHECK(frames.BeginFrame(start + milliseconds(30)));
+    // drawn once, the later requests were folded into it
+    CHECK(frames.TimeoutMs(start + milliseconds(30)) == -1);
+    CHECK(!frames.BeginFrame(start + milliseconds(300)));
+
+    // frames asked for now are drawn first and the timed one still comes after them
+    frames.RequestFrameAt(start + milliseconds(500));
+    frames.RequestFrames(FrameScheduler::DataFrames);
+    for (int i = 0; i < FrameScheduler::DataFrames; i++) {
+        CHECK(frames.BeginFrame(start + milliseconds(400)));
+    }
+    CHECK(frames.TimeoutMs(start + milliseconds(400)) == 100);
+    CHECK(frames.BeginFrame(start + milliseconds(500)));
+
+    // a deadline past what an int of milliseconds holds waits as long as it can
+    frames.RequestFrameAt(start + std::chrono::hours(1000));
+    CHECK(frames.TimeoutMs(start) == INT32_MAX);
+}
+
+void Signal() {
+    WakeSignal wake;
+    CHECK(wake.Fd() >= 0);
+    CHECK(!wake.Wait(0));
+    CHECK(!wake.Consume());
+    // a burst makes one system call and leaves the fd readable for poll() next to the display connection
+    wake.Notify();
+    wake.Notify();
+    wake.Notify();
+    CHECK(wake.Notifies() == 3);
+    CHECK(wake.Signals() == 1);
+    pollfd entry{ wake.Fd(), POLLIN, 0 };
+    CHECK(poll(&entry, 1, 0) == 1);
+    CHECK(wake.Wait(0));
+    CHECK(wake.Consume());
+    CHECK(!wake.Wait(0));
+    CHECK(!wake.Consume());
+    wake.Notify();
+    CHECK(wake.Signals() == 2);
+}
+
+// a Notify() that lands inside Consume(), between clearing the eventfd and the flag, the one interleaving the
+// threaded runs below are unlikely to hit
+void NotifyInsideConsume() {
+    WakeSignal wake;
+    bool notified = false;
+    wake.testHook = [&] {
+        if (!notified) {
+            notified = true;
+            wake.Notify();
+        }
+    };
+    // nothing was set when Consume() began, the notify in the middle is reported and the next wait still returns,
+    // its eventfd write came after the drain, which costs no more than a spurious wake-up
+    CHECK(wake.Consume());
+    CHECK(notified);
+    CHECK(wake.Wait(0));
+    CHECK(!wake.Consume());
+    CHECK(!wake.Wait(0));
+
+    // with the flag already set the notify makes no system call, this Consume() reports it instead
+    notified = false;
+    wake.Notify();
+    CHECK(wake.Consume());
+    CHECK(notified);
+    wake.Consume();
+
+    // either way the signal is not stuck: the next notify wakes a waiter again
+    wake.testHook = nullptr;
+    CHECK(!wake.Wait(0));
+    wake.Notify();
+    CHECK(wake.Wait(0));
+    CHECK(wake.Consume());
+}
+
+// what one turn of the loop did
+struct Turn {
+    bool drawn = false;
+    bool woken = false;   // the wake-up was consumed
+    bool expired = false; // the wait ran into the guard instead of ending for a wake-up or a due frame
+};
+
+// one turn of the loop: wait until a frame is due or the wake-up comes, then draw if a frame is due
+Turn RunTurn(FrameScheduler& frames, WakeSignal& wake) {
+    Turn turn;
+    int timeout = frames.TimeoutMs(Clock::now());
+    if (timeout != 0) {
+        int wait = timeout < 0 ? kGuardMs : std::min(timeout, kGuardMs);
+        turn.expired = !wake.Wait(wait) && (timeout < 0 || timeout > kGuardMs);
+    }
+    turn.woken = wake.Consume();
+    if (turn.woken) {
+        frames.RequestFrames(FrameScheduler::DataFrames);
+    }
+    turn.drawn = frames.BeginFrame(Clock::now());
+    return turn;
+}
+
+void DrainFrames(FrameScheduler& frames, WakeSignal& wake) {
+    while (frames.TimeoutMs(Clock::now()) == 0) {
+        RunTurn(frames, wake);
+    }
+}
+
+void IdleAndWake() {
+    FrameScheduler frames;
+    WakeSignal wake;
+    DrainFrames(frames, wake);
+
+    // nothing asks for a frame, the loop sleeps until the other thread wakes it
+    uint64_t drawn = frames.FramesDrawn();
+    CpuMeter cpu;
+    auto start = Clock::now();
+    std::thread notifier([&] {
+        std::this_thread::sleep_for(milliseconds(200));
+        wake.Notify();
+    });
+    CHECK(RunTurn(frames, wake).drawn);
+    auto woken = Clock::now();
+    double share = cpu.Sample();
+    notifier.join();
+    CHECK(woken - start >= milliseconds(190));
+    CHECK(woken - start < milliseconds(kGuardMs));
+    // a loop that spun instead of blocking would have used the whole core
+    CHECK(share < 0.5);
+    // the wake-up draws the new data and scrolls to it, then the loop is idle again
+    for (int i = 1; i < FrameScheduler::DataFrames; i++) {
+        CHECK(RunTurn(frames, wake).drawn);
+    }
+    CHECK(frames.FramesDrawn() == drawn + FrameScheduler::DataFrames);
+    CHECK(frames.TimeoutMs(Clock::now()) == -1);
+}
+
+void TimedFrame() {
+    FrameScheduler frames;
+    WakeSignal wake;
+    DrainFrames(frames, wake);
+
+    // the loop sleeps until the frame is due and draws it once
+    auto start = Clock::now();
+    frames.RequestFrameAt(start + milliseconds(50));
+    CHECK(RunTurn(frames, wake).drawn);
+    CHECK(Clock::now() - start >= milliseconds(50));
+    CHECK(frames.TimeoutMs(Clock::now()) == -1);
+
+    // a wake-up ends the wait for a frame far away, which stays asked for
+    start = Clock::now();
+    frames.RequestFrameAt(start + std::chrono::seconds(10));
+    std::thread notifier([&] {
+        std::this_thread::sleep_for(milliseconds(20));
+        wake.Notify();
+    });
+    CHECK(RunTurn(frames, wake).drawn);
+    notifier.join();
+    CHECK(Clock::now() - start < milliseconds(kGuardMs));
+    DrainFrames(frames, wake);
+    CHECK(frames.TimeoutMs(Clock::now()) > 9000);
+}
+
+// the notifier publishes its work before Notify() and the loop only reads it after a Consume() that found the signal
+// set, as the front-ends do with the client's events, a wake-up that got lost leaves the loop waiting with work
+// pending until the guard expires
+void NoLostWake() {
+    const uint64_t count = 20000;
+    FrameScheduler frames;
+    WakeSignal wake;
+    std::atomic<uint64_t> produced{ 0 };
+    std::thread notifier([&] {
+        for (uint64_t i = 1; i <= count; i++) {
+            produced.store(i, std::memory_order_release);
+            wake.Notify();
+            // now and then the loop catches up and goes to sleep before the next one
+            if (i % 64 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    });
+    uint64_t seen = 0;
+    int expired = 0;
+    while (seen < count && expired == 0) {
+        Turn turn = RunTurn(frames, wake);
+        expired += turn.expired;
+        if (turn.woken) {
+            seen = produced.load(std::memory_order_acquire);
+        }
+    }
+    notifier.join();
+    CHECK(expired == 0);
+    CHECK(seen == count);
+    CHECK(wake.Notifies() == count);
+    CHECK(wake.Signals() <= count);
+    printf("test_frame: %llu notifies made %llu system calls and %llu frames\n", (unsigned long long)wake.Notifies(),
+        (unsigned long long)wake.Signals(), (unsigned long long)frames.FramesDrawn());
+}
+
+}
+
+int main() {
+    Settle();
+    Deadline();
+    Signal();
+    NotifyInsideConsume();
+    IdleAndWake();
+    TimedFrame();
+    NoLostWake();
+    return TestResult("test_frame");
+}
@@ -0,0 +1,135 @@
+// ChatLog on a scratch directory: a restarted client carries on in the newest segment instead of starting another one,
+// the retention by segment count and by bytes deletes the oldest segments, and what is left still loads in order
+// the segments are kept tiny and the sync interval at 0 so a few hundred records go through many segments
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "chat_log.h"
+#include "chat_test.h"
+
+namespace {
+
+const size_t kSegmentBytes = 4096;
+
+struct Segments {
+    size_t count = 0;
+    uint64_t bytes = 0;
+};
+
+Segments OnDisk(const std::filesystem::path& directory) {
+    Segments segments;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        segments.count++;
+        segments.bytes += entry.file_size();
+    }
+    return segments;
+}
+
+std::string Body(int i) {
+    return "message " + std::to_string(i) + " with a few more words to fill the segments up";
+}
+
+// appends [from, to) with the index as the timestamp, the writer thread flushes every record as it comes with an
+// interval of 0, so each lands in a batch of its own and the segments fill up record by record
+void AppendRange(ChatLog& log, int from, int to) {
+    for (int i = from; i < to; i++) {
+        ChatMessage message;
+        message.timestamp = i;
+        log.Append(i % 3 ? "" : "bob", "alice", message, "alice: ", Body(i));
+        // the writer takes the record before the next one comes, so no batch spans more than one record
+        while (log.GetStats().recordsWritten < (uint64_t)(i - from + 1)) {
+            usleep(100);
+        }
+    }
+}
+
+// the records LoadTail() gives back have to be the newest ones up to last, oldest first and without a gap
+bool TailInOrder(ChatLog& log, size_t max, int last, size_t& loaded) {
+    // the views are only valid during the visit, so we keep copies
+    std::vector<int64_t> timestamps;
+    std::vector<std::string> bodies;
+    loaded = log.LoadTail(max, [&](const LoggedMessage& logged) {
+        timestamps.push_back(logged.message.timestamp);
+        bodies.emplace_back(logged.message.Body());
+    });
+    bool ok = loaded == timestamps.size();
+    for (size_t i = 0; i < timestamps.size(); i++) {
+        int64_t expected = last - (int64_t)timestamps.size() + (int64_t)i;
+        ok = ok && timestamps[i] == expected && bodies[i] == Body((int)expected);
+    }
+    return ok;
+}
+
+void Reopen(const std::filesystem::path& directory) {
+    // ten short runs with a record each go on in the same segment
+    for (int run = 0; run < 10; run++) {
+        ChatLog log;
+        CHECK(log.Open(directory.string(), LogRetention(), kSegmentBytes, 0));
+        size_t loaded = 0;
+        CHECK(TailInOrder(log, 100, run, loaded));
+        CHECK(loaded == (size_t)run);
+        AppendRange(log, run, run + 1);
+        log.Close();
+    }
+    CHECK(OnDisk(directory).count == 1);
+}
+
+void BySegments(const std::filesystem::path& directory) {
+    LogRetention retention;
+    retention.maxSegments = 3;
+    ChatLog log;
+    CHECK(log.Open(directory.string(), retention, kSegmentBytes, 0));
+    AppendRange(log, 0, 400);
+    log.Close();
+    ChatLog::Stats stats = log.GetStats();
+    Segments segments = OnDisk(directory);
+    CHECK(segments.count == 3);
+    CHECK(stats.segmentsRemoved > 0 && stats.segments == stats.segmentsRemoved + 3);
+
+    // what is left starts at a record boundary and runs to the last one
+    ChatLog reopened;
+    CHECK(reopened.Open(directory.string(), retention, kSegmentBytes, 0));
+    size_t loaded = 0;
+    CHECK(TailInOrder(reopened, 1000, 400, loaded));
+    CHECK(loaded > 0 && loaded < 400);
+    // a later run keeps to the limit as well
+    AppendRange(reopened, 400, 500);
+    reopened.Close();
+    CHECK(OnDisk(directory).count == 3);
+}
+
+void ByBytes(const std::filesystem::path& directory) {
+    LogRetention retention;
+    retention.maxBytes = 5 * kSegmentBytes;
+    ChatLog log;
+    CHECK(log.Open(directory.string(), retention, kSegmentBytes, 0));
+    AppendRange(log, 0, 400);
+    log.Close();
+    // the newest segment runs over kSegmentBytes by at most the record that did not fit
+    Segments segments = OnDisk(directory);
+    CHECK(segments.bytes <= retention.maxBytes + 256);
+    CHECK(segments.count >= 4 && segments.count <= 5);
+
+    ChatLog reopened;
+    CHECK(reopened.Open(directory.string(), retention, kSegmentBytes, 0));
+    size_t loaded = 0;
+    CHECK(TailInOrder(reopened, 1000, 400, loaded));
+    reopened.Close();
+}
+
+}
+
+int main() {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / ("chat_test_log_" + std::to_string(getpid()));
+    std::filesystem::remove_all(root);
+    Reopen(root / "reopen");
+    BySegments(root / "segments");
+    ByBytes(root / "bytes");
+    std::filesystem::remove_all(root);
+    return TestResult("test_log");
+}
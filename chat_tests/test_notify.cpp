@@ -0,0 +1,154 @@
+// NotificationPolicy on time points the test picks, so every case is exact and nothing waits:
+//   a storm of global lines plays one sound per window, counted from the sound and not from the last line
+//   every DM peer has a window of its own, a busy peer does not hold back another one
+//   the global chat cannot take the voices reserved for DMs, our own sends always play, a voice is free again once
+//   voiceLength has passed since its sound started
+//   the map of DM peers is pruned as it grows without forgetting a peer whose window is still open
+//   sends noted from another thread take their voices the next time the policy is asked
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "chat_notify.h"
+#include "chat_test.h"
+
+namespace {
+
+using Clock = NotificationPolicy::Clock;
+using std::chrono::milliseconds;
+
+const Clock::time_point kStart{};
+
+Clock::time_point At(int ms) {
+    return kStart + milliseconds(ms);
+}
+
+void GlobalStorm() {
+    // 500 lines 10 ms apart, the default window of 2 s lets the ones at 0, 2000 and 4000 ms through
+    NotificationPolicy policy;
+    int played = 0;
+    for (int i = 0; i < 500; i++) {
+        bool allowed = policy.Allow(NotificationSound::Message, {}, At(i * 10));
+        CHECK(allowed == (i * 10 % 2000 == 0));
+        played += allowed;
+    }
+    CHECK(played == 3);
+    NotificationPolicy::Stats stats = policy.GetStats();
+    CHECK(stats.allowed == 3);
+    CHECK(stats.coalesced == 497);
+    CHECK(stats.voiceLimited == 0);
+}
+
+void PerConversation() {
+    NotificationPolicy policy;
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "alice", At(0)));
+    CHECK(!policy.Allow(NotificationSound::DirectMessage, "alice", At(500)));
+    // another peer and the global chat are windows of their own
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "bob", At(500)));
+    CHECK(policy.Allow(NotificationSound::Message, {}, At(600)));
+    CHECK(!policy.Allow(NotificationSound::DirectMessage, "alice", At(1999)));
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "alice", At(2000)));
+    NotificationPolicy::Stats stats = policy.GetStats();
+    CHECK(stats.allowed == 4);
+    CHECK(stats.coalesced == 2);
+}
+
+void Voices() {
+    // no window, so only the voices hold anything back
+    NotificationPolicy::Config config;
+    config.maxVoices = 2;
+    config.dmReservedVoices = 1;
+    config.window = milliseconds(0);
+    config.voiceLength = milliseconds(1000);
+    NotificationPolicy policy(config);
+
+    CHECK(policy.Allow(NotificationSound::Message, {}, At(0)));
+    // the second voice is the DMs'
+    CHECK(!policy.Allow(NotificationSound::Message, {}, At(1)));
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "bob", At(2)));
+    // both voices play now
+    CHECK(!policy.Allow(NotificationSound::DirectMessage, "eve", At(3)));
+    // a send plays anyway
+    CHECK(policy.Allow(NotificationSound::Send, {}, At(4)));
+    // the voice of the global line is free at 1000 ms, but bob's plays until 1002 ms and the global chat may not
+    // take the last one
+    CHECK(!policy.Allow(NotificationSound::Message, {}, At(1001)));
+    CHECK(policy.Allow(NotificationSound::Message, {}, At(1003)));
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "eve", At(1004)));
+    NotificationPolicy::Stats stats = policy.GetStats();
+    CHECK(stats.allowed == 5);
+    CHECK(stats.coalesced == 0);
+    CHECK(stats.voiceLimited == 3);
+}
+
+void Config() {
+    // a configuration that reserves every voice for DMs keeps one for the global chat
+    NotificationPolicy::Config config;
+    config.maxVoices = 1;
+    config.dmReservedVoices = 1;
+    config.window = milliseconds(0);
+    NotificationPolicy policy(config);
+    CHECK(policy.Allow(NotificationSound::Message, {}, At(0)));
+    CHECK(!policy.Allow(NotificationSound::DirectMessage, "bob", At(1)));
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "bob", At(1000)));
+}
+
+void ManyPeers() {
+    NotificationPolicy::Config config;
+    config.maxVoices = 16;
+    config.voiceLength = milliseconds(1);
+    NotificationPolicy policy(config);
+    // a new peer every 100 ms, more than enough to prune the map many times over
+    int played = 0;
+    for (int i = 0; i < 1000; i++) {
+        played += policy.Allow(NotificationSound::DirectMessage, "user" + std::to_string(i), At(i * 100));
+    }
+    CHECK(played == 1000);
+    // the peers of the last 2 s survived the pruning and are still held back, the older ones play again
+    int last = 999 * 100;
+    CHECK(!policy.Allow(NotificationSound::DirectMessage, "user999", At(last + 500)));
+    CHECK(!policy.Allow(NotificationSound::DirectMessage, "user985", At(last + 500)));
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "user0", At(last + 500)));
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "user900", At(last + 500)));
+}
+
+void NotedSends() {
+    NotificationPolicy::Config config;
+    config.maxVoices = 2;
+    config.dmReservedVoices = 1;
+    config.window = milliseconds(0);
+    config.voiceLength = milliseconds(1000);
+    NotificationPolicy policy(config);
+
+    // the UI thread sends at 0 ms and holds the one voice the global chat may use until 1000 ms, bob the other until 1020 ms
+    std::thread ui([&] { CHECK(policy.NoteSend(At(0))); });
+    ui.join();
+    CHECK(!policy.Allow(NotificationSound::Message, {}, At(10)));
+    CHECK(policy.Allow(NotificationSound::DirectMessage, "bob", At(20)));
+    CHECK(policy.Allow(NotificationSound::Message, {}, At(1020)));
+    NotificationPolicy::Stats stats = policy.GetStats();
+    CHECK(stats.allowed == 3);
+    CHECK(stats.voiceLimited == 1);
+
+    // a burst larger than the queue is counted as far as it fits, the sends past it still played but take no voice
+    int noted = 0;
+    for (size_t i = 0; i < NotificationPolicy::SendQueueCapacity + 10; i++) {
+        noted += policy.NoteSend(At(3000));
+    }
+    CHECK(noted == (int)NotificationPolicy::SendQueueCapacity);
+    CHECK(!policy.Allow(NotificationSound::DirectMessage, "eve", At(3001)));
+    CHECK(policy.GetStats().allowed == 3 + NotificationPolicy::SendQueueCapacity);
+}
+
+}
+
+int main() {
+    GlobalStorm();
+    PerConversation();
+    Voices();
+    Config();
+    ManyPeers();
+    NotedSends();
+    return TestResult("test_notify");
+}
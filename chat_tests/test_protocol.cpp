@@ -0,0 +1,184 @@
+// ParseServerLine() classifies every kind of server line into views over the framer's buffer, this checks what it
+// finds and that framing and parsing a burst performs no heap allocation at all
+// the allocations are counted by replacing the global operator new, as example_null does for its frames
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "chat_framer.h"
+#include "chat_protocol.h"
+#include "chat_test.h"
+
+namespace {
+
+std::atomic<uint64_t> g_newCalls{ 0 };
+
+}
+
+// out of line, once inlined into the library code GCC takes the free() below for a mismatch with the new that
+// allocated the block
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace {
+
+// one of every line the server sends, with and without a sequence number, and a few it sends by mistake
+const char kLines[] =
+    "#41 alice: hello there\n"
+    "#42 DM|bob|are you there|still?\n"
+    "USERS| alice , bob,,carol \n"
+    "#43 USERS+|dave\n"
+    "#44 USERS-| bob \n"
+    "USERS=|3|1f2e\n"
+    "SESSION|abc123|45|7\n"
+    "#45 SYS|  carol joined the chat \n"
+    "no colon in this one\n"
+    "DM|missing separator\n"
+    "ok\n"
+    "   \n";
+
+struct Counts {
+    int empty = 0;
+    int users = 0;
+    int userNames = 0;
+    int added = 0;
+    int removed = 0;
+    int checksum = 0;
+    int dm = 0;
+    int system = 0;
+    int chat = 0;
+    int session = 0;
+    int sequenced = 0;
+    int wrong = 0; // a field that was not what the line said
+};
+
+// only compares views, so it does not allocate either
+void Inspect(const ServerMessage& message, uint64_t seq, Counts& counts) {
+    counts.sequenced += seq != 0;
+    if (std::holds_alternative<std::monostate>(message)) {
+        counts.empty++;
+    }
+    else if (const UsersUpdate* users = std::get_if<UsersUpdate>(&message)) {
+        counts.users++;
+        int index = 0;
+        ForEachUserName(*users, [&](std::string_view name) {
+            const std::string_view expected[] = { "alice", "bob", "carol" };
+            counts.wrong += index >= 3 || name != expected[index];
+            index++;
+        });
+        counts.userNames += index;
+    }
+    else if (const UserAdded* added = std::get_if<UserAdded>(&message)) {
+        counts.added++;
+        counts.wrong += added->name != "dave" || seq != 43;
+    }
+    else if (const UserRemoved* removed = std::get_if<UserRemoved>(&message)) {
+        counts.removed++;
+        counts.wrong += removed->name != "bob" || seq != 44;
+    }
+    else if (const UserListChecksum* sum = std::get_if<UserListChecksum>(&message)) {
+        counts.checksum++;
+        counts.wrong += sum->count != 3 || sum->checksum != 0x1f2e;
+    }
+    else if (const DirectMessage* dm = std::get_if<DirectMessage>(&message)) {
+        counts.dm++;
+        counts.wrong += dm->sender != "bob" || dm->text != "are you there|still?" || seq != 42;
+    }
+    else if (const SystemNotice* notice = std::get_if<SystemNotice>(&message)) {
+        counts.system++;
+        counts.wrong += notice->text != "carol joined the chat" || seq != 45;
+    }
+    else if (const ChatLine* chat = std::get_if<ChatLine>(&message)) {
+        counts.chat++;
+        if (chat->sender.empty()) {
+            counts.wrong += chat->text != "no colon in this one";
+        }
+        else {
+            counts.wrong += chat->sender != "alice" || chat->text != "hello there" || chat->line != "alice: hello there" || seq != 41;
+        }
+    }
+    else if (const SessionInfo* session = std::get_if<SessionInfo>(&message)) {
+        counts.session++;
+        counts.wrong += session->token != "abc123" || session->nextSeq != 45 || session->received != 7;
+    }
+}
+
+void CheckCounts(const Counts& counts, int repeat) {
+    CHECK(counts.wrong == 0);
+    CHECK(counts.chat == 2 * repeat);
+    CHECK(counts.dm == repeat);
+    CHECK(counts.users == repeat);
+    CHECK(counts.userNames == 3 * repeat);
+    CHECK(counts.added == repeat);
+    CHECK(counts.removed == repeat);
+    CHECK(counts.checksum == repeat);
+    CHECK(counts.session == repeat);
+    CHECK(counts.system == repeat);
+    // the malformed DM, the two character line and the blank one
+    CHECK(counts.empty == 3 * repeat);
+    CHECK(counts.sequenced == 5 * repeat);
+}
+
+}
+
+int main() {
+    const int repeat = 1000;
+    std::string burst;
+    for (int i = 0; i < repeat; i++) {
+        burst += kLines;
+    }
+
+    // the framer's buffer and delimiter index grow while the burst goes in, that is the receive side and counted apart
+    LineFramer framer;
+    framer.Append(burst.data(), burst.size());
+
+    // the framed path ReceiveLoop() takes, using the delimiters the scan found
+    Counts counts;
+    uint64_t before = g_newCalls.load();
+    FramedLine line;
+    while (framer.NextLine(line)) {
+        uint64_t seq = 0;
+        ServerMessage message = ParseServerLine(line, seq);
+        Inspect(message, seq, counts);
+    }
+    uint64_t allocations = g_newCalls.load() - before;
+    CHECK(allocations == 0);
+    CheckCounts(counts, repeat);
+
+    // the plain view path, which searches the line itself
+    Counts plain;
+    before = g_newCalls.load();
+    std::string_view rest = burst;
+    while (!rest.empty()) {
+        size_t newline = rest.find('\n');
+        uint64_t seq = 0;
+        std::string_view text = StripSequence(rest.substr(0, newline), seq);
+        Inspect(ParseServerLine(text), seq, plain);
+        rest.remove_prefix(newline + 1);
+    }
+    uint64_t plainAllocations = g_newCalls.load() - before;
+    CHECK(plainAllocations == 0);
+    CheckCounts(plain, repeat);
+
+    printf("test_protocol: %d lines parsed, %llu allocations framed, %llu plain\n", repeat * 12,
+        (unsigned long long)allocations, (unsigned long long)plainAllocations);
+    return TestResult("test_protocol");
+}
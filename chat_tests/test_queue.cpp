@@ -0,0 +1,145 @@
+// SpscQueue and MpscQueue under real contention: every value arrives exactly once, in the order its producer pushed
+// it, and a full ring refuses a push instead of overwriting a slot the consumer has not taken yet
+// the rings are kept small so the producers keep running into a full ring and the consumer into an empty one
+// "make tsan" builds this test with -fsanitize=thread as test_queue_tsan, which has to run without a report
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chat_mpsc.h"
+#include "chat_spsc.h"
+#include "chat_test.h"
+
+namespace {
+
+// heap strings, so a slot read before the producer finished writing it shows up as garbage or under TSan
+std::string Item(uint64_t i) {
+    return "message number " + std::to_string(i) + " padded past the small string buffer";
+}
+
+void Spsc(uint64_t count) {
+    SpscQueue<std::string> queue(64);
+    CHECK(queue.Capacity() == 64);
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < count; i++) {
+            std::string item = Item(i);
+            while (!queue.TryPush(std::move(item))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t wrong = 0;
+    std::string item;
+    for (uint64_t i = 0; i < count;) {
+        if (queue.TryPop(item)) {
+            wrong += item != Item(i);
+            i++;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(wrong == 0);
+    CHECK(!queue.TryPop(item));
+    CHECK(queue.SizeApprox() == 0);
+}
+
+void SpscFull() {
+    SpscQueue<int> queue(3); // rounded up to 4
+    CHECK(queue.Capacity() == 4);
+    for (int i = 0; i < 4; i++) {
+        int value = i;
+        CHECK(queue.TryPush(std::move(value)));
+    }
+    int value = 4;
+    CHECK(!queue.TryPush(std::move(value)));
+    CHECK(queue.SizeApprox() == 4);
+    int popped = -1;
+    CHECK(queue.TryPop(popped) && popped == 0);
+    CHECK(queue.TryPush(std::move(value)));
+    for (int i = 1; i <= 4; i++) {
+        CHECK(queue.TryPop(popped) && popped == i);
+    }
+    CHECK(!queue.TryPop(popped));
+}
+
+// every value carries its producer in the top bits and its position in that producer's sequence in the rest
+void Mpsc(int producers, uint64_t perProducer) {
+    MpscQueue<uint64_t> queue(64);
+    std::atomic<uint64_t> full{ 0 };
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (uint64_t i = 0; i < perProducer; i++) {
+                uint64_t value = ((uint64_t)p << 48) | i;
+                while (!queue.TryPush(std::move(value))) {
+                    full.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    std::vector<uint64_t> next((size_t)producers, 0);
+    uint64_t wrong = 0;
+    uint64_t value;
+    for (uint64_t received = 0; received < perProducer * (uint64_t)producers;) {
+        if (queue.TryPop(value)) {
+            size_t p = (size_t)(value >> 48);
+            if (p < next.size()) {
+                wrong += (value & 0xffffffffffffull) != next[p];
+                next[p]++;
+            }
+            else {
+                wrong++;
+            }
+            received++;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(wrong == 0);
+    for (uint64_t n : next) {
+        CHECK(n == perProducer);
+    }
+    CHECK(!queue.TryPop(value));
+    // a run where the producers never found the ring full did not test much
+    printf("test_queue: %d producers ran into a full ring %llu times\n", producers, (unsigned long long)full.load());
+}
+
+void MpscFull() {
+    MpscQueue<int> queue(4);
+    for (int i = 0; i < 4; i++) {
+        int value = i;
+        CHECK(queue.TryPush(std::move(value)));
+    }
+    int value = 4;
+    CHECK(!queue.TryPush(std::move(value)));
+    int popped = -1;
+    CHECK(queue.TryPop(popped) && popped == 0);
+    CHECK(queue.TryPush(std::move(value)));
+    for (int i = 1; i <= 4; i++) {
+        CHECK(queue.TryPop(popped) && popped == i);
+    }
+    CHECK(!queue.TryPop(popped));
+}
+
+}
+
+int main(int argc, char** argv) {
+    // TSan slows every access down a lot, the tsan build passes a smaller count
+    uint64_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    SpscFull();
+    MpscFull();
+    Spsc(count);
+    Mpsc(4, count / 4);
+    return TestResult("test_queue");
+}
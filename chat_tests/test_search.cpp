@@ -0,0 +1,119 @@
+// SearchIndex with a horizon against a brute force scan: a search returns exactly the matches among the newest
+// messages whatever state the compaction passes are in, the words only older messages had are forgotten, and
+// lowering the horizon drops the older postings right away
+// the vocabulary is small so every word keeps coming back and the posting lists have old and new ids side by side
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chat_search.h"
+#include "chat_test.h"
+
+namespace {
+
+const size_t kVocabulary = 40;
+
+std::string Word(size_t i) {
+    return "w" + std::to_string(i);
+}
+
+// 3 to 7 words of the vocabulary, the same ones for the same id
+std::string Body(uint64_t id) {
+    uint32_t seed = (uint32_t)id * 2654435761u + 1;
+    std::string body;
+    for (int k = 0; k < 3 + (int)(id % 5); k++) {
+        seed = seed * 1664525u + 1013904223u;
+        body += Word((seed >> 8) % kVocabulary) + ' ';
+    }
+    return body;
+}
+
+bool Contains(const std::string& body, const std::string& word) {
+    return (" " + body).find(" " + word + " ") != std::string::npos;
+}
+
+// every word and a two word query against a scan of the messages from oldest to last
+bool Agrees(const SearchIndex& index, uint64_t oldest, uint64_t last) {
+    bool ok = true;
+    std::vector<uint64_t> results;
+    for (size_t w = 0; w < kVocabulary; w += 7) {
+        std::string a = Word(w);
+        std::string b = Word((w + 3) % kVocabulary);
+        for (const std::string& query : { a, a + " " + b }) {
+            std::vector<uint64_t> expected;
+            for (uint64_t id = last + 1; id-- > oldest;) {
+                std::string body = Body(id);
+                if (Contains(body, a) && (query == a || Contains(body, b))) {
+                    expected.push_back(id);
+                }
+            }
+            size_t matches = index.Search(query, SIZE_MAX, results);
+            ok = ok && matches == expected.size() && results == expected;
+        }
+    }
+    return ok;
+}
+
+void Horizon() {
+    const size_t horizon = 1000;
+    SearchIndex index;
+    index.SetHorizon(horizon);
+    index.Add(0, "onlyhere " + Body(0));
+    for (uint64_t id = 1; id < 10000; id++) {
+        index.Add(id, Body(id));
+        // a few points in every pass, before, while and after it rewrites the lists
+        if (id % 97 == 0 || id == horizon || id == horizon + 1) {
+            uint64_t oldest = id + 1 > horizon ? id + 1 - horizon : 0;
+            CHECK(Agrees(index, oldest, id));
+            CHECK(index.GetStats().oldest == oldest);
+        }
+    }
+    std::vector<uint64_t> results;
+    CHECK(index.Search("onlyhere", 10, results) == 0);
+    SearchIndex::Stats stats = index.GetStats();
+    CHECK(stats.messages == 10000);
+    // the word of message 0 is gone, the vocabulary is all that is left
+    CHECK(stats.words == kVocabulary);
+    // at most the horizon and the half of one that waits for the next pass
+    size_t words = 0;
+    for (uint64_t id = 10000 - horizon * 3 / 2; id < 10000; id++) {
+        words += 3 + id % 5;
+    }
+    CHECK(stats.postings <= words);
+
+    // a smaller horizon is compacted to right away
+    index.SetHorizon(100);
+    stats = index.GetStats();
+    CHECK(stats.oldest == 9900);
+    CHECK(Agrees(index, 9900, 9999));
+    size_t postings = 0;
+    for (uint64_t id = 9900; id < 10000; id++) {
+        std::string body = Body(id);
+        for (size_t w = 0; w < kVocabulary; w++) {
+            postings += Contains(body, Word(w));
+        }
+    }
+    CHECK(stats.postings == postings);
+}
+
+void NoHorizon() {
+    SearchIndex index;
+    for (uint64_t id = 0; id < 3000; id++) {
+        index.Add(id, Body(id));
+    }
+    CHECK(index.GetStats().oldest == 0);
+    CHECK(Agrees(index, 0, 2999));
+    index.Clear();
+    std::vector<uint64_t> results;
+    CHECK(index.Search(Word(0), 10, results) == 0);
+    CHECK(index.GetStats().words == 0);
+}
+
+}
+
+int main() {
+    Horizon();
+    NoHorizon();
+    return TestResult("test_search");
+}
@@ -0,0 +1,106 @@
+// ConnectWithTimeout() over a list of addresses falls through to the next one when an address refuses or never
+// answers, as when "localhost" resolves to ::1 first and the server only listens on 127.0.0.1
+// the addresses are put together by hand so the test does not depend on how this machine resolves localhost
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chat_socket.h"
+#include "chat_test.h"
+
+namespace {
+
+long long MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the addresses host resolves to, appended to list
+void Add(std::vector<ChatAddress>& list, const char* host, uint16_t port) {
+    std::vector<ChatAddress> addresses;
+    if (ResolveAddress(host, port, addresses)) {
+        list.insert(list.end(), addresses.begin(), addresses.end());
+    }
+}
+
+}
+
+int main() {
+    NetStartup();
+
+    // a server on IPv4 loopback only, like chat_server
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    CHECK(bind(listener, (sockaddr*)&address, sizeof(address)) == 0);
+    CHECK(listen(listener, 4) == 0);
+    CHECK(getsockname(listener, (sockaddr*)&address, &length) == 0);
+    uint16_t port = ntohs(address.sin_port);
+
+    // every result comes back, at least one of them IPv4 for localhost
+    std::vector<ChatAddress> local;
+    CHECK(ResolveAddress("localhost", port, local));
+    bool hasIPv4 = false;
+    for (const ChatAddress& a : local) {
+        hasIPv4 = hasIPv4 || a.storage.ss_family == AF_INET;
+    }
+    CHECK(hasIPv4);
+    std::string error;
+    std::vector<ChatAddress> none;
+    CHECK(!ResolveAddress("no-such-host.invalid", port, none, &error));
+    CHECK(none.empty() && !error.empty());
+
+    // ::1 refuses (or cannot even be used without IPv6), 127.0.0.1 takes the connection
+    std::vector<ChatAddress> refusedFirst;
+    Add(refusedFirst, "::1", port);
+    Add(refusedFirst, "127.0.0.1", port);
+    CHECK(refusedFirst.size() == 2);
+    auto start = std::chrono::steady_clock::now();
+    ChatSocket s = ConnectWithTimeout(refusedFirst, 2000);
+    CHECK(s != CHAT_INVALID_SOCKET);
+    CHECK(MsSince(start) < 500);
+    if (s != CHAT_INVALID_SOCKET) {
+        CloseSocket(s);
+    }
+
+    // an address that never answers gets half of the time, the server after it still connects in time
+    std::vector<ChatAddress> silentFirst;
+    Add(silentFirst, "10.255.255.1", port);
+    Add(silentFirst, "127.0.0.1", port);
+    CHECK(silentFirst.size() == 2);
+    start = std::chrono::steady_clock::now();
+    s = ConnectWithTimeout(silentFirst, 2000);
+    long long silentMs = MsSince(start);
+    CHECK(s != CHAT_INVALID_SOCKET);
+    CHECK(silentMs < 1500);
+    if (s != CHAT_INVALID_SOCKET) {
+        CloseSocket(s);
+    }
+
+    // the same through ConnectTcp(), which resolves and tries every address
+    s = ConnectTcp("localhost", port, 2000);
+    CHECK(s != CHAT_INVALID_SOCKET);
+    if (s != CHAT_INVALID_SOCKET) {
+        CloseSocket(s);
+    }
+
+    // nothing listening anywhere fails with the reason of the last address
+    close(listener);
+    error.clear();
+    s = ConnectWithTimeout(refusedFirst, 2000, nullptr, &error);
+    CHECK(s == CHAT_INVALID_SOCKET);
+    CHECK(!error.empty());
+    CHECK(ConnectWithTimeout(std::vector<ChatAddress>(), 100, nullptr, &error) == CHAT_INVALID_SOCKET);
+
+    printf("test_socket: a silent first address cost %lld ms of 2000\n", silentMs);
+    NetCleanup();
+    return TestResult("test_socket");
+}
@@ -0,0 +1,62 @@
+#include "chat_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+TextArena::TextArena(size_t firstChunkSize, size_t maxChunkSize)
+    : m_firstChunkSize(firstChunkSize), m_maxChunkSize(std::max(firstChunkSize, maxChunkSize)), m_nextChunkSize(firstChunkSize) {
+}
+
+char* TextArena::Reserve(size_t length) {
+    // even an empty string gets a position inside a chunk, ReleaseBefore() relies on every view pointing into one
+    if (m_chunks.empty() || m_chunks.back().size - m_chunks.back().used < std::max<size_t>(length, 1)) {
+        // the tail of the current chunk is left unused, with chat sized lines that is a few hundred bytes per chunk
+        Chunk chunk;
+        chunk.size = std::max(m_nextChunkSize, length + 1);
+        chunk.data.reset(new char[chunk.size]);
+        m_chunks.push_back(std::move(chunk));
+        m_nextChunkSize = std::min(m_nextChunkSize * 2, m_maxChunkSize);
+    }
+    Chunk& chunk = m_chunks.back();
+    char* out = chunk.data.get() + chunk.used;
+    chunk.used += length;
+    return out;
+}
+
+std::string_view TextArena::Store(std::string_view first, std::string_view second) {
+    size_t length = first.size() + second.size();
+    char* out = Reserve(length);
+    if (!first.empty()) {
+        memcpy(out, first.data(), first.size());
+    }
+    if (!second.empty()) {
+        memcpy(out + first.size(), second.data(), second.size());
+    }
+    return std::string_view(out, length);
+}
+
+void TextArena::ReleaseBefore(const char* text) {
+    // chunks are in the order they were filled, so everything in front of the one holding text is older
+    while (m_chunks.size() > 1) {
+        const Chunk& front = m_chunks.front();
+        if (text >= front.data.get() && text < front.data.get() + front.size) {
+            break;
+        }
+        m_chunks.pop_front();
+    }
+}
+
+void TextArena::Clear() {
+    m_chunks.clear();
+    m_nextChunkSize = m_firstChunkSize;
+}
+
+TextArena::Stats TextArena::GetStats() const {
+    Stats stats;
+    stats.chunks = m_chunks.size();
+    for (const Chunk& chunk : m_chunks) {
+        stats.bytesReserved += chunk.size;
+        stats.bytesUsed += chunk.used;
+    }
+    return stats;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string_view>
+
+// TextArena is an append-only store for message text, text goes into large chunks that never move,
+// so a view handed out by Store() stays valid until the chunk holding it is released
+// a chat history releases whole chunks from the front when it drops its oldest messages, there is no per-message free
+// the first chunk is small so a DM window with three lines does not cost a full chunk, each new chunk doubles up to
+// maxChunkSize and a message longer than that gets a chunk of its own
+class TextArena {
+public:
+    explicit TextArena(size_t firstChunkSize = 4 * 1024, size_t maxChunkSize = 256 * 1024);
+
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+    TextArena(TextArena&&) = default;
+    TextArena& operator=(TextArena&&) = default;
+
+    // copies first and second back to back and returns a view of the copy
+    std::string_view Store(std::string_view first, std::string_view second = {});
+
+    // frees every chunk older than the one holding text, text must come from this arena
+    // the history calls it with the text of its oldest message left after an eviction
+    void ReleaseBefore(const char* text);
+    void Clear();
+
+    struct Stats {
+        size_t chunks = 0;
+        size_t bytesReserved = 0; // what the chunks allocated
+        size_t bytesUsed = 0;     // what the stored text fills of them
+    };
+    Stats GetStats() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    char* Reserve(size_t length);
+
+    std::deque<Chunk> m_chunks;
+    size_t m_firstChunkSize;
+    size_t m_maxChunkSize;
+    size_t m_nextChunkSize;
+};
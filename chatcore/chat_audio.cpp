@@ -0,0 +1,142 @@
+#include "chat_audio.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "chat_mmap.h"
+
+namespace {
+
+void PutU16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+void PutU32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+}
+
+bool INotificationAudio::LoadCached(NotificationSound sound, const SampleCache& cache) {
+    return !cache.Samples(sound).empty() && Load(sound, cache.Path(sound));
+}
+
+bool NullNotificationAudio::Load(NotificationSound, const std::string&) {
+    return true;
+}
+
+void NullNotificationAudio::Play(NotificationSound sound) {
+    m_played[(size_t)sound].fetch_add(1, std::memory_order_relaxed);
+}
+
+WavCaptureNotificationAudio::WavCaptureNotificationAudio(std::string path, SampleFormat format, double maxSeconds)
+    : m_path(std::move(path)), m_format(format), m_maxSeconds(maxSeconds) {}
+
+WavCaptureNotificationAudio::~WavCaptureNotificationAudio() {
+    Finish();
+}
+
+bool WavCaptureNotificationAudio::Load(NotificationSound sound, const std::string& path) {
+    MappedFile file;
+    std::vector<int16_t> samples;
+    std::string error;
+    if (!file.Map(path) || !ConvertWav((const uint8_t*)file.data(), file.size(), m_format, samples, error)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sounds[(size_t)sound] = std::move(samples);
+    return true;
+}
+
+bool WavCaptureNotificationAudio::LoadCached(NotificationSound sound, const SampleCache& cache) {
+    const std::vector<int16_t>& samples = cache.Samples(sound);
+    if (samples.empty() || cache.Format().sampleRate != m_format.sampleRate || cache.Format().channels != m_format.channels) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sounds[(size_t)sound] = samples;
+    return true;
+}
+
+void WavCaptureNotificationAudio::Play(NotificationSound sound) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::vector<int16_t>& samples = m_sounds[(size_t)sound];
+    if (m_finished || samples.empty()) {
+        return;
+    }
+    if (!m_started) {
+        m_started = true;
+        m_start = now;
+    }
+    m_played++;
+    size_t channels = m_format.channels;
+    size_t limit = (size_t)(m_maxSeconds * m_format.sampleRate);
+    size_t first = (size_t)(std::chrono::duration<double>(now - m_start).count() * m_format.sampleRate);
+    if (first >= limit) {
+        return;
+    }
+    size_t frames = std::min(samples.size() / channels, limit - first);
+    if (first + frames > m_mixFrames) {
+        m_mixFrames = first + frames;
+        m_mix.resize(m_mixFrames * channels);
+    }
+    int32_t* out = m_mix.data() + first * channels;
+    for (size_t i = 0; i < frames * channels; i++) {
+        out[i] += samples[i];
+    }
+}
+
+bool WavCaptureNotificationAudio::Finish() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_finished) {
+        return false;
+    }
+    m_finished = true;
+
+    uint8_t header[44];
+    uint32_t dataBytes = (uint32_t)(m_mix.size() * 2);
+    uint32_t blockAlign = m_format.channels * 2u;
+    memcpy(header, "RIFF", 4);
+    PutU32(header + 4, 36 + dataBytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    PutU32(header + 16, 16);
+    PutU16(header + 20, 1);
+    PutU16(header + 22, m_format.channels);
+    PutU32(header + 24, m_format.sampleRate);
+    PutU32(header + 28, m_format.sampleRate * blockAlign);
+    PutU16(header + 32, (uint16_t)blockAlign);
+    PutU16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    PutU32(header + 40, dataBytes);
+    std::vector<uint8_t> data(dataBytes);
+    uint8_t* p = data.data();
+    for (int32_t sample : m_mix) {
+        int32_t clamped = std::clamp(sample, -32768, 32767);
+        m_clipped += clamped != sample;
+        PutU16(p, (uint16_t)(int16_t)clamped);
+        p += 2;
+    }
+
+    FILE* out = fopen(m_path.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    bool ok = fwrite(header, 1, sizeof(header), out) == sizeof(header) && (data.empty() || fwrite(data.data(), 1, data.size(), out) == data.size());
+    ok = fclose(out) == 0 && ok;
+    return ok;
+}
+
+uint64_t WavCaptureNotificationAudio::Played() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_played;
+}
+
+uint64_t WavCaptureNotificationAudio::Clipped() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_clipped;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "chat_notify.h"
+#include "chat_samples.h"
+
+// INotificationAudio is what the notification worker plays its sounds on
+// the Windows client plays them with XAudio2, the other implementations below let the whole notification pipeline run
+// (and be timed) on a machine without a sound card or audio daemon
+// the Load functions run on the thread that sets the sink up before the worker starts, ThreadStart(), Play() and
+// ThreadStop() all run on the worker's thread
+class INotificationAudio {
+public:
+    virtual ~INotificationAudio() = default;
+
+    // false when the file cannot be used, that sound stays silent
+    virtual bool Load(NotificationSound sound, const std::string& path) = 0;
+    // the same from a loaded SampleCache, a sink that mixes itself takes the converted samples, the default loads the
+    // file the cache read, provided the cache could read it
+    virtual bool LoadCached(NotificationSound sound, const SampleCache& cache);
+    virtual void Play(NotificationSound sound) = 0;
+
+    // before the first and after the last Play() on the worker thread, XAudio2 needs COM initialised there
+    virtual void ThreadStart() {}
+    virtual void ThreadStop() {}
+};
+
+// NullNotificationAudio plays nothing and only counts, so benchmarks measure the pipeline and not an audio device
+class NullNotificationAudio : public INotificationAudio {
+public:
+    bool Load(NotificationSound sound, const std::string& path) override;
+    void Play(NotificationSound sound) override;
+
+    uint64_t Played(NotificationSound sound) const { return m_played[(size_t)sound].load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<uint64_t>, 3> m_played{};
+};
+
+// WavCaptureNotificationAudio records what the speakers would have played into a WAV file
+// every Play() mixes the sound into a buffer at the position of the moment it was called, counted from the first
+// Play(), so the file shows the timing and the overlap of the sounds as well as how many there were
+// the recording is in format, the sounds are converted to it when they are loaded (see ConvertWav())
+// it is cut off after maxSeconds and written by Finish() or the destructor
+class WavCaptureNotificationAudio : public INotificationAudio {
+public:
+    explicit WavCaptureNotificationAudio(std::string path, SampleFormat format = SampleFormat(), double maxSeconds = 60.0);
+    ~WavCaptureNotificationAudio() override;
+
+    WavCaptureNotificationAudio(const WavCaptureNotificationAudio&) = delete;
+    WavCaptureNotificationAudio& operator=(const WavCaptureNotificationAudio&) = delete;
+
+    bool Load(NotificationSound sound, const std::string& path) override;
+    bool LoadCached(NotificationSound sound, const SampleCache& cache) override;
+    void Play(NotificationSound sound) override;
+
+    // writes the file once, false if it could not be written
+    bool Finish();
+
+    uint64_t Played() const;
+    uint64_t Clipped() const; // mixed samples that had to be clamped to 16 bits
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::string m_path;
+    SampleFormat m_format;
+    double m_maxSeconds;
+    std::array<std::vector<int16_t>, 3> m_sounds;
+
+    mutable std::mutex m_mutex; // Finish() may come from another thread than the plays
+    bool m_started = false;
+    bool m_finished = false;
+    Clock::time_point m_start;
+    std::vector<int32_t> m_mix; // interleaved, wide enough that the overlap only clips once it is written
+    size_t m_mixFrames = 0;     // frames up to the end of the last sound
+    uint64_t m_played = 0;
+    uint64_t m_clipped = 0;
+};
@@ -0,0 +1,675 @@
+#include "chat_client.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string_view>
+#include <variant>
+
+#include "chat_framer.h"
+#include "chat_protocol.h"
+
+namespace {
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// the history entry of a message event, the classification already happened on the receive thread
+ChatMessage EventMessage(const ChatEvent& event, MessageKind kind) {
+    ChatMessage message;
+    message.timestamp = event.timestamp;
+    message.kind = kind;
+    message.flags = event.flags;
+    return message;
+}
+
+}
+
+ChatClient::~ChatClient() {
+    Disconnect();
+}
+
+const char* ConnectionStateName(ConnectionState state) {
+    switch (state) {
+    case ConnectionState::Disconnected: return "Disconnected";
+    case ConnectionState::Resolving: return "Resolving";
+    case ConnectionState::Connecting: return "Connecting";
+    case ConnectionState::Handshaking: return "Joining";
+    case ConnectionState::Connected: return "Connected";
+    case ConnectionState::Reconnecting: return "Reconnecting";
+    case ConnectionState::Failed: return "Failed";
+    }
+    return "";
+}
+
+void ChatClient::BeginConnect(const std::string& host, uint16_t port, const std::string& username, int timeoutMs) {
+    Disconnect();
+    m_cancelConnect = false;
+    m_username = trim(username);
+    m_sessionToken.clear();
+    m_lastSeq = 0;
+    state.globalChat.SetRetention(globalRetention);
+    SetState(ConnectionState::Resolving);
+    m_connectThread = std::thread(&ChatClient::ConnectLoop, this, host, port, username, timeoutMs);
+}
+
+bool ChatClient::OpenLog(const std::string& directory, size_t reloadMessages) {
+    if (!m_log.Open(directory, logRetention)) {
+        return false;
+    }
+    state.globalChat.SetRetention(globalRetention);
+    // the loaded messages go straight into the histories, they are in the log already
+    m_log.LoadTail(reloadMessages, [this](const LoggedMessage& logged) {
+        ChatMessage message = logged.message;
+        message.sender = state.names.Intern(logged.sender);
+        ChatHistory& history = logged.conversation.empty() ? state.globalChat : DirectHistory(std::string(logged.conversation));
+        std::string_view text = message.Text();
+        size_t bodyOffset = std::min<size_t>(message.bodyOffset, text.size());
+        history.Append(message, text.substr(0, bodyOffset), text.substr(bodyOffset));
+        if (!logged.conversation.empty()) {
+            state.openDMs.insert(std::string(logged.conversation));
+        }
+    });
+    return true;
+}
+
+bool ChatClient::Connect(const char* host, uint16_t port, const std::string& username, int timeoutMs) {
+    BeginConnect(host, port, username, timeoutMs);
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    m_stateChanged.wait(lock, [this] {
+        ConnectionState state = m_connectionState.load();
+        return state == ConnectionState::Connected || state == ConnectionState::Failed || state == ConnectionState::Disconnected;
+    });
+    return m_connectionState == ConnectionState::Connected;
+}
+
+std::string ChatClient::LastError() const {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_lastError;
+}
+
+void ChatClient::SetState(ConnectionState state) {
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_connectionState = state;
+    }
+    m_stateChanged.notify_all();
+    if (onUpdate) {
+        onUpdate();
+    }
+}
+
+void ChatClient::Fail(const std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_lastError = error;
+    }
+    m_connected = false;
+    SetState(ConnectionState::Failed);
+}
+
+ChatSocket ChatClient::OpenConnection(const std::string& host, uint16_t port, int timeoutMs, bool reconnecting, std::string& error) {
+    // while reconnecting the UI keeps showing Reconnecting instead of flickering through every step
+    if (!reconnecting) {
+        SetState(ConnectionState::Resolving);
+    }
+    std::vector<ChatAddress> addresses;
+    if (!ResolveAddress(host.c_str(), port, addresses, &error)) {
+        return CHAT_INVALID_SOCKET;
+    }
+    if (!reconnecting) {
+        SetState(ConnectionState::Connecting);
+    }
+    // an IPv6 address that refuses or never answers falls through to the next one, a server may listen on IPv4 only
+    return ConnectWithTimeout(addresses, timeoutMs, &m_cancelConnect, &error);
+}
+
+// sleeps before the next reconnect attempt, returns false when Disconnect() cancelled the wait
+bool ChatClient::WaitBeforeRetry(int attempt) {
+    int ceiling = reconnectBaseMs;
+    for (int i = 0; i < attempt && ceiling < reconnectMaxMs; i++) {
+        ceiling *= 2;
+    }
+    if (ceiling > reconnectMaxMs) {
+        ceiling = reconnectMaxMs;
+    }
+    // we pick the delay from the upper half of the window, enough spread to break up a thundering herd
+    // while still backing off for real on every attempt
+    thread_local std::minstd_rand random((unsigned)std::chrono::steady_clock::now().time_since_epoch().count());
+    int delay = ceiling / 2 + (int)(random() % (unsigned)(ceiling / 2 + 1));
+
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    return !m_stateChanged.wait_for(lock, std::chrono::milliseconds(delay), [this] { return m_cancelConnect.load(); });
+}
+
+// this runs on its own thread so neither DNS nor an unreachable server can freeze the UI
+// after the first successful join it stays around as the receive thread and reconnects whenever the link drops
+void ChatClient::ConnectLoop(std::string host, uint16_t port, std::string username, int timeoutMs) {
+    if (onReceiveThreadStart) {
+        onReceiveThreadStart();
+    }
+
+    int attempt = 0;
+    while (!m_cancelConnect) {
+        bool reconnecting = m_connected.load();
+        std::string error;
+        ChatSocket s = OpenConnection(host, port, timeoutMs, reconnecting, error);
+        if (s == CHAT_INVALID_SOCKET) {
+            if (m_cancelConnect) {
+                break;
+            }
+            if (!reconnecting) {
+                Fail(error);
+                break;
+            }
+            if (!WaitBeforeRetry(attempt++)) {
+                break;
+            }
+            continue;
+        }
+
+        {
+            // Disconnect() sets the cancel flag before it takes this lock, so either it sees our socket or we see the flag
+            std::lock_guard<std::mutex> lock(m_socketMutex);
+            if (m_cancelConnect) {
+                CloseSocket(s);
+                break;
+            }
+            m_socket = s;
+        }
+
+        // the HELLO line asks for sequenced history and names the session we want back, the username follows on its own line
+        if (!reconnecting) {
+            SetState(ConnectionState::Handshaking);
+        }
+        HelloRequest request;
+        request.token = m_sessionToken;
+        request.lastSeq = m_lastSeq;
+        request.sequenced = true;
+        request.userDeltas = true;
+        std::string hello = FormatHello(request);
+        hello.append(trim(username)).append("\n");
+        // the writer only starts once the SESSION line told us which of our frames the server already has
+        LinkResult result = LinkResult::Lost;
+        if (SendAll(s, hello.c_str(), hello.size())) {
+            result = ReceiveLoop(s);
+        }
+        if (m_writerThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_sendMutex);
+                m_stopWriter = true;
+            }
+            m_sendReady.notify_one();
+            m_writerThread.join();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_socketMutex);
+            CloseSocket(m_socket);
+            m_socket = CHAT_INVALID_SOCKET;
+        }
+
+        if (m_cancelConnect) {
+            break;
+        }
+        if (result == LinkResult::Rejected) {
+            break;
+        }
+        if (!m_connected) {
+            // the first connection never got accepted, there is no session we could resume
+            Fail(error.empty() ? "connection closed by the server" : error);
+            break;
+        }
+        // a session that was accepted resets the backoff, so a flapping link starts again from the short delay
+        if (m_connectionState == ConnectionState::Connected) {
+            attempt = 0;
+        }
+        SetState(ConnectionState::Reconnecting);
+        if (!WaitBeforeRetry(attempt++)) {
+            break;
+        }
+    }
+
+    if (onReceiveThreadStop) {
+        onReceiveThreadStop();
+    }
+}
+
+void ChatClient::Disconnect() {
+    // the flag stops the connect thread wherever it is: connecting, sleeping before a retry or in the receive loop
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_cancelConnect = true;
+    }
+    m_stateChanged.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_socketMutex);
+        if (m_socket != CHAT_INVALID_SOCKET) {
+            // shutting the socket down wakes the receive loop up from recv() so the thread can finish
+            ShutdownSocket(m_socket);
+        }
+    }
+    if (m_connectThread.joinable()) {
+        m_connectThread.join();
+    }
+    {
+        // whatever was still queued belongs to the old connection
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_outbound.clear();
+        m_written.clear();
+        m_writtenFirst = 0;
+        m_framesWritten = 0;
+        m_queuedFrames = 0;
+        m_queuedBytes = 0;
+    }
+    m_connected = false;
+    SetState(ConnectionState::Disconnected);
+}
+
+// called with the SESSION line before the writer of a new connection starts
+// frames the server did not get before the old connection dropped go back to the front of the queue, in order
+// returns how many of them were older than the frames we kept and cannot be sent again
+uint64_t ChatClient::ResumeOutbound(bool resumed, uint64_t received) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    m_stopWriter = false;
+    uint64_t lost = 0;
+    if (resumed) {
+        // the server cannot have more of our lines than we wrote, unless it counted one frame twice
+        if (received > m_framesWritten) {
+            received = m_framesWritten;
+        }
+        if (received < m_writtenFirst) {
+            lost = m_writtenFirst - received;
+        }
+        uint64_t from = received < m_writtenFirst ? m_writtenFirst : received;
+        for (uint64_t index = m_framesWritten; index > from; index--) {
+            std::string& frame = m_written[(size_t)(index - 1 - m_writtenFirst)];
+            m_queuedFrames++;
+            m_queuedBytes += frame.size();
+            m_outbound.push_front(std::move(frame));
+        }
+    }
+    else {
+        received = 0;
+    }
+    // the frames we send from now on are counted from where the server stands
+    m_written.clear();
+    m_writtenFirst = received;
+    m_framesWritten = received;
+    return lost;
+}
+
+bool ChatClient::QueueFrame(std::string frame) {
+    if (!m_connected) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_queuedFrames++;
+        m_queuedBytes += frame.size();
+        m_outbound.push_back(std::move(frame));
+    }
+    m_sendReady.notify_one();
+    return true;
+}
+
+bool ChatClient::SendGlobal(const std::string& text) {
+    // we add a newline character as a message delimiter, one inside the text is sent as a space
+    // and shown as one, so what we show is what the others get
+    std::string line = SingleLine(text);
+    if (!QueueFrame(FormatGlobalMessage(line))) {
+        return false;
+    }
+    ChatMessage message;
+    message.timestamp = NowMs();
+    message.kind = MessageKind::Chat;
+    message.flags = MessageFromMe;
+    AddMessage(state.globalChat, {}, m_username, message, m_username + ": ", line);
+    return true;
+}
+
+bool ChatClient::SendDirect(const std::string& target, const std::string& text) {
+    std::string line = SingleLine(text);
+    if (!QueueFrame(FormatDirectMessage(target, line))) {
+        return false;
+    }
+    // we record our own message with a "Me:" prefix, the flag is what the DM window colours it by
+    ChatMessage message;
+    message.timestamp = NowMs();
+    message.kind = MessageKind::Direct;
+    message.flags = MessageFromMe;
+    AddMessage(DirectHistory(target), target, m_username, message, "Me: ", line);
+    return true;
+}
+
+// every new message enters the client's state through here, so the log sees exactly what the histories see
+void ChatClient::AddMessage(ChatHistory& history, std::string_view conversation, std::string_view sender, ChatMessage message, std::string_view prefix, std::string_view body) {
+    message.sender = state.names.Intern(sender);
+    history.Append(message, prefix, body);
+    if (m_log.IsOpen()) {
+        m_log.Append(conversation, sender, message, prefix, body);
+    }
+}
+
+size_t ChatClient::Search(std::string_view query, size_t maxResults, std::vector<SearchHit>& hits) {
+    hits.clear();
+    size_t matches = 0;
+    std::vector<uint64_t> ids;
+    ChatMessage message;
+    // every conversation hands in its own newest maxResults, the newest of those across all of them are the answer
+    auto collect = [&](const std::string& conversation, ChatHistory& history) {
+        matches += history.Search(query, maxResults, ids);
+        for (uint64_t id : ids) {
+            SearchHit hit;
+            if (history.CopyMessage(id, message, hit.line)) {
+                hit.conversation = conversation;
+                hit.index = id;
+                hit.timestamp = message.timestamp;
+                hits.push_back(std::move(hit));
+            }
+        }
+    };
+    collect(std::string(), state.globalChat);
+    for (auto& entry : state.dmHistory) {
+        collect(entry.first, entry.second);
+    }
+    std::stable_sort(hits.begin(), hits.end(), [](const SearchHit& a, const SearchHit& b) { return a.timestamp > b.timestamp; });
+    if (hits.size() > maxResults) {
+        hits.resize(maxResults);
+    }
+    return matches;
+}
+
+ChatHistory& ChatClient::DirectHistory(const std::string& name) {
+    auto result = state.dmHistory.try_emplace(name);
+    if (result.second) {
+        result.first->second.SetRetention(dmRetention);
+    }
+    return result.first->second;
+}
+
+// the receive thread is the only producer, if the UI is that far behind we wait for it a millisecond at a time
+bool ChatClient::PostEvent(ChatEvent&& event) {
+    while (!m_events.TryPush(std::move(event))) {
+        if (m_cancelConnect) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (onUpdate) {
+        onUpdate();
+    }
+    return true;
+}
+
+void ChatClient::PostSystemLine(std::string_view text) {
+    ChatEvent event;
+    event.kind = ChatEvent::Kind::GlobalLine;
+    event.timestamp = NowMs();
+    event.text.reserve(9 + text.size());
+    event.text.append("[System] ").append(text);
+    event.bodyOffset = 9;
+    event.flags = MessageSystem;
+    PostEvent(std::move(event));
+}
+
+size_t ChatClient::PumpEvents() {
+    size_t applied = 0;
+    ChatEvent event;
+    while (m_events.TryPop(event)) {
+        applied++;
+        switch (event.kind) {
+        case ChatEvent::Kind::GlobalLine: {
+            std::string_view text = event.text;
+            ChatMessage message = EventMessage(event, (event.flags & MessageSystem) ? MessageKind::System : MessageKind::Chat);
+            AddMessage(state.globalChat, {}, event.name, message, text.substr(0, event.bodyOffset), text.substr(event.bodyOffset));
+            break;
+        }
+        case ChatEvent::Kind::DirectMessage: {
+            std::string_view text = event.text;
+            ChatMessage message = EventMessage(event, MessageKind::Direct);
+            AddMessage(DirectHistory(event.name), event.name, event.name, message, text.substr(0, event.bodyOffset), text.substr(event.bodyOffset));
+            state.openDMs.insert(event.name);
+            break;
+        }
+        case ChatEvent::Kind::UserList:
+            state.userList.Clear();
+            for (const std::string& name : event.names) {
+                state.userList.Add(name);
+            }
+            break;
+        case ChatEvent::Kind::UserAdded:
+            state.userList.Add(event.name);
+            break;
+        case ChatEvent::Kind::UserRemoved:
+            state.userList.Remove(event.name);
+            break;
+        case ChatEvent::Kind::UserChecksum:
+            // a mismatch means we missed or misapplied a delta somewhere, a fresh snapshot fixes it
+            // the events are applied in order, so the list we compare is exactly the one the server summed up
+            if (state.userList.size() != event.count || state.userList.Checksum() != event.checksum) {
+                QueueFrame(FormatUserListRequest());
+            }
+            break;
+        }
+    }
+    return applied;
+}
+
+OutboundStats ChatClient::GetOutboundStats() const {
+    OutboundStats stats;
+    stats.queueDepth = m_queuedFrames.load();
+    stats.bytesInFlight = m_queuedBytes.load();
+    stats.framesSent = m_framesSent.load();
+    stats.writeCalls = m_writeCalls.load();
+    return stats;
+}
+
+// the writer thread drains the outbound queue, every frame queued since the last write goes out
+// with one scatter-gather call and a partial write just moves the offset into the first frame
+void ChatClient::WriterLoop(ChatSocket socket) {
+    // we keep this many written frames around to send them again after a resume
+    const size_t maxWritten = 4096;
+
+    std::deque<std::string> pending; // owned by this thread, the front frame may be partially written
+    size_t frontOffset = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_sendMutex);
+            m_sendReady.wait(lock, [this, &pending] { return m_stopWriter || !m_outbound.empty() || !pending.empty(); });
+            if (m_stopWriter) {
+                break;
+            }
+            while (!m_outbound.empty()) {
+                pending.push_back(std::move(m_outbound.front()));
+                m_outbound.pop_front();
+            }
+        }
+
+        SendSlice slices[kMaxSendSlices];
+        size_t count = 0;
+        for (size_t i = 0; i < pending.size() && count < kMaxSendSlices; i++, count++) {
+            size_t offset = i == 0 ? frontOffset : 0;
+            slices[count].data = pending[i].data() + offset;
+            slices[count].length = pending[i].size() - offset;
+        }
+
+        long long sent = SendSlices(socket, slices, count);
+        m_writeCalls++;
+        if (sent <= 0) {
+            // the connection is gone, we wake the receive loop up so it notices as well and reconnects
+            ShutdownSocket(socket);
+            break;
+        }
+        m_queuedBytes -= (size_t)sent;
+
+        // we retire every fully written frame and remember how far we got into the next one
+        size_t remaining = (size_t)sent;
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        while (remaining > 0) {
+            size_t left = pending.front().size() - frontOffset;
+            if (remaining < left) {
+                frontOffset += remaining;
+                break;
+            }
+            remaining -= left;
+            m_written.push_back(std::move(pending.front()));
+            m_framesWritten++;
+            if (m_written.size() > maxWritten) {
+                m_written.pop_front();
+                m_writtenFirst++;
+            }
+            pending.pop_front();
+            frontOffset = 0;
+            m_queuedFrames--;
+            m_framesSent++;
+        }
+    }
+
+    // unsent frames go back to the front of the queue for the next connection
+    // a partially written frame is sent again from its start, the server drops the half line with the old connection
+    if (!pending.empty()) {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_queuedBytes += frontOffset;
+        while (!pending.empty()) {
+            m_outbound.push_front(std::move(pending.back()));
+            pending.pop_back();
+        }
+    }
+}
+
+// this is the main loop that receives messages from the server asynchronously
+// in a separate thread to avoid blocking the main UI thread, it returns when the connection ends
+ChatClient::LinkResult ChatClient::ReceiveLoop(ChatSocket socket) {
+
+    // the framer owns the receive buffer, recv() writes straight into it and it handles split TCP packets for us
+    const size_t recvChunk = 4096;
+    LineFramer framer;
+
+    // this loop runs until the server disconnects or an error occurs
+    while (true) {
+        // we receive raw data from the socket directly into the free tail of the framer buffer
+        char* buffer = framer.PrepareWrite(recvChunk);
+        int bytes = RecvSome(socket, buffer, recvChunk);
+        if (bytes <= 0) {
+            // connection closed or error occurred
+            return LinkResult::Lost;
+        }
+        framer.CommitWrite((size_t)bytes);
+
+        FramedLine line;
+        // we process messages line by line using newline as a delimiter
+        while (framer.NextLine(line)) {
+            // we parse the line into views over the framer buffer, nothing is copied until it is committed to the history below
+            uint64_t seq = 0;
+            ServerMessage message = ParseServerLine(line, seq);
+
+            if (seq != 0) {
+                // a resumed session replays from the last line the server knows we got, so we may see a few twice
+                if (seq <= m_lastSeq) {
+                    continue;
+                }
+                m_lastSeq = seq;
+            }
+
+            if (const SessionInfo* session = std::get_if<SessionInfo>(&message)) {
+                // there is one SESSION line per connection, a second one would restart the writer under its own feet
+                // and count our frames from another point, we drop the link and let the reconnect sort it out
+                if (m_writerThread.joinable()) {
+                    return LinkResult::Lost;
+                }
+                // a different token means the server no longer had our session (it restarted or the grace period ran out)
+                bool resumed = !m_sessionToken.empty() && session->token == m_sessionToken;
+                if (!m_sessionToken.empty() && !resumed) {
+                    PostSystemLine("Reconnected, messages sent while you were away may be missing");
+                }
+                m_sessionToken.assign(session->token);
+                if (!resumed) {
+                    m_lastSeq = session->nextSeq - 1;
+                }
+                uint64_t lost = ResumeOutbound(resumed, session->received);
+                if (lost > 0) {
+                    PostSystemLine("Reconnected, " + std::to_string(lost) + (lost == 1 ? " message" : " messages") +
+                        " you sent before the connection dropped did not reach the server");
+                }
+                m_writerThread = std::thread(&ChatClient::WriterLoop, this, socket);
+                m_connected = true;
+                SetState(ConnectionState::Connected);
+            }
+            else if (const UsersUpdate* users = std::get_if<UsersUpdate>(&message)) {
+                // a full snapshot, we get one when we join or resume and after we asked for a resync
+                ChatEvent event;
+                event.kind = ChatEvent::Kind::UserList;
+                ForEachUserName(*users, [&event](std::string_view name) { event.names.emplace_back(name); });
+                PostEvent(std::move(event));
+            }
+            else if (const UserAdded* added = std::get_if<UserAdded>(&message)) {
+                ChatEvent event;
+                event.kind = ChatEvent::Kind::UserAdded;
+                event.name.assign(added->name);
+                PostEvent(std::move(event));
+            }
+            else if (const UserRemoved* removed = std::get_if<UserRemoved>(&message)) {
+                ChatEvent event;
+                event.kind = ChatEvent::Kind::UserRemoved;
+                event.name.assign(removed->name);
+                PostEvent(std::move(event));
+            }
+            else if (const UserListChecksum* sum = std::get_if<UserListChecksum>(&message)) {
+                // the UI thread owns the user list, so it is the one comparing
+                ChatEvent event;
+                event.kind = ChatEvent::Kind::UserChecksum;
+                event.count = sum->count;
+                event.checksum = sum->checksum;
+                PostEvent(std::move(event));
+            }
+            else if (const DirectMessage* dm = std::get_if<DirectMessage>(&message)) {
+                // we handle private messages separately from the global chat, the UI files them under the sender
+                ChatEvent event;
+                event.kind = ChatEvent::Kind::DirectMessage;
+                event.name.assign(dm->sender);
+                event.timestamp = NowMs();
+                event.text.reserve(dm->sender.size() + 2 + dm->text.size());
+                event.text.append(dm->sender).append(": ").append(dm->text);
+                event.bodyOffset = dm->sender.size() + 2;
+                bool fromOther = !EqualsIgnoreCase(dm->sender, m_username);
+                event.flags = fromOther ? 0 : MessageFromMe;
+                PostEvent(std::move(event));
+                // we notify only for messages sent by other users
+                if (fromOther && onNotification) {
+                    onNotification(ChatNotification::DirectMessage, dm->sender);
+                }
+            }
+            else if (const SystemNotice* notice = std::get_if<SystemNotice>(&message)) {
+                if (m_connectionState != ConnectionState::Connected) {
+                    // a notice before the SESSION line is the server refusing our username, we stop right here
+                    Fail(std::string(notice->text));
+                    return LinkResult::Rejected;
+                }
+                // system messages are informational and do not trigger notifications
+                PostSystemLine(notice->text);
+            }
+            else if (const ChatLine* chat = std::get_if<ChatLine>(&message)) {
+                // we ignore messages sent by ourselves to avoid duplicate local feedback
+                if (chat->sender == m_username) {
+                    continue;
+                }
+                // we work out here whether the line is one of ours, so the UI never has to look at the text to colour it
+                ChatEvent event;
+                event.kind = ChatEvent::Kind::GlobalLine;
+                event.name.assign(trimView(chat->sender));
+                event.timestamp = NowMs();
+                event.text.assign(chat->line);
+                // an empty text is a view with no position, the body is then the empty tail of the line
+                event.bodyOffset = chat->text.empty() ? chat->line.size() : (size_t)(chat->text.data() - chat->line.data());
+                event.flags = event.name == m_username ? MessageFromMe : 0;
+                PostEvent(std::move(event));
+                if (onNotification) {
+                    onNotification(ChatNotification::GlobalMessage, std::string_view());
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "chat_history.h"
+#include "chat_log.h"
+#include "chat_socket.h"
+#include "chat_spsc.h"
+#include "chat_users.h"
+
+// this is the chat as the UI sees it, it belongs to the UI thread and needs no lock
+// the receive thread never touches it, it queues ChatEvents that PumpEvents() applies at the start of a frame
+struct ChatState {
+    NameTable names; // the senders of every history below
+    ChatHistory globalChat;
+    UserDirectory userList;
+    std::map<std::string, ChatHistory> dmHistory;
+    std::set<std::string> openDMs;
+};
+
+// the kinds of incoming traffic the front-end may want to signal to the user (sounds, flashing the window, ...)
+enum class ChatNotification {
+    GlobalMessage,
+    DirectMessage,
+};
+
+// one parsed server line on its way from the receive thread to the UI thread
+struct ChatEvent {
+    enum class Kind {
+        GlobalLine,    // text is the line for the global chat, "alice: hi" or "[System] ...", name its sender if it has one
+        DirectMessage, // name is the sender, text the "sender: text" entry for its DM window
+        UserList,      // names is a full snapshot
+        UserAdded,     // name joined
+        UserRemoved,   // name left
+        UserChecksum,  // count and checksum of the server's user list
+    };
+    Kind kind = Kind::GlobalLine;
+    std::string name;
+    std::string text;
+    std::vector<std::string> names;
+    uint64_t count = 0;
+    uint64_t checksum = 0;
+    // for the two message kinds, worked out by the receive thread so the UI only copies them into the history
+    int64_t timestamp = 0;
+    size_t bodyOffset = 0; // where the typed text starts in text
+    uint8_t flags = 0;     // MessageFlags
+};
+
+// one message found by ChatClient::Search()
+struct SearchHit {
+    std::string conversation; // the DM peer, empty for the global chat
+    uint64_t index = 0;       // the message number in its history, see ChatHistory::Seek()
+    int64_t timestamp = 0;
+    std::string line;
+};
+
+// the steps of an asynchronous login, BeginConnect() walks through them on a background thread
+enum class ConnectionState {
+    Disconnected,
+    Resolving,   // looking up the server address
+    Connecting,  // waiting for the TCP handshake, bounded by the connect timeout
+    Handshaking,  // sending our username and waiting for the server to accept it
+    Connected,
+    Reconnecting, // the connection dropped after we joined, we retry with backoff and resume the session
+    Failed,       // see LastError()
+};
+
+const char* ConnectionStateName(ConnectionState state);
+
+// a snapshot of the outbound path, handy for a debug overlay or for a load test to spot a stalled writer
+struct OutboundStats {
+    size_t queueDepth = 0;     // frames queued or partially written
+    size_t bytesInFlight = 0;  // bytes queued but not yet accepted by the kernel
+    uint64_t framesSent = 0;
+    uint64_t writeCalls = 0;   // writev()/WSASend() calls, framesSent / writeCalls is the coalescing factor
+};
+
+// ChatClient owns the connection to the chat server, the receive thread and the shared chat state
+// it does not know anything about windows, rendering or audio so it builds and runs on Linux as well
+class ChatClient {
+public:
+    ChatClient() = default;
+    ~ChatClient();
+
+    ChatClient(const ChatClient&) = delete;
+    ChatClient& operator=(const ChatClient&) = delete;
+
+    // starts connecting on a background thread and returns immediately, the UI polls GetConnectionState()
+    // once connected the username is sent to join the chat and the receive and writer threads are started
+    // if the connection drops after that we reconnect with jittered exponential backoff and the server replays
+    // every history line we missed, sequence numbers make sure nothing is shown twice
+    void BeginConnect(const std::string& host, uint16_t port, const std::string& username, int timeoutMs = 5000);
+
+    // blocking version of BeginConnect() for tools and tests, returns true once the client is connected
+    bool Connect(const char* host, uint16_t port, const std::string& username, int timeoutMs = 5000);
+
+    // closes the connection, stops reconnecting and waits for the receive and writer threads to finish, unsent frames are dropped
+    void Disconnect();
+
+    // applies everything the receive thread queued since the last call to state and returns how many events that was
+    // the UI calls it once at the start of every frame, headless users whenever they want to look at state
+    size_t PumpEvents();
+
+    // queues a message for the global chat and adds it to our own history, the server does not echo it back to us
+    // the writer thread puts it on the wire so the caller (the UI thread) never blocks on a full socket buffer
+    // while we are reconnecting the frame simply waits in the queue for the next connection
+    bool SendGlobal(const std::string& text);
+
+    // queues a private message to target using the "DM|target|text" format and records it as "Me: text"
+    // both Send functions write to state, so like PumpEvents() they belong to the UI thread
+    bool SendDirect(const std::string& target, const std::string& text);
+
+    // looks query up in the global chat and in every DM conversation and returns the newest maxResults hits of all
+    // of them newest first, the return value is how many messages matched in total, UI thread only
+    size_t Search(std::string_view query, size_t maxResults, std::vector<SearchHit>& hits);
+
+    // the DM conversation with name, made with dmRetention if there is none yet, UI thread only
+    // every DM history has to come from here, one made straight in state.dmHistory would keep every message in memory
+    ChatHistory& DirectHistory(const std::string& name);
+
+    OutboundStats GetOutboundStats() const;
+
+    // keeps every message from now on in the log in directory and loads its newest reloadMessages messages into state
+    // call it before BeginConnect() and set globalRetention, dmRetention and logRetention first, the loaded messages are
+    // held to the history limits and the log to its own
+    bool OpenLog(const std::string& directory, size_t reloadMessages);
+
+    ConnectionState GetConnectionState() const { return m_connectionState.load(); }
+    std::string LastError() const;
+
+    // true from the moment the server accepted us until Disconnect() or a rejected reconnect, including while reconnecting
+    bool IsConnected() const { return m_connected.load(); }
+    const std::string& Username() const { return m_username; }
+
+    // UI thread only, see PumpEvents()
+    ChatState state;
+
+    // the reconnect backoff starts at reconnectBaseMs, doubles per failed attempt up to reconnectMaxMs
+    // and every delay is drawn from its upper half so a server restart is not hit by every client at once
+    int reconnectBaseMs = 250;
+    int reconnectMaxMs = 10000;
+
+    // how much of the global chat and of each DM conversation stays in memory, the rest is spilled to disk
+    // and paged back in when the user scrolls up, the defaults keep everything in memory
+    // the limits do not cover everything that grows with a conversation:
+    //   the search index stays in memory, about 1.5 bytes per word plus ~150 bytes per distinct word of every message
+    //   it covers, searchMessages bounds it to the newest messages (up to 1.5 times that many between compactions)
+    //   and 0 lets it grow with the conversation
+    //   the spill file on disk keeps every evicted message until the history is cleared or the client exits
+    //   the NameTable keeps every sender that ever wrote, a few dozen bytes each
+    // set them before BeginConnect(), a DM history picks up dmRetention when DirectHistory() makes it
+    HistoryRetention globalRetention;
+    HistoryRetention dmRetention;
+    // how much of the on-disk log OpenLog() keeps, the default keeps every segment
+    LogRetention logRetention;
+
+    // optional hooks, they run on the receive thread, onNotification fires as soon as the line is queued for the UI
+    // with the sender for a DM (its conversation) and an empty view for the global chat, the view is only valid during the call
+    std::function<void()> onReceiveThreadStart;
+    std::function<void()> onReceiveThreadStop;
+    std::function<void(ChatNotification, std::string_view)> onNotification;
+    // onUpdate runs on whichever thread queued an event for PumpEvents() or changed the connection state, the UI thread
+    // included, an event driven front-end wakes its frame loop with it (see WakeSignal) so it must not block
+    std::function<void()> onUpdate;
+
+private:
+    // how a connection ended, ReceiveLoop() tells the connect thread whether to try again
+    enum class LinkResult {
+        Lost,     // the socket closed or failed, we reconnect
+        Rejected, // the server refused our login, see LastError()
+    };
+
+    void ConnectLoop(std::string host, uint16_t port, std::string username, int timeoutMs);
+    ChatSocket OpenConnection(const std::string& host, uint16_t port, int timeoutMs, bool reconnecting, std::string& error);
+    bool WaitBeforeRetry(int attempt);
+    void SetState(ConnectionState state);
+    void Fail(const std::string& error);
+    LinkResult ReceiveLoop(ChatSocket socket);
+    void WriterLoop(ChatSocket socket);
+    uint64_t ResumeOutbound(bool resumed, uint64_t received);
+    bool QueueFrame(std::string frame);
+    void AddMessage(ChatHistory& history, std::string_view conversation, std::string_view sender, ChatMessage message, std::string_view prefix, std::string_view body);
+    bool PostEvent(ChatEvent&& event);
+    void PostSystemLine(std::string_view text);
+
+    // the connect thread owns the connection for its whole life: it connects, runs the receive loop and reconnects
+    std::thread m_connectThread;
+    std::thread m_writerThread;
+
+    // the socket of the current connection, Disconnect() shuts it down to wake the connect thread from recv()
+    std::mutex m_socketMutex;
+    ChatSocket m_socket = CHAT_INVALID_SOCKET;
+
+    // Connect() and the backoff sleep wait on this for a state change or a cancel
+    std::mutex m_stateMutex;
+    std::condition_variable m_stateChanged;
+
+    // frames waiting for the writer thread, guarded by m_sendMutex
+    std::mutex m_sendMutex;
+    std::condition_variable m_sendReady;
+    std::deque<std::string> m_outbound;
+    bool m_stopWriter = false; // ends the writer of the current connection, the queue is kept for the next one
+
+    // the last frames the kernel accepted in this session, also guarded by m_sendMutex
+    // a dropped connection can lose what was still in flight, so a resume sends whatever the server did not count again
+    std::deque<std::string> m_written;
+    uint64_t m_writtenFirst = 0;  // session index of m_written.front()
+    uint64_t m_framesWritten = 0; // session index of the next frame we write
+
+    std::atomic<size_t> m_queuedFrames{ 0 };
+    std::atomic<size_t> m_queuedBytes{ 0 };
+    std::atomic<uint64_t> m_framesSent{ 0 };
+    std::atomic<uint64_t> m_writeCalls{ 0 };
+
+    std::atomic<ConnectionState> m_connectionState{ ConnectionState::Disconnected };
+    std::atomic<bool> m_cancelConnect{ false };
+    mutable std::mutex m_errorMutex;
+    std::string m_lastError;
+
+    // parsed lines for the UI thread, when the UI falls this far behind the receive thread waits for it
+    // and TCP flow control pushes back on the server instead of us buffering without a limit
+    SpscQueue<ChatEvent> m_events{ 16384 };
+
+    std::atomic<bool> m_connected{ false };
+    std::string m_username;
+
+    // written from the UI thread next to the histories, see AddMessage()
+    ChatLog m_log;
+
+    // the session we resume after a dropped connection, only the connect thread touches these
+    std::string m_sessionToken;
+    uint64_t m_lastSeq = 0; // the last history line we showed, anything at or below it is a replayed duplicate
+};
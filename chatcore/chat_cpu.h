@@ -0,0 +1,5 @@
+#pragma once
+
+// what the cpu we run on can do, the scanners and the mixer pick their kernels with it once at startup
+// false on anything but x86, where there are no AVX2 kernels to pick
+bool CpuHasAVX2();
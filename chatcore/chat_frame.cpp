@@ -0,0 +1,178 @@
+#include "chat_frame.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+WakeSignal::WakeSignal() {
+#if defined(_WIN32)
+    // manual reset, the signal stays set until Consume() however many waits look at it
+    m_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+#else
+    m_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+WakeSignal::~WakeSignal() {
+#if defined(_WIN32)
+    if (m_event) {
+        CloseHandle(m_event);
+    }
+#else
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+#endif
+}
+
+void WakeSignal::Notify() {
+    m_notifies.fetch_add(1, std::memory_order_relaxed);
+    if (m_set.exchange(true)) {
+        return;
+    }
+    m_signals.fetch_add(1, std::memory_order_relaxed);
+#if defined(_WIN32)
+    SetEvent(m_event);
+#else
+    uint64_t one = 1;
+    ssize_t written = write(m_fd, &one, sizeof(one));
+    (void)written; // only fails when the counter is full, and then the fd is readable anyway
+#endif
+}
+
+bool WakeSignal::Consume() {
+    // the kernel side is cleared before the flag: a notifier that comes in between either finds the flag still set,
+    // and we report its wake-up here, or sets it again and signals, and the next wait returns at once
+    // the other way round its signal could be cleared after it set the flag, and with the flag stuck on no later
+    // Notify() would signal again
+#if defined(_WIN32)
+    ResetEvent(m_event);
+#else
+    uint64_t count;
+    ssize_t read = ::read(m_fd, &count, sizeof(count));
+    (void)read; // EAGAIN when nothing was signalled
+#endif
+    if (testHook) {
+        testHook();
+    }
+    return m_set.exchange(false);
+}
+
+bool WakeSignal::Wait(int timeoutMs) {
+#if defined(_WIN32)
+    return WaitForSingleObject(m_event, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs) == WAIT_OBJECT_0;
+#else
+    pollfd entry{ m_fd, POLLIN, 0 };
+    return poll(&entry, 1, timeoutMs) > 0;
+#endif
+}
+
+void FrameScheduler::RequestFrames(int count) {
+    m_pendingFrames = std::max(m_pendingFrames, count);
+}
+
+void FrameScheduler::RequestFrameAt(Clock::time_point when) {
+    if (!m_timed || when < m_frameAt) {
+        m_frameAt = when;
+        m_timed = true;
+    }
+}
+
+int FrameScheduler::TimeoutMs(Clock::time_point now) const {
+    if (m_pendingFrames > 0) {
+        return 0;
+    }
+    if (!m_timed) {
+        return -1;
+    }
+    if (m_frameAt <= now) {
+        return 0;
+    }
+    // rounded up, a wait that ends a little before the deadline would only find the frame not due yet
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(m_frameAt - now).count();
+    return (int)std::min<decltype(wait)>(wait, INT32_MAX);
+}
+
+bool FrameScheduler::BeginFrame(Clock::time_point now) {
+    if (m_pendingFrames > 0) {
+        m_pendingFrames--;
+    }
+    else if (m_timed && m_frameAt <= now) {
+        m_timed = false;
+    }
+    else {
+        return false;
+    }
+    m_framesDrawn++;
+    return true;
+}
+
+namespace {
+
+double ProcessCpuSeconds() {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto seconds = [](const FILETIME& time) {
+        return (double)(((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) * 1e-7;
+    };
+    return seconds(kernel) + seconds(user);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+}
+
+CpuMeter::CpuMeter() : m_lastCpu(ProcessCpuSeconds()), m_lastWall(std::chrono::steady_clock::now()) {}
+
+double CpuMeter::Sample() {
+    double cpu = ProcessCpuSeconds();
+    auto wall = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(wall - m_lastWall).count();
+    double share = elapsed > 0.0 ? (cpu - m_lastCpu) / elapsed : 0.0;
+    m_lastCpu = cpu;
+    m_lastWall = wall;
+    return share;
+}
+
+StartupTrace::StartupTrace() : m_start(Clock::now()) {}
+
+void StartupTrace::Record(const char* phase, Clock::time_point begin, Clock::time_point end) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.push_back({ phase, std::chrono::duration<double, std::milli>(begin - m_start).count(), std::chrono::duration<double, std::milli>(end - m_start).count() });
+}
+
+std::string StartupTrace::Report() const {
+    std::vector<Phase> phases;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        phases = m_phases;
+    }
+    std::stable_sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b) { return a.beginMs < b.beginMs; });
+    std::string report;
+    char line[128];
+    for (const Phase& phase : phases) {
+        snprintf(line, sizeof(line), "  %-14s %8.1f ms + %8.1f ms\n", phase.name, phase.beginMs, phase.endMs - phase.beginMs);
+        report += line;
+    }
+    return report;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// WakeSignal lets any thread wake a UI thread that sleeps in its event loop
+// it is an event object on Windows and an eventfd on Linux, so the loop waits for it together with its other inputs
+// (MsgWaitForMultipleObjects() on the message queue, poll() next to a display connection)
+// Notify() only makes a system call when the signal is not set yet, a burst of network lines costs a single wake-up
+class WakeSignal {
+public:
+    WakeSignal();
+    ~WakeSignal();
+
+    WakeSignal(const WakeSignal&) = delete;
+    WakeSignal& operator=(const WakeSignal&) = delete;
+
+    // any thread
+    void Notify();
+    // the waiting thread clears the signal before it looks at what the notifiers produced, true if it was set
+    bool Consume();
+    // waits up to timeoutMs (-1 for no limit) for Notify() without clearing the signal, for a loop with no other input
+    bool Wait(int timeoutMs);
+
+#if defined(_WIN32)
+    void* Handle() const { return m_event; } // a HANDLE for the Wait functions
+#else
+    int Fd() const { return m_fd; }          // readable while the signal is set
+#endif
+
+    // tests only, runs inside Consume() between clearing the kernel side and the flag
+    std::function<void()> testHook;
+
+    uint64_t Notifies() const { return m_notifies.load(std::memory_order_relaxed); }
+    uint64_t Signals() const { return m_signals.load(std::memory_order_relaxed); } // the notifies that made a system call
+
+private:
+    std::atomic<bool> m_set{ false };
+    std::atomic<uint64_t> m_notifies{ 0 };
+    std::atomic<uint64_t> m_signals{ 0 };
+#if defined(_WIN32)
+    void* m_event = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+// FrameScheduler decides when an event driven UI loop draws, so an idle client sleeps instead of drawing a frame
+// every vertical blank
+//   anything that can change the picture (input, a network wake-up, a resize) asks for frames, input asks for
+//   SettleFrames because ImGui needs a couple of frames after an event to settle (hover state, scroll targets,
+//   widgets sized from the previous frame), new chat data only has to be drawn and then scrolled to
+//   an animation asks for a frame at a point in time, the loop sleeps until then unless something else comes first
+// it owns no clock, the loop passes the time in, so the scheduling can be tested without a window or real waiting
+class FrameScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int SettleFrames = 3;
+    static constexpr int DataFrames = 2;
+
+    void RequestFrames(int count = SettleFrames);
+    // keeps the earliest of the requested times
+    void RequestFrameAt(Clock::time_point when);
+
+    // how long the loop may sleep, 0 when a frame is due and -1 when nothing is
+    int TimeoutMs(Clock::time_point now) const;
+    // true if a frame is due at now, the frame counts as drawn
+    bool BeginFrame(Clock::time_point now);
+
+    uint64_t FramesDrawn() const { return m_framesDrawn; }
+
+private:
+    int m_pendingFrames = SettleFrames; // the first frames draw the window at all
+    bool m_timed = false;
+    Clock::time_point m_frameAt;
+    uint64_t m_framesDrawn = 0;
+};
+
+// CpuMeter reports the share of one core the process used between two calls of Sample(), 0.01 is 1 %
+// the first call measures from when the meter was made
+class CpuMeter {
+public:
+    CpuMeter();
+    double Sample();
+
+private:
+    double m_lastCpu = 0.0;
+    std::chrono::steady_clock::time_point m_lastWall;
+};
+
+// StartupTrace records when the phases of a front-end's startup ran and how long they took, counted from the moment
+// the trace was made, so the time to the first frame can be taken apart
+// phases may run on several threads and overlap (the sample cache loads while the window comes up), any thread records
+class StartupTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StartupTrace();
+
+    void Record(const char* phase, Clock::time_point begin, Clock::time_point end);
+
+    // records the phase from its construction to its destruction
+    class Scope {
+    public:
+        Scope(StartupTrace& trace, const char* phase) : m_trace(trace), m_phase(phase), m_begin(Clock::now()) {}
+        ~Scope() { m_trace.Record(m_phase, m_begin, Clock::now()); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StartupTrace& m_trace;
+        const char* m_phase;
+        Clock::time_point m_begin;
+    };
+
+    // one line per phase in the order they began, "  window        0.0 ms +   12.3 ms"
+    std::string Report() const;
+
+private:
+    struct Phase {
+        const char* name;
+        double beginMs;
+        double endMs;
+    };
+
+    Clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::vector<Phase> m_phases;
+};
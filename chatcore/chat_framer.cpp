@@ -0,0 +1,113 @@
+#include "chat_framer.h"
+
+#include <cstring>
+
+LineFramer::LineFramer(size_t initialCapacity) : m_buffer(initialCapacity > 0 ? initialCapacity : 1) {
+}
+
+char* LineFramer::PrepareWrite(size_t minSpace) {
+    // once every received byte was handed out we can start from the front again for free
+    if (m_read == m_write) {
+        Clear();
+    }
+
+    if (m_buffer.size() - m_write < minSpace) {
+        // we move the partial line that is still pending back to the front of the buffer
+        // this is the only place where received bytes are moved and it touches only the unfinished tail
+        if (m_read > 0) {
+            size_t pending = m_write - m_read;
+            memmove(m_buffer.data(), m_buffer.data() + m_read, pending);
+
+            // the pending bytes hold no newline (all complete lines were handed out) but may hold separators
+            // so we drop the consumed index entries and rebase the remaining ones
+            m_index.newlines.erase(m_index.newlines.begin(), m_index.newlines.begin() + m_nextNewline);
+            m_index.separators.erase(m_index.separators.begin(), m_index.separators.begin() + m_nextSeparator);
+            for (uint32_t& offset : m_index.newlines) {
+                offset -= (uint32_t)m_read;
+            }
+            for (uint32_t& offset : m_index.separators) {
+                offset -= (uint32_t)m_read;
+            }
+            m_nextNewline = m_nextSeparator = 0;
+
+            m_write = pending;
+            m_read = 0;
+        }
+        // if a single line is longer than the whole buffer we grow it geometrically
+        if (m_buffer.size() - m_write < minSpace) {
+            size_t newSize = m_buffer.size() * 2;
+            while (newSize - m_write < minSpace) {
+                newSize *= 2;
+            }
+            m_buffer.resize(newSize);
+        }
+    }
+    return m_buffer.data() + m_write;
+}
+
+void LineFramer::CommitWrite(size_t count) {
+    ScanStructural(m_buffer.data() + m_write, count, (uint32_t)m_write, m_index);
+    m_write += count;
+}
+
+void LineFramer::Append(const char* data, size_t count) {
+    char* dst = PrepareWrite(count);
+    memcpy(dst, data, count);
+    CommitWrite(count);
+}
+
+bool LineFramer::NextLine(FramedLine& line) {
+    if (m_nextNewline >= m_index.newlines.size()) {
+        return false;
+    }
+    size_t end = m_index.newlines[m_nextNewline++];
+
+    // the separators of this line are consumed together with it so we can rebase them in place
+    // to be relative to the start of the line
+    uint32_t* first = m_index.separators.data() + m_nextSeparator;
+    size_t count = 0;
+    while (m_nextSeparator < m_index.separators.size() && m_index.separators[m_nextSeparator] < end) {
+        m_index.separators[m_nextSeparator] -= (uint32_t)m_read;
+        m_nextSeparator++;
+        count++;
+    }
+
+    line.text = std::string_view(m_buffer.data() + m_read, end - m_read);
+    line.separators = count > 0 ? first : nullptr;
+    line.separatorCount = count;
+    m_read = end + 1;
+    return true;
+}
+
+bool LineFramer::NextLine(std::string_view& line) {
+    FramedLine framed;
+    if (!NextLine(framed)) {
+        return false;
+    }
+    line = framed.text;
+    return true;
+}
+
+bool LineFramer::TakePartial(std::string_view& rest) {
+    if (m_nextNewline < m_index.newlines.size() || m_read == m_write) {
+        return false;
+    }
+    rest = std::string_view(m_buffer.data() + m_read, m_write - m_read);
+    m_read = m_write;
+    m_nextSeparator = m_index.separators.size();
+    return true;
+}
+
+bool LineFramer::PeekPartial(std::string_view& rest) const {
+    if (m_nextNewline < m_index.newlines.size() || m_read == m_write) {
+        return false;
+    }
+    rest = std::string_view(m_buffer.data() + m_read, m_write - m_read);
+    return true;
+}
+
+void LineFramer::Clear() {
+    m_read = m_write = 0;
+    m_index.Clear();
+    m_nextNewline = m_nextSeparator = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "chat_scan.h"
+
+// a complete line handed out by the framer together with the protocol separators ('|' and ',') found inside it
+// separator offsets are relative to text.data() so the parser can split the line without searching it again
+struct FramedLine {
+    std::string_view text;
+    const uint32_t* separators = nullptr;
+    size_t separatorCount = 0;
+};
+
+// LineFramer turns the raw byte stream coming out of recv() into newline delimited lines
+// we keep one contiguous buffer with a read cursor and a write cursor, recv() writes straight into the free tail
+// and NextLine() hands out views into the buffer so a line is never copied and the unread remainder is never shifted per line
+// the remainder is only moved back to the front when the tail runs out of room which happens at most once per recv() call
+// every committed chunk is scanned exactly once by ScanStructural() and the resulting index drives the framing
+class LineFramer {
+public:
+    explicit LineFramer(size_t initialCapacity = 8192);
+
+    // returns a pointer to at least minSpace writable bytes at the tail of the buffer
+    // any view returned by NextLine() before this call is invalidated because the buffer may be compacted or grown
+    char* PrepareWrite(size_t minSpace);
+
+    // marks the first count bytes written through PrepareWrite() as received data and indexes them
+    void CommitWrite(size_t count);
+
+    // convenience for callers that already hold the data somewhere else (replayed captures, tests, benchmarks)
+    void Append(const char* data, size_t count);
+
+    // gives back the next complete line without its trailing newline
+    // returns false when only a partial line (or nothing) is left in the buffer
+    bool NextLine(FramedLine& line);
+    bool NextLine(std::string_view& line);
+
+    // hands out whatever was received after the last complete line and consumes it
+    // the server uses it for the join message because the client sends its username without a newline
+    bool TakePartial(std::string_view& rest);
+
+    // same as TakePartial() but the bytes stay in the buffer
+    bool PeekPartial(std::string_view& rest) const;
+
+    // drops everything that was received but not handed out yet, used when the connection is reset
+    void Clear();
+
+    size_t Pending() const { return m_write - m_read; }
+    size_t Capacity() const { return m_buffer.size(); }
+
+private:
+    std::vector<char> m_buffer;
+    size_t m_read = 0;  // first byte that was not handed out as part of a line yet
+    size_t m_write = 0; // end of the received data
+
+    // delimiter positions of the pending bytes, offsets are relative to the start of m_buffer
+    StructuralIndex m_index;
+    size_t m_nextNewline = 0;   // first entry of m_index.newlines that was not consumed yet
+    size_t m_nextSeparator = 0; // first entry of m_index.separators that was not consumed yet
+};
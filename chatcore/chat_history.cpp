@@ -0,0 +1,226 @@
+#include "chat_history.h"
+
+#include <algorithm>
+
+#include "chat_spill.h"
+
+NameTable::NameTable() {
+    m_names.emplace_back();
+}
+
+uint32_t NameTable::Intern(std::string_view name) {
+    if (name.empty()) {
+        return 0;
+    }
+    auto it = m_ids.find(name);
+    if (it != m_ids.end()) {
+        return it->second;
+    }
+    uint32_t id = (uint32_t)m_names.size();
+    m_names.emplace_back(name);
+    m_ids.emplace(m_names.back(), id);
+    return id;
+}
+
+namespace {
+
+size_t MessageCost(const ChatMessage& message) {
+    return sizeof(ChatMessage) + message.textLength;
+}
+
+}
+
+ChatHistory::ChatHistory() = default;
+ChatHistory::~ChatHistory() = default;
+
+void ChatHistory::SetRetention(const HistoryRetention& retention) {
+    m_retention = retention;
+    m_search.SetHorizon(retention.searchMessages);
+    if (AtTail()) {
+        Evict();
+    }
+}
+
+bool ChatHistory::OverLimits(size_t extraMessages, size_t extraBytes) const {
+    return (m_retention.maxMessages != 0 && m_count + extraMessages > m_retention.maxMessages) ||
+        (m_retention.maxBytes != 0 && m_bytes + extraBytes > m_retention.maxBytes);
+}
+
+void ChatHistory::Push(ChatMessage message, std::string_view first, std::string_view second) {
+    if (m_count == m_ring.size()) {
+        // we grow the ring by doubling and unwrap it on the way, with a message limit it stops growing at that limit
+        std::vector<ChatMessage> ring(std::max<size_t>(16, m_ring.size() * 2));
+        for (size_t i = 0; i < m_count; i++) {
+            ring[i] = (*this)[i];
+        }
+        m_ring.swap(ring);
+        m_head = 0;
+    }
+    std::string_view text = m_text.Store(first, second);
+    message.text = text.data();
+    message.textLength = (uint32_t)text.size();
+    m_ring[(m_head + m_count) & (m_ring.size() - 1)] = message;
+    m_count++;
+    m_bytes += MessageCost(message);
+}
+
+void ChatHistory::Append(ChatMessage message, std::string_view prefix, std::string_view body) {
+    // the prefix is a username and a separator, only a misbehaving server sends one that does not fit bodyOffset
+    // and then the whole line counts as the body
+    message.bodyOffset = prefix.size() <= UINT16_MAX ? (uint16_t)prefix.size() : 0;
+    m_search.Add(m_total, body);
+
+    if (!AtTail()) {
+        // the user is reading older messages, the new one waits in the spill file until they page back down
+        m_scratch.assign(prefix).append(body);
+        message.text = m_scratch.data();
+        message.textLength = (uint32_t)m_scratch.size();
+        if (Spill(message)) {
+            m_total++;
+            return;
+        }
+        // without a spill file we cannot keep the window away from the tail, we show the newest message again
+        ResetWindow(m_total);
+    }
+    Push(message, prefix, body);
+    m_total++;
+    Evict();
+}
+
+void ChatHistory::Evict() {
+    size_t evicted = 0;
+    // we always keep the newest message, even if it alone is over the byte limit
+    while (m_count > 1 && OverLimits(0, 0)) {
+        const ChatMessage& oldest = (*this)[0];
+        // after paging back to the tail the front of the window may already be in the spill file
+        if (m_first == SpilledCount()) {
+            Spill(oldest);
+        }
+        m_bytes -= MessageCost(oldest);
+        m_head = (m_head + 1) & (m_ring.size() - 1);
+        m_count--;
+        m_first++;
+        evicted++;
+    }
+    if (evicted != 0) {
+        m_text.ReleaseBefore((*this)[0].text);
+    }
+}
+
+uint64_t ChatHistory::SpilledCount() const {
+    return m_spill ? m_spill->Count() : 0;
+}
+
+bool ChatHistory::Spill(const ChatMessage& message) {
+    if (m_spillFailed) {
+        return false;
+    }
+    if (!m_spill) {
+        m_spill = std::make_unique<SpillFile>();
+        if (!m_spill->Open(m_retention.spillDirectory)) {
+            m_spillFailed = true;
+            return false;
+        }
+    }
+    if (!m_spill->Append(message)) {
+        m_spillFailed = true;
+        return false;
+    }
+    return true;
+}
+
+bool ChatHistory::HasOlder() const {
+    return m_first > 0 && m_spill && !m_spillFailed;
+}
+
+bool ChatHistory::PageOlder() {
+    if (!HasOlder()) {
+        return false;
+    }
+    uint64_t step = std::max<uint64_t>(1, m_count / 2);
+    return LoadWindow(m_first > step ? m_first - step : 0);
+}
+
+bool ChatHistory::PageNewer() {
+    if (AtTail() || m_spillFailed) {
+        return false;
+    }
+    return LoadWindow(m_first + std::max<uint64_t>(1, m_count / 2));
+}
+
+bool ChatHistory::Seek(uint64_t index) {
+    if (index >= m_total) {
+        return false;
+    }
+    if (index >= m_first && index < m_first + m_count) {
+        return true;
+    }
+    if (!m_spill || m_spillFailed || index >= SpilledCount()) {
+        return false;
+    }
+    // the message lands in the middle of a window of the size we have now, so the user can scroll both ways from it
+    uint64_t before = std::max<uint64_t>(1, m_count / 2);
+    return LoadWindow(index > before ? index - before : 0) && index >= m_first && index < m_first + m_count;
+}
+
+bool ChatHistory::CopyMessage(uint64_t index, ChatMessage& message, std::string& text) {
+    auto copy = [&message, &text](const ChatMessage& found) {
+        text.assign(found.Text());
+        message = found;
+        message.text = text.data();
+        return false;
+    };
+    if (index >= m_first && index < m_first + m_count) {
+        copy((*this)[(size_t)(index - m_first)]);
+        return true;
+    }
+    if (!m_spill || m_spillFailed || index >= SpilledCount()) {
+        return false;
+    }
+    return m_spill->Read(index, 1, copy);
+}
+
+void ChatHistory::ResetWindow(uint64_t first) {
+    m_head = 0;
+    m_count = 0;
+    m_bytes = 0;
+    m_first = first;
+    m_text.Clear();
+}
+
+bool ChatHistory::LoadWindow(uint64_t first) {
+    // everything we drop from memory has to be in the spill file first, away from the tail it already is
+    if (AtTail()) {
+        for (uint64_t i = std::max(m_first, SpilledCount()); i < m_total; i++) {
+            if (!Spill((*this)[(size_t)(i - m_first)])) {
+                return false;
+            }
+        }
+    }
+
+    ResetWindow(first);
+    bool ok = m_spill->Read(first, m_total - first, [this](const ChatMessage& message) {
+        if (m_count != 0 && OverLimits(1, MessageCost(message))) {
+            return false;
+        }
+        Push(message, message.Text(), std::string_view());
+        return true;
+    });
+    if (!ok) {
+        // we keep whatever was read before the error, new messages bring the window back to the tail
+        m_spillFailed = true;
+        if (m_count == 0) {
+            ResetWindow(m_total);
+        }
+        return false;
+    }
+    return true;
+}
+
+void ChatHistory::Clear() {
+    ResetWindow(0);
+    m_total = 0;
+    m_spill.reset();
+    m_spillFailed = false;
+    m_search.Clear();
+}
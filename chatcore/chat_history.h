@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "chat_arena.h"
+#include "chat_search.h"
+
+class SpillFile;
+
+// what a history entry is, the client decides this once when the line arrives so the UI never looks at the text to find out
+enum class MessageKind : uint8_t {
+    Chat,   // "sender: text" in the global chat
+    Direct, // a private message, "sender: text" or "Me: text" for the ones we sent
+    System, // "[System] ..." from the server or from the client itself
+};
+
+// bits for ChatMessage::flags
+enum MessageFlags : uint8_t {
+    MessageFromMe = 1 << 0,  // we sent it (or the server replayed one of ours), the UI draws it highlighted
+    MessageSystem = 1 << 1,  // a notice, not something a user typed
+};
+
+// NameTable hands out a small id per distinct username, so a message stores 4 bytes instead of a copy of its sender
+// id 0 is reserved for "nobody" (system lines), names are never removed so an id stays valid for the life of the table
+class NameTable {
+public:
+    NameTable();
+
+    uint32_t Intern(std::string_view name);
+    std::string_view Name(uint32_t id) const { return m_names[id]; }
+    size_t size() const { return m_names.size(); }
+
+private:
+    // a deque never moves its elements, so the map keys can point into the strings it holds
+    std::deque<std::string> m_names;
+    std::unordered_map<std::string_view, uint32_t> m_ids;
+};
+
+// one entry of a chat history, 32 bytes, the text itself lives in the history's TextArena
+struct ChatMessage {
+    int64_t timestamp = 0;     // milliseconds since the Unix epoch when the line reached us
+    const char* text = nullptr; // the display line ("alice: hi"), it does not move while the message is in its history
+    uint32_t textLength = 0;
+    uint32_t sender = 0;       // NameTable id, 0 for system lines
+    uint16_t bodyOffset = 0;   // where the message text starts inside the display line, after "alice: "
+    MessageKind kind = MessageKind::Chat;
+    uint8_t flags = 0;         // MessageFlags
+
+    // the whole display line
+    std::string_view Text() const { return std::string_view(text, textLength); }
+    // only what the sender typed
+    std::string_view Body() const { return Text().substr(bodyOffset); }
+};
+
+// how much of one conversation a ChatHistory keeps in memory, 0 means no limit
+struct HistoryRetention {
+    size_t maxMessages = 0;
+    size_t maxBytes = 0;        // message text plus the records
+    std::string spillDirectory; // where evicted messages are spilled to, empty means the system temp directory
+    size_t searchMessages = 0;  // how many of the newest messages Search() covers, see SearchIndex::SetHorizon()
+};
+
+// ChatHistory is one conversation (the global chat or one DM window) as a ring of fixed size records
+// whose text is packed back to back into a TextArena, appending a message allocates only when a chunk fills up
+// instead of once per line, and the renderer hands ImGui views straight into the chunks
+// with a retention limit only a window of the conversation is in memory:
+//   while the window ends at the newest message (AtTail()) new messages go in at the back and the oldest are
+//   evicted at the front, they are appended to a SpillFile first and the arena frees their chunks as a whole
+//   PageOlder() and PageNewer() move the window over the spilled messages when the user scrolls past its ends,
+//   while it is away from the tail every new message goes straight to the spill file
+// messages are numbered from 0 for the whole conversation, index 0 of the window is message FirstIndex()
+// every body also goes into a SearchIndex under that number, so a search covers the spilled messages too, as far back
+// as HistoryRetention::searchMessages reaches
+class ChatHistory {
+public:
+    ChatHistory();
+    ~ChatHistory();
+
+    ChatHistory(const ChatHistory&) = delete;
+    ChatHistory& operator=(const ChatHistory&) = delete;
+
+    // a history over the new limits evicts right away
+    void SetRetention(const HistoryRetention& retention);
+
+    // appends prefix and body back to back as the display line of message, prefix is the "alice: " part
+    // the text fields of message are filled in here
+    void Append(ChatMessage message, std::string_view prefix, std::string_view body);
+    // drops the whole conversation including what was spilled
+    void Clear();
+
+    // the window in memory
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    const ChatMessage& operator[](size_t index) const { return m_ring[(m_head + index) & (m_ring.size() - 1)]; }
+
+    uint64_t FirstIndex() const { return m_first; }
+    uint64_t TotalCount() const { return m_total; }
+    bool AtTail() const { return m_first + m_count == m_total; }
+    // true if messages before FirstIndex() can be paged back in
+    bool HasOlder() const;
+
+    // move the window about half its length towards older or newer messages, false if there is nothing to move to
+    // or the spill file could not be written or read, the window is left alone then
+    bool PageOlder();
+    bool PageNewer();
+    // makes sure message index is in the window, loading the part of the conversation around it if it is not
+    bool Seek(uint64_t index);
+
+    // the numbers of the messages whose body has every word of query, see SearchIndex::Search()
+    size_t Search(std::string_view query, size_t maxResults, std::vector<uint64_t>& results) const { return m_search.Search(query, maxResults, results); }
+    // copies message index wherever it is, in the window or in the spill file, message.text then points into text
+    bool CopyMessage(uint64_t index, ChatMessage& message, std::string& text);
+
+    // what the window costs by the measure of HistoryRetention::maxBytes
+    size_t ResidentBytes() const { return m_bytes; }
+    TextArena::Stats TextStats() const { return m_text.GetStats(); }
+    SearchIndex::Stats SearchStats() const { return m_search.GetStats(); }
+
+private:
+    void Push(ChatMessage message, std::string_view first, std::string_view second);
+    bool OverLimits(size_t extraMessages, size_t extraBytes) const;
+    void Evict();
+    bool Spill(const ChatMessage& message);
+    uint64_t SpilledCount() const;
+    bool LoadWindow(uint64_t first);
+    void ResetWindow(uint64_t first);
+
+    std::vector<ChatMessage> m_ring; // a power of two long, m_count records starting at m_head
+    size_t m_head = 0;
+    size_t m_count = 0;
+    uint64_t m_first = 0;
+    uint64_t m_total = 0;
+    size_t m_bytes = 0;
+
+    HistoryRetention m_retention;
+    TextArena m_text;
+    SearchIndex m_search;
+    std::unique_ptr<SpillFile> m_spill; // created on the first eviction
+    bool m_spillFailed = false;         // the spill file broke, evicted messages are gone for good from then on
+    std::string m_scratch;
+};
@@ -0,0 +1,434 @@
+#include "chat_log.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include "chat_mmap.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t RecordHeader = 28;
+constexpr size_t RecordOverhead = RecordHeader + 4;
+
+template <typename T>
+T Load(const char* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// the usual reflected CRC-32 (the one zlib and PNG use), sliced by 8: entries[k] advances the crc of a byte by k more
+// zero bytes, so eight independent lookups replace a chain of eight dependent ones
+// every record is checked when it is loaded, with one lookup per byte the crc was most of the startup time
+struct Crc32Table {
+    uint32_t entries[8][256];
+    constexpr Crc32Table() : entries() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0u);
+            }
+            entries[0][i] = crc;
+        }
+        for (int k = 1; k < 8; k++) {
+            for (uint32_t i = 0; i < 256; i++) {
+                entries[k][i] = (entries[k - 1][i] >> 8) ^ entries[0][entries[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+constexpr Crc32Table kCrc32;
+
+// the words are read little endian, which every platform the client builds for is
+uint32_t Crc32(const char* data, size_t size) {
+    const uint32_t (*t)[256] = kCrc32.entries;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint32_t one = Load<uint32_t>(data) ^ crc;
+        uint32_t two = Load<uint32_t>(data + 4);
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24]
+            ^ t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    }
+    for (; size > 0; data++, size--) {
+        crc = t[0][(crc ^ (unsigned char)*data) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void StoreAt(char* p, T value) {
+    memcpy(p, &value, sizeof(T));
+}
+
+// checks the record of size bytes at p and fills message from it, false for anything torn or corrupted
+bool DecodeRecord(const char* p, size_t size, LoggedMessage& out) {
+    if (size < RecordOverhead || Load<uint32_t>(p) != size || Load<uint32_t>(p + size - 4) != size) {
+        return false;
+    }
+    uint16_t conversationLength = Load<uint16_t>(p + 20);
+    uint16_t senderLength = Load<uint16_t>(p + 22);
+    uint32_t textLength = Load<uint32_t>(p + 24);
+    if (RecordOverhead + (size_t)conversationLength + senderLength + textLength != size) {
+        return false;
+    }
+    if (Crc32(p + 8, size - 12) != Load<uint32_t>(p + 4)) {
+        return false;
+    }
+    const char* strings = p + RecordHeader;
+    out.conversation = std::string_view(strings, conversationLength);
+    out.sender = std::string_view(strings + conversationLength, senderLength);
+    out.message = ChatMessage();
+    out.message.timestamp = Load<int64_t>(p + 8);
+    out.message.kind = (MessageKind)p[16];
+    out.message.flags = (uint8_t)p[17];
+    out.message.bodyOffset = Load<uint16_t>(p + 18);
+    out.message.text = strings + conversationLength + senderLength;
+    out.message.textLength = textLength;
+    return true;
+}
+
+// the end of the run of intact records at the start of a segment, only needed after a crash
+size_t ValidEnd(const char* data, size_t size) {
+    size_t pos = 0;
+    LoggedMessage record;
+    while (size - pos >= RecordOverhead) {
+        uint32_t recordSize = Load<uint32_t>(data + pos);
+        if (recordSize > size - pos || !DecodeRecord(data + pos, recordSize, record)) {
+            break;
+        }
+        pos += recordSize;
+    }
+    return pos;
+}
+
+// 3 for "chat-00000003.log", 0 for anything that is not a segment
+uint64_t SegmentIndex(const std::string& name) {
+    if (name.size() <= 9 || name.compare(0, 5, "chat-") != 0 || name.compare(name.size() - 4, 4, ".log") != 0) {
+        return 0;
+    }
+    uint64_t index = 0;
+    for (size_t i = 5; i < name.size() - 4; i++) {
+        if (name[i] < '0' || name[i] > '9') {
+            return 0;
+        }
+        index = index * 10 + (uint64_t)(name[i] - '0');
+    }
+    return index;
+}
+
+bool SyncFile(FILE* file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+}
+
+ChatLog::~ChatLog() {
+    Close();
+}
+
+std::string ChatLog::SegmentPath(uint64_t index) const {
+    char name[32];
+    snprintf(name, sizeof(name), "chat-%08llu.log", (unsigned long long)index);
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+bool ChatLog::Open(const std::string& directory, const LogRetention& retention, size_t segmentBytes, int syncIntervalMs) {
+    Close();
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (!std::filesystem::is_directory(directory, error)) {
+        return false;
+    }
+    m_directory = directory;
+    m_retention = retention;
+    m_segmentBytes = segmentBytes;
+    m_syncIntervalMs = syncIntervalMs;
+
+    m_firstSegment = 0;
+    m_lastSegment = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        uint64_t index = SegmentIndex(entry.path().filename().string());
+        if (index != 0) {
+            m_firstSegment = m_firstSegment == 0 ? index : std::min<uint64_t>(m_firstSegment, index);
+            m_lastSegment = std::max<uint64_t>(m_lastSegment, index);
+        }
+    }
+
+    // a crash can leave half a record at the end of the newest segment, a clean one ends in a record that checks out
+    // we carry on writing at its end while it has room, a client that is started many times a day would otherwise
+    // leave a trail of nearly empty segments behind
+    m_segmentIndex = m_lastSegment + 1;
+    if (m_lastSegment != 0) {
+        std::string path = SegmentPath(m_lastSegment);
+        size_t validEnd = 0;
+        size_t size = 0;
+        bool readable = false;
+        {
+            MappedFile file;
+            if (file.Map(path)) {
+                readable = true;
+                size = file.size();
+                LoggedMessage record;
+                uint32_t last = size >= 4 ? Load<uint32_t>(file.data() + size - 4) : 0;
+                bool clean = size == 0 || (last <= size && DecodeRecord(file.data() + size - last, last, record));
+                validEnd = clean ? size : ValidEnd(file.data(), size);
+            }
+        }
+        bool intact = validEnd == size;
+        if (!intact) {
+            std::filesystem::resize_file(path, validEnd, error);
+            intact = !error;
+        }
+        // a segment we could not read or cut back is left as it is, the new records go into the next one
+        if (readable && intact && validEnd < segmentBytes) {
+            m_segmentIndex = m_lastSegment;
+        }
+    }
+
+    m_segmentSize = 0;
+    m_stop = false;
+    m_stats = Stats();
+    m_writer = std::thread(&ChatLog::WriterLoop, this);
+    return true;
+}
+
+void ChatLog::Close() {
+    if (!m_writer.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_ready.notify_all();
+    m_writer.join();
+}
+
+size_t ChatLog::LoadTail(size_t maxRecords, const std::function<void(const LoggedMessage&)>& visit) {
+    if (m_lastSegment == 0 || maxRecords == 0) {
+        return 0;
+    }
+    // we walk the segments from the newest backwards and remember where the records start, then visit them oldest first
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<LoggedMessage> records;
+    for (uint64_t index = m_lastSegment; index >= m_firstSegment && index != 0 && records.size() < maxRecords; index--) {
+        auto file = std::make_unique<MappedFile>();
+        if (!file->Map(SegmentPath(index)) || file->size() == 0) {
+            continue;
+        }
+        const char* data = file->data();
+        size_t pos = file->size();
+        LoggedMessage record;
+        while (pos >= RecordOverhead && records.size() < maxRecords) {
+            uint32_t size = Load<uint32_t>(data + pos - 4);
+            if (size > pos || !DecodeRecord(data + pos - size, size, record)) {
+                // only a segment a write error left torn gets here, we fall back to the records we can read from its start
+                size_t validEnd = pos == file->size() ? ValidEnd(data, pos) : 0;
+                if (validEnd == 0 || validEnd == pos) {
+                    break;
+                }
+                pos = validEnd;
+                continue;
+            }
+            pos -= size;
+            records.push_back(record);
+        }
+        files.push_back(std::move(file));
+    }
+
+    for (size_t i = records.size(); i-- > 0;) {
+        visit(records[i]);
+    }
+    return records.size();
+}
+
+void ChatLog::Append(std::string_view conversation, std::string_view sender, const ChatMessage& message, std::string_view prefix, std::string_view body) {
+    // names longer than a u16 cannot come from the server, we cut them rather than write a record we cannot read back
+    conversation = conversation.substr(0, UINT16_MAX);
+    sender = sender.substr(0, UINT16_MAX);
+    size_t textLength = prefix.size() + body.size();
+    size_t size = RecordOverhead + conversation.size() + sender.size() + textLength;
+
+    // the record is encoded and checksummed here on the caller's thread, so the lock only covers one append
+    m_record.resize(size);
+    char* p = m_record.data();
+    StoreAt<uint32_t>(p, (uint32_t)size);
+    StoreAt<int64_t>(p + 8, message.timestamp);
+    p[16] = (char)message.kind;
+    p[17] = (char)message.flags;
+    StoreAt<uint16_t>(p + 18, prefix.size() <= UINT16_MAX ? (uint16_t)prefix.size() : (uint16_t)0);
+    StoreAt<uint16_t>(p + 20, (uint16_t)conversation.size());
+    StoreAt<uint16_t>(p + 22, (uint16_t)sender.size());
+    StoreAt<uint32_t>(p + 24, (uint32_t)textLength);
+    char* strings = p + RecordHeader;
+    if (!conversation.empty()) {
+        memcpy(strings, conversation.data(), conversation.size());
+    }
+    if (!sender.empty()) {
+        memcpy(strings + conversation.size(), sender.data(), sender.size());
+    }
+    char* text = strings + conversation.size() + sender.size();
+    if (!prefix.empty()) {
+        memcpy(text, prefix.data(), prefix.size());
+    }
+    if (!body.empty()) {
+        memcpy(text + prefix.size(), body.data(), body.size());
+    }
+    StoreAt<uint32_t>(p + size - 4, (uint32_t)size);
+    StoreAt<uint32_t>(p + 4, Crc32(p + 8, size - 12));
+
+    // the writer sleeps out the rest of the sync interval on its own, only the first record of a batch has to wake it
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_writer.joinable()) {
+            return;
+        }
+        wake = m_pending.empty();
+        m_pending.append(m_record);
+        m_pendingRecords++;
+    }
+    if (wake) {
+        m_ready.notify_one();
+    }
+}
+
+bool ChatLog::StartSegment() {
+    if (m_segment) {
+        fclose(m_segment);
+        m_segmentIndex++;
+    }
+    // appending, the first segment of a run may be the newest one of the last run
+    std::string path = SegmentPath(m_segmentIndex);
+    m_segment = fopen(path.c_str(), "ab");
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    m_segmentSize = error ? 0 : (size_t)size;
+    if (m_firstSegment == 0) {
+        m_firstSegment = m_segmentIndex;
+    }
+    if (m_segment) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.segments++;
+    }
+    Prune();
+    return m_segment != nullptr;
+}
+
+void ChatLog::Prune() {
+    if (m_retention.maxSegments == 0 && m_retention.maxBytes == 0) {
+        return;
+    }
+    // the segment being written is never deleted, and for maxBytes it counts as full so the log stays within the limit
+    // until the next segment starts
+    std::vector<uint64_t> sizes;
+    uint64_t bytes = m_segmentBytes;
+    std::error_code error;
+    for (uint64_t index = m_firstSegment; index < m_segmentIndex; index++) {
+        uintmax_t size = std::filesystem::file_size(SegmentPath(index), error);
+        sizes.push_back(error ? 0 : (uint64_t)size);
+        bytes += sizes.back();
+    }
+    uint64_t removed = 0;
+    for (uint64_t size : sizes) {
+        uint64_t segments = m_segmentIndex - m_firstSegment + 1;
+        bool tooMany = m_retention.maxSegments != 0 && segments > m_retention.maxSegments;
+        bool tooBig = m_retention.maxBytes != 0 && bytes > m_retention.maxBytes;
+        if (!tooMany && !tooBig) {
+            break;
+        }
+        // a segment that is gone already (a write error skipped its index) counts as removed
+        std::filesystem::remove(SegmentPath(m_firstSegment), error);
+        bytes -= size;
+        m_firstSegment++;
+        removed++;
+    }
+    if (removed != 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.segmentsRemoved += removed;
+    }
+}
+
+void ChatLog::WriterLoop() {
+    std::string batch;
+    auto interval = std::chrono::milliseconds(m_syncIntervalMs);
+    auto lastSync = std::chrono::steady_clock::now() - interval;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_ready.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+        // we let more records join the batch until the sync interval is up, one fsync per interval is plenty for a chat
+        // and it keeps a burst of messages from turning into a burst of disk flushes
+        m_ready.wait_until(lock, lastSync + interval, [this] { return m_stop; });
+        if (m_pending.empty()) {
+            if (m_stop) {
+                break;
+            }
+            continue;
+        }
+        batch.swap(m_pending);
+        size_t bytes = batch.size();
+        uint64_t records = m_pendingRecords;
+        m_pendingRecords = 0;
+        lock.unlock();
+
+        // a batch never straddles two segments, a segment may run over segmentBytes by the last batch written to it
+        bool ok = true;
+        if (!m_segment || (m_segmentSize != 0 && m_segmentSize + batch.size() > m_segmentBytes)) {
+            ok = StartSegment();
+        }
+        if (ok) {
+            ok = fwrite(batch.data(), 1, batch.size(), m_segment) == batch.size() && SyncFile(m_segment);
+            m_segmentSize += batch.size();
+            if (!ok) {
+                // the batch is lost, the next one goes into a fresh segment and LoadTail() skips the torn end of this one
+                fclose(m_segment);
+                m_segment = nullptr;
+                m_segmentIndex++;
+            }
+        }
+        lastSync = std::chrono::steady_clock::now();
+        batch.clear();
+
+        lock.lock();
+        if (ok) {
+            m_stats.recordsWritten += records;
+            m_stats.bytesWritten += bytes;
+            m_stats.syncs++;
+        }
+    }
+    lock.unlock();
+    if (m_segment) {
+        fclose(m_segment);
+        m_segment = nullptr;
+    }
+}
+
+ChatLog::Stats ChatLog::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
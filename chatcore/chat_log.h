@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "chat_history.h"
+
+// one message read back from the log, the views point into a mapped segment and are only valid during the visit
+struct LoggedMessage {
+    std::string_view conversation; // the DM peer, empty for the global chat
+    std::string_view sender;
+    ChatMessage message;           // text and its length point into the segment too, sender is not set
+};
+
+// how much of the log ChatLog keeps on disk, 0 means no limit
+// when a new segment starts the oldest segments are deleted until the log fits, so it can only run over maxBytes by
+// the last batch written to the newest segment
+struct LogRetention {
+    size_t maxSegments = 0;
+    uint64_t maxBytes = 0;
+};
+
+// ChatLog keeps every chat and DM message on disk so a restarted client shows its history right away
+// the log is a directory of segment files chat-<n>.log, each an append-only run of records:
+//   u32 size | u32 crc | i64 timestamp | u8 kind | u8 flags | u16 bodyOffset | u16 conversation length
+//   | u16 sender length | u32 text length | conversation | sender | text | u32 size
+// size counts the whole record, crc is the CRC-32 of everything between it and the trailing size
+// the trailing copy of size lets LoadTail() walk a mapped segment backwards from its end, so startup only touches
+// the records it shows no matter how long the log is, and the crc catches a record torn by a crash
+// Append() only encodes the record into a buffer, a background thread writes the buffer out and fsyncs once per batch
+class ChatLog {
+public:
+    ChatLog() = default;
+    ~ChatLog();
+
+    ChatLog(const ChatLog&) = delete;
+    ChatLog& operator=(const ChatLog&) = delete;
+
+    // opens or creates the log in directory and starts the writer thread, new records go on at the end of the newest
+    // segment while it has room, a record torn by a crash at its end is cut off here
+    bool Open(const std::string& directory, const LogRetention& retention = LogRetention(), size_t segmentBytes = 16 * 1024 * 1024,
+        int syncIntervalMs = 100);
+    // writes and syncs whatever is still queued and stops the writer thread
+    void Close();
+    bool IsOpen() const { return m_writer.joinable(); }
+
+    // visits the newest maxRecords records, oldest first, call it before the first Append()
+    // returns how many were visited
+    size_t LoadTail(size_t maxRecords, const std::function<void(const LoggedMessage&)>& visit);
+
+    // queues one message for the writer thread, the display line is prefix and body like in ChatHistory::Append()
+    // and only the timestamp, kind and flags of message are used, a single thread appends (the UI thread in the client)
+    void Append(std::string_view conversation, std::string_view sender, const ChatMessage& message, std::string_view prefix, std::string_view body);
+
+    struct Stats {
+        uint64_t recordsWritten = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t syncs = 0; // recordsWritten / syncs is the batching factor
+        uint64_t segments = 0;        // segments started or continued
+        uint64_t segmentsRemoved = 0; // old segments deleted to keep to the retention
+    };
+    Stats GetStats() const;
+
+private:
+    void WriterLoop();
+    bool StartSegment();
+    void Prune();
+    std::string SegmentPath(uint64_t index) const;
+
+    std::string m_directory;
+    LogRetention m_retention;
+    size_t m_segmentBytes = 0;
+    int m_syncIntervalMs = 0;
+    uint64_t m_firstSegment = 0; // the oldest segment on disk, Prune() moves it forward once the writer runs
+    uint64_t m_lastSegment = 0;  // the newest segment on disk when we opened
+
+    // filled by Append(), swapped out by the writer thread, guarded by m_mutex
+    mutable std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::string m_pending;
+    uint64_t m_pendingRecords = 0;
+    bool m_stop = false;
+    Stats m_stats;
+
+    // only the writer thread touches these once it runs
+    std::thread m_writer;
+    FILE* m_segment = nullptr;
+    uint64_t m_segmentIndex = 0;
+    size_t m_segmentSize = 0;
+
+    std::string m_record; // encoding scratch for Append()
+};
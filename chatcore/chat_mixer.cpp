@@ -0,0 +1,235 @@
+#include "chat_mixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "chat_cpu.h"
+#include "chat_mmap.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define CHAT_MIX_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define CHAT_MIX_TARGET_AVX2
+#else
+#define CHAT_MIX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+// the kernels multiply and then add instead of fusing the two, so every implementation gives the same bits
+
+#if CHAT_MIX_X86
+void MixSSE2(float* accumulator, const int16_t* samples, size_t count, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+        // SSE2 has no sign extension, we put every sample in the high half of a 32 bit lane and shift it back down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        __m128 a0 = _mm_add_ps(_mm_loadu_ps(accumulator + i), _mm_mul_ps(_mm_cvtepi32_ps(lo), g));
+        __m128 a1 = _mm_add_ps(_mm_loadu_ps(accumulator + i + 4), _mm_mul_ps(_mm_cvtepi32_ps(hi), g));
+        _mm_storeu_ps(accumulator + i, a0);
+        _mm_storeu_ps(accumulator + i + 4, a1);
+    }
+    MixSamplesScalar(accumulator + i, samples + i, count - i, gain);
+}
+
+void ConvertSSE2(const float* accumulator, int16_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // the conversion rounds to nearest even like lrintf() and the pack saturates to 16 bits
+        __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(accumulator + i));
+        __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(accumulator + i + 4));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+    }
+    ConvertMixScalar(accumulator + i, out + i, count - i);
+}
+
+CHAT_MIX_TARGET_AVX2 void MixAVX2(float* accumulator, const int16_t* samples, size_t count, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 f0 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i))));
+        __m256 f1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i + 8))));
+        __m256 a0 = _mm256_add_ps(_mm256_loadu_ps(accumulator + i), _mm256_mul_ps(f0, g));
+        __m256 a1 = _mm256_add_ps(_mm256_loadu_ps(accumulator + i + 8), _mm256_mul_ps(f1, g));
+        _mm256_storeu_ps(accumulator + i, a0);
+        _mm256_storeu_ps(accumulator + i + 8, a1);
+    }
+    MixSamplesScalar(accumulator + i, samples + i, count - i, gain);
+}
+
+CHAT_MIX_TARGET_AVX2 void ConvertAVX2(const float* accumulator, int16_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_cvtps_epi32(_mm256_loadu_ps(accumulator + i));
+        __m256i b = _mm256_cvtps_epi32(_mm256_loadu_ps(accumulator + i + 8));
+        // the pack works within each 128 bit lane, a0-3 b0-3 a4-7 b4-7, the permute puts the quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(out + i), packed);
+    }
+    ConvertMixScalar(accumulator + i, out + i, count - i);
+}
+#endif
+
+struct MixerKernels {
+    void (*mix)(float*, const int16_t*, size_t, float);
+    void (*convert)(const float*, int16_t*, size_t);
+    const char* name;
+};
+
+MixerKernels PickKernels() {
+#if CHAT_MIX_X86
+    if (CpuHasAVX2()) {
+        return { MixAVX2, ConvertAVX2, "avx2" };
+    }
+    return { MixSSE2, ConvertSSE2, "sse2" };
+#else
+    return { MixSamplesScalar, ConvertMixScalar, "scalar" };
+#endif
+}
+
+// we resolve the implementation once, function local statics are thread safe to initialise
+const MixerKernels& Kernels() {
+    static const MixerKernels kernels = PickKernels();
+    return kernels;
+}
+
+}
+
+void MixSamplesScalar(float* accumulator, const int16_t* samples, size_t count, float gain) {
+    for (size_t i = 0; i < count; i++) {
+        accumulator[i] += (float)samples[i] * gain;
+    }
+}
+
+void ConvertMixScalar(const float* accumulator, int16_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        long sample = std::lrintf(accumulator[i]);
+        out[i] = (int16_t)std::clamp(sample, -32768L, 32767L);
+    }
+}
+
+void MixSamples(float* accumulator, const int16_t* samples, size_t count, float gain) {
+    Kernels().mix(accumulator, samples, count, gain);
+}
+
+void ConvertMix(const float* accumulator, int16_t* out, size_t count) {
+    Kernels().convert(accumulator, out, count);
+}
+
+const char* MixerKernelName() {
+    return Kernels().name;
+}
+
+NotificationMixer::NotificationMixer(SampleFormat format, size_t voices) : m_format(format), m_queue(QueueCapacity), m_voices(std::max<size_t>(voices, 1)) {
+    for (std::atomic<float>& volume : m_volume) {
+        volume.store(1.0f, std::memory_order_relaxed);
+    }
+    // room for blocks up to 100 ms, so the rendering thread does not allocate for the usual 10 ms ones
+    m_accumulator.resize((size_t)m_format.sampleRate / 10 * m_format.channels);
+}
+
+bool NotificationMixer::Load(NotificationSound sound, const std::string& path) {
+    MappedFile file;
+    std::vector<int16_t>& samples = m_owned[(size_t)sound];
+    std::string error;
+    if (!file.Map(path) || !ConvertWav((const uint8_t*)file.data(), file.size(), m_format, samples, error)) {
+        return false;
+    }
+    m_samples[(size_t)sound] = samples.data();
+    m_lengths[(size_t)sound] = samples.size();
+    return true;
+}
+
+bool NotificationMixer::LoadCached(NotificationSound sound, const SampleCache& cache) {
+    const std::vector<int16_t>& samples = cache.Samples(sound);
+    if (samples.empty() || cache.Format().sampleRate != m_format.sampleRate || cache.Format().channels != m_format.channels) {
+        return false;
+    }
+    m_samples[(size_t)sound] = samples.data();
+    m_lengths[(size_t)sound] = samples.size();
+    return true;
+}
+
+void NotificationMixer::Play(NotificationSound sound) {
+    if (!m_queue.TryPush(std::move(sound))) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void NotificationMixer::SetVolume(NotificationSound sound, float volume) {
+    m_volume[(size_t)sound].store(std::clamp(volume, 0.0f, 1.0f), std::memory_order_relaxed);
+}
+
+void NotificationMixer::Start(NotificationSound sound) {
+    const int16_t* samples = m_samples[(size_t)sound];
+    if (!samples) {
+        return;
+    }
+    Voice* voice;
+    if (m_active < m_voices.size()) {
+        voice = &m_voices[m_active++];
+    }
+    else {
+        voice = &*std::max_element(m_voices.begin(), m_voices.end(), [](const Voice& a, const Voice& b) { return a.position < b.position; });
+        m_stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+    voice->samples = samples;
+    voice->length = m_lengths[(size_t)sound];
+    voice->position = 0;
+    voice->sound = sound;
+    m_started.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NotificationMixer::Render(int16_t* out, size_t frames) {
+    m_blocks.fetch_add(1, std::memory_order_relaxed);
+    NotificationSound sound;
+    while (m_queue.TryPop(sound)) {
+        Start(sound);
+    }
+    size_t count = frames * m_format.channels;
+    if (m_active == 0) {
+        memset(out, 0, count * sizeof(int16_t));
+        return;
+    }
+    if (m_accumulator.size() < count) {
+        m_accumulator.resize(count);
+    }
+    float* accumulator = m_accumulator.data();
+    std::fill(accumulator, accumulator + count, 0.0f);
+    float gains[3];
+    for (size_t i = 0; i < 3; i++) {
+        gains[i] = m_volume[i].load(std::memory_order_relaxed);
+    }
+    for (size_t v = 0; v < m_active;) {
+        Voice& voice = m_voices[v];
+        size_t n = std::min(count, voice.length - voice.position);
+        MixSamples(accumulator, voice.samples + voice.position, n, gains[(size_t)voice.sound]);
+        voice.position += n;
+        if (voice.position < voice.length) {
+            v++;
+            continue;
+        }
+        // a finished voice makes room for the last playing one, the playing voices stay at the front
+        voice = m_voices[--m_active];
+    }
+    ConvertMix(accumulator, out, count);
+}
+
+NotificationMixer::Stats NotificationMixer::GetStats() const {
+    Stats stats;
+    stats.started = m_started.load(std::memory_order_relaxed);
+    stats.stolen = m_stolen.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.blocks = m_blocks.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chat_audio.h"
+#include "chat_mpsc.h"
+#include "chat_samples.h"
+
+// we add count samples times gain onto the accumulator, the samples are 16 bit and so is the accumulator's scale
+// the implementation is picked once at runtime: AVX2 or SSE2 on x86 and a scalar loop everywhere else
+void MixSamples(float* accumulator, const int16_t* samples, size_t count, float gain);
+// we round the accumulator to 16 bit samples, what does not fit is clamped
+void ConvertMix(const float* accumulator, int16_t* out, size_t count);
+
+// the scalar versions are always available, the benchmarks use them directly
+void MixSamplesScalar(float* accumulator, const int16_t* samples, size_t count, float gain);
+void ConvertMixScalar(const float* accumulator, int16_t* out, size_t count);
+
+// returns "avx2", "sse2" or "scalar" depending on which implementation MixSamples() dispatches to
+const char* MixerKernelName();
+
+// NotificationMixer plays the notification sounds itself: a fixed pool of voices is mixed into a single output stream,
+// so a sound costs a queue push and its share of the next blocks instead of a source voice made for it
+//   Play() may come from any thread, it pushes the sound onto an MpscQueue and Render() starts the queued sounds at
+//   the beginning of its block, the voices belong to the rendering thread alone and nothing on the audio path locks
+//   when every voice is busy the one that has played longest is taken over
+//   every sound has a volume of its own, applied while mixing
+// the output is interleaved 16 bit in format, the sounds are converted to it when they are loaded, a sound loaded from
+// a SampleCache is used in place, so the cache must outlive the mixer
+// the Load functions must be done before anything renders
+class NotificationMixer : public INotificationAudio {
+public:
+    static constexpr size_t DefaultVoices = 32;
+    static constexpr size_t QueueCapacity = 64;
+
+    explicit NotificationMixer(SampleFormat format = SampleFormat(), size_t voices = DefaultVoices);
+
+    NotificationMixer(const NotificationMixer&) = delete;
+    NotificationMixer& operator=(const NotificationMixer&) = delete;
+
+    bool Load(NotificationSound sound, const std::string& path) override;
+    bool LoadCached(NotificationSound sound, const SampleCache& cache) override;
+    // any thread, never blocks, a sound that finds the queue full is dropped
+    void Play(NotificationSound sound) override;
+
+    // any thread, 0 silences the sound and 1 plays it as recorded, anything else is clamped to that range
+    void SetVolume(NotificationSound sound, float volume);
+    float Volume(NotificationSound sound) const { return m_volume[(size_t)sound].load(std::memory_order_relaxed); }
+
+    // the rendering thread: the next frames of the output
+    void Render(int16_t* out, size_t frames);
+
+    const SampleFormat& Format() const { return m_format; }
+    size_t Voices() const { return m_voices.size(); }
+    size_t ActiveVoices() const { return m_active; } // rendering thread
+
+    struct Stats {
+        uint64_t started = 0;
+        uint64_t stolen = 0;  // started on a voice that was still playing
+        uint64_t dropped = 0; // found the queue full
+        uint64_t blocks = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Voice {
+        const int16_t* samples = nullptr;
+        size_t length = 0;   // in samples, not frames
+        size_t position = 0;
+        NotificationSound sound = NotificationSound::Message;
+    };
+
+    void Start(NotificationSound sound);
+
+    SampleFormat m_format;
+    std::array<std::vector<int16_t>, 3> m_owned; // the sounds loaded from a file
+    std::array<const int16_t*, 3> m_samples{};
+    std::array<size_t, 3> m_lengths{};
+    std::array<std::atomic<float>, 3> m_volume;
+
+    MpscQueue<NotificationSound> m_queue;
+    std::vector<Voice> m_voices; // the first m_active of them are playing
+    size_t m_active = 0;
+    std::vector<float> m_accumulator;
+
+    std::atomic<uint64_t> m_started{ 0 };
+    std::atomic<uint64_t> m_stolen{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_blocks{ 0 };
+};
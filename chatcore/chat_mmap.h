@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// MappedFile maps a whole file read-only, the chat log reads its segments through it and the sample cache its WAV files
+// an empty file maps to nothing and that is fine
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Map(const std::string& path);
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_data ? m_size : 0; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#if defined(_WIN32)
+    void* m_file = nullptr;    // a HANDLE, INVALID_HANDLE_VALUE until the file is open
+    void* m_mapping = nullptr; // a HANDLE
+#endif
+};
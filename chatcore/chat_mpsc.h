@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// MpscQueue is a bounded lock-free ring for any number of producer threads and exactly one consumer thread
+// the notification worker uses it so the receive thread and the UI thread can both queue a sound without a lock
+// every slot carries a sequence number that says whose turn it is:
+//   sequence == position      the slot is free for the producer that claims position
+//   sequence == position + 1  the value is written and the consumer may take it
+// a producer claims a position with one compare-exchange on the tail and publishes the value with a release store
+// of the slot's sequence, so a producer that is preempted halfway only holds up its own slot, never the others
+template <typename T>
+class MpscQueue {
+public:
+    // the capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        m_slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; i++) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_size = size;
+        m_mask = size - 1;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // any thread, returns false and leaves value alone when the ring is full
+    bool TryPush(T&& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[tail & m_mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t turn = (intptr_t)sequence - (intptr_t)tail;
+            if (turn == 0) {
+                // on failure tail is reloaded and we look at the slot of the position another producer left us
+                if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (turn < 0) {
+                // the consumer has not taken the value a lap ago out of this slot yet
+                return false;
+            }
+            else {
+                tail = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(value);
+        slot->sequence.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, returns false when the ring is empty or the next value is still being written
+    bool TryPop(T& value) {
+        Slot& slot = m_slots[m_head & m_mask];
+        if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) {
+            return false;
+        }
+        value = std::move(slot.value);
+        // free for the producer that claims this slot one lap later
+        slot.sequence.store(m_head + m_size, std::memory_order_release);
+        m_head++;
+        return true;
+    }
+
+    size_t Capacity() const { return m_size; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{ 0 };
+        T value{};
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_size = 0;
+    size_t m_mask = 0;
+
+    alignas(64) std::atomic<size_t> m_tail{ 0 }; // next position to claim, shared by the producers
+    alignas(64) size_t m_head = 0;                 // next position to pop, the consumer's alone
+};
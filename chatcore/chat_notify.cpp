@@ -0,0 +1,188 @@
+#include "chat_notify.h"
+
+#include "chat_audio.h"
+
+const char* NotificationSoundFile(NotificationSound sound) {
+    switch (sound) {
+    case NotificationSound::Message: return "message.wav";
+    case NotificationSound::DirectMessage: return "dm.wav";
+    case NotificationSound::Send: return "send.wav";
+    }
+    return "";
+}
+
+NotificationWorker::NotificationWorker() : m_queue(QueueCapacity) {}
+
+NotificationWorker::~NotificationWorker() {
+    Stop();
+}
+
+void NotificationWorker::Start(std::function<void(NotificationSound)> play, std::function<void()> threadStart, std::function<void()> threadStop) {
+    Stop();
+    m_stop = false;
+    m_thread = std::thread(&NotificationWorker::Run, this, std::move(play), std::move(threadStart), std::move(threadStop));
+}
+
+void NotificationWorker::Start(INotificationAudio& audio) {
+    Start([&audio](NotificationSound sound) { audio.Play(sound); }, [&audio] { audio.ThreadStart(); }, [&audio] { audio.ThreadStop(); });
+}
+
+void NotificationWorker::Stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_stop = true;
+    m_wake.fetch_add(1);
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+bool NotificationWorker::Post(NotificationSound sound) {
+    m_posted.fetch_add(1, std::memory_order_relaxed);
+    if (!m_queue.TryPush(std::move(sound))) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // the worker announces that it goes to sleep and then looks at the queue once more, we pushed and then look
+    // at its announcement, the fences on both sides keep either load from moving before the store ahead of it,
+    // so at least one of us sees the other
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        m_wakeups.fetch_add(1, std::memory_order_relaxed);
+        m_wake.fetch_add(1);
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+void NotificationWorker::Run(std::function<void(NotificationSound)> play, std::function<void()> threadStart, std::function<void()> threadStop) {
+    if (threadStart) {
+        threadStart();
+    }
+    NotificationSound sound;
+    while (!m_stop.load()) {
+        if (m_queue.TryPop(sound)) {
+            play(sound);
+            m_played.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        uint32_t wake = m_wake.load();
+        m_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_queue.TryPop(sound)) {
+            if (!m_stop.load()) {
+                m_wake.wait(wake);
+            }
+            m_sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        m_sleeping.store(false, std::memory_order_relaxed);
+        play(sound);
+        m_played.fetch_add(1, std::memory_order_relaxed);
+    }
+    // whatever is still queued belongs to a session that is over
+    while (m_queue.TryPop(sound)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (threadStop) {
+        threadStop();
+    }
+}
+
+NotificationWorker::Stats NotificationWorker::GetStats() const {
+    Stats stats;
+    stats.posted = m_posted.load(std::memory_order_relaxed);
+    stats.played = m_played.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.wakeups = m_wakeups.load(std::memory_order_relaxed);
+    return stats;
+}
+
+NotificationPolicy::NotificationPolicy(const Config& config) : m_config(config) {
+    if (m_config.maxVoices < 1) {
+        m_config.maxVoices = 1;
+    }
+    if (m_config.dmReservedVoices < 0 || m_config.dmReservedVoices >= m_config.maxVoices) {
+        m_config.dmReservedVoices = m_config.maxVoices - 1;
+    }
+    m_voiceEnds.resize((size_t)m_config.maxVoices);
+}
+
+bool NotificationPolicy::TakeVoice(int limit, Clock::time_point now) {
+    int busy = 0;
+    Clock::time_point* free = nullptr;
+    for (Clock::time_point& end : m_voiceEnds) {
+        if (end > now) {
+            busy++;
+        }
+        else if (free == nullptr) {
+            free = &end;
+        }
+    }
+    if (busy >= limit || free == nullptr) {
+        return false;
+    }
+    *free = now + m_config.voiceLength;
+    return true;
+}
+
+void NotificationPolicy::AllowSend(Clock::time_point now) {
+    // a send takes a voice when there is one but plays either way
+    TakeVoice(m_config.maxVoices, now);
+    m_stats.allowed++;
+}
+
+bool NotificationPolicy::NoteSend(Clock::time_point when) {
+    return m_sends.TryPush(std::move(when));
+}
+
+bool NotificationPolicy::Allow(NotificationSound sound, std::string_view conversation, Clock::time_point now) {
+    Clock::time_point sent;
+    while (m_sends.TryPop(sent)) {
+        AllowSend(sent);
+    }
+    if (sound == NotificationSound::Send) {
+        AllowSend(now);
+        return true;
+    }
+    if (sound == NotificationSound::Message) {
+        // the window counts from the sound that played, not from the last message, or a steady stream of lines
+        // would keep the global chat quiet for as long as it lasts
+        if (m_globalPlayed && now - m_globalPlayedAt < m_config.window) {
+            m_stats.coalesced++;
+            return false;
+        }
+        if (!TakeVoice(m_config.maxVoices - m_config.dmReservedVoices, now)) {
+            m_stats.voiceLimited++;
+            return false;
+        }
+        m_globalPlayed = true;
+        m_globalPlayedAt = now;
+        m_stats.allowed++;
+        return true;
+    }
+
+    auto it = m_dmPlayedAt.find(conversation);
+    if (it != m_dmPlayedAt.end() && now - it->second < m_config.window) {
+        m_stats.coalesced++;
+        return false;
+    }
+    if (!TakeVoice(m_config.maxVoices, now)) {
+        m_stats.voiceLimited++;
+        return false;
+    }
+    if (it != m_dmPlayedAt.end()) {
+        it->second = now;
+    }
+    else {
+        // a peer whose window is over needs no entry, we drop those before the map grows with every new peer
+        if (m_dmPlayedAt.size() >= 64) {
+            for (auto old = m_dmPlayedAt.begin(); old != m_dmPlayedAt.end();) {
+                old = now - old->second >= m_config.window ? m_dmPlayedAt.erase(old) : std::next(old);
+            }
+        }
+        m_dmPlayedAt.emplace(std::string(conversation), now);
+    }
+    m_stats.allowed++;
+    return true;
+}
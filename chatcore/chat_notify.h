@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "chat_mpsc.h"
+
+class INotificationAudio;
+
+// the sounds a front-end plays, one byte on the notification queue
+enum class NotificationSound : uint8_t {
+    Message,       // a global chat line from someone else
+    DirectMessage, // a DM from someone else
+    Send,          // we sent a message
+};
+
+// the file a front-end loads for every notification sound, relative to its working directory
+const char* NotificationSoundFile(NotificationSound sound);
+
+// NotificationWorker plays notification sounds on a thread of its own, so the thread that noticed a message
+// (the receive thread, or the UI thread for our own sends) never waits for the audio system
+// posting is a push of one byte into a lock-free MpscQueue, the worker sleeps on an atomic while the queue is empty
+// and a producer only makes the system call that wakes it when it is actually asleep
+// when the audio system falls behind the queue fills up and further sounds are dropped instead of waited for
+class NotificationWorker {
+public:
+    static constexpr size_t QueueCapacity = 256;
+
+    NotificationWorker();
+    ~NotificationWorker();
+
+    NotificationWorker(const NotificationWorker&) = delete;
+    NotificationWorker& operator=(const NotificationWorker&) = delete;
+
+    // play runs on the worker thread for every posted sound, threadStart and threadStop run on it before the
+    // first and after the last one (the Windows client initialises COM there for XAudio2)
+    void Start(std::function<void(NotificationSound)> play, std::function<void()> threadStart = {}, std::function<void()> threadStop = {});
+    // the same with a sink from chat_audio.h, it must outlive the worker
+    void Start(INotificationAudio& audio);
+    // joins the worker, sounds still in the queue are dropped
+    void Stop();
+
+    // any thread, never blocks, false when the queue is full and the sound was dropped
+    bool Post(NotificationSound sound);
+
+    struct Stats {
+        uint64_t posted = 0;
+        uint64_t played = 0;
+        uint64_t dropped = 0;
+        uint64_t wakeups = 0; // posts that had to wake the worker up
+    };
+    Stats GetStats() const;
+
+private:
+    void Run(std::function<void(NotificationSound)> play, std::function<void()> threadStart, std::function<void()> threadStop);
+
+    MpscQueue<NotificationSound> m_queue;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{ false };
+    std::atomic<bool> m_sleeping{ false };
+    std::atomic<uint32_t> m_wake{ 0 }; // bumped to wake the worker, it waits for it to change
+
+    std::atomic<uint64_t> m_posted{ 0 };
+    std::atomic<uint64_t> m_played{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_wakeups{ 0 };
+};
+
+// NotificationPolicy decides which notifications actually make a sound, so a storm of chat lines plays a handful of
+// sounds instead of hundreds of overlapping voices
+//   every conversation (the global chat, each DM peer) plays at most one sound per window, the messages that arrive
+//   before the window is over are covered by the sound that already played
+//   at most maxVoices sounds play at once, a sound counts as playing for voiceLength after it started, and the global
+//   chat may not take the last dmReservedVoices of them, so a busy global chat never silences a DM
+//   our own sends are feedback for something the user just did, they are never held back but take a voice too
+// like FrameScheduler it owns no clock, the caller passes the time in, so it can be tested without waiting
+// it is not thread-safe, except for NoteSend(): the Windows client asks it on the receive thread, while its sends
+// happen on the UI thread, which plays them right away and hands their time over through a small lock-free queue
+class NotificationPolicy {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        std::chrono::milliseconds window{ 2000 };
+        int maxVoices = 4;
+        int dmReservedVoices = 1;
+        std::chrono::milliseconds voiceLength{ 1000 }; // about as long as the longest of the notification sounds
+    };
+
+    NotificationPolicy() : NotificationPolicy(Config{}) {}
+    explicit NotificationPolicy(const Config& config);
+
+    static constexpr size_t SendQueueCapacity = 64;
+
+    // true if the sound should play now, conversation is the DM peer and ignored for the other sounds
+    // the sends noted since the last call take their voices first, at the time they were sent
+    bool Allow(NotificationSound sound, std::string_view conversation, Clock::time_point now);
+    // any thread, records a send whose sound the caller already plays, false when the queue is full and the send
+    // takes no voice
+    bool NoteSend(Clock::time_point when);
+
+    struct Stats {
+        uint64_t allowed = 0;
+        uint64_t coalesced = 0;    // held back because the conversation played a sound within the window
+        uint64_t voiceLimited = 0; // held back because too many sounds were still playing
+    };
+    Stats GetStats() const { return m_stats; }
+
+private:
+    bool TakeVoice(int limit, Clock::time_point now);
+    void AllowSend(Clock::time_point now);
+
+    Config m_config;
+    MpscQueue<Clock::time_point> m_sends{ SendQueueCapacity };
+    std::vector<Clock::time_point> m_voiceEnds; // one per voice, the voice is free once now has passed it
+    bool m_globalPlayed = false;
+    Clock::time_point m_globalPlayedAt;
+    std::map<std::string, Clock::time_point, std::less<>> m_dmPlayedAt; // by peer, pruned when it grows
+    Stats m_stats;
+};
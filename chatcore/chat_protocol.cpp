@@ -0,0 +1,324 @@
+#include "chat_protocol.h"
+
+#include <cctype>
+
+std::string trim(const std::string& str) {
+    return std::string(trimView(str));
+}
+
+std::string_view trimView(std::string_view str) {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+bool StartsWith(std::string_view str, std::string_view prefix) {
+    return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
+}
+
+// parses a whole view as an unsigned decimal number
+bool ParseNumber(std::string_view digits, uint64_t& value) {
+    if (digits.empty() || digits.size() > 19) {
+        return false;
+    }
+    value = 0;
+    for (char c : digits) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (uint64_t)(c - '0');
+    }
+    return true;
+}
+
+// parses a whole view as an unsigned hexadecimal number
+bool ParseHex(std::string_view digits, uint64_t& value) {
+    if (digits.empty() || digits.size() > 16) {
+        return false;
+    }
+    value = 0;
+    for (char c : digits) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        }
+        else {
+            return false;
+        }
+        value = (value << 4) | (uint64_t)digit;
+    }
+    return true;
+}
+
+// raw is the untrimmed line the separators refer to, msg is the trimmed message inside it
+ServerMessage Parse(std::string_view raw, std::string_view msg, const uint32_t* separators, size_t separatorCount) {
+    if (msg.empty()) {
+        return std::monostate();
+    }
+    size_t lead = (size_t)(msg.data() - raw.data());
+
+    if (StartsWith(msg, "USERS|")) {
+        // we received an updated user list from the server
+        UsersUpdate users;
+        users.names = msg.substr(6);
+        users.separators = separators;
+        users.separatorCount = separatorCount;
+        users.separatorBias = lead + 6;
+        return users;
+    }
+    if (StartsWith(msg, "DM|")) {
+        // the first '|' ends the tag, the second one ends the sender name
+        size_t p2 = std::string_view::npos;
+        if (separators) {
+            for (size_t i = 0; i < separatorCount; i++) {
+                size_t p = (size_t)separators[i] - lead;
+                if (p > 2 && p < msg.size() && msg[p] == '|') {
+                    p2 = p;
+                    break;
+                }
+            }
+        }
+        else {
+            p2 = msg.find('|', 3);
+        }
+        if (p2 == std::string_view::npos) {
+            return std::monostate();
+        }
+        DirectMessage dm;
+        dm.sender = trimView(msg.substr(3, p2 - 3));
+        dm.text = msg.substr(p2 + 1);
+        return dm;
+    }
+    if (StartsWith(msg, "USERS+|") || StartsWith(msg, "USERS-|")) {
+        std::string_view name = trimView(msg.substr(7));
+        if (name.empty()) {
+            return std::monostate();
+        }
+        if (msg[5] == '+') {
+            return UserAdded{ name };
+        }
+        return UserRemoved{ name };
+    }
+    if (StartsWith(msg, "USERS=|")) {
+        size_t p2 = msg.find('|', 7);
+        UserListChecksum sum;
+        if (p2 == std::string_view::npos || !ParseNumber(msg.substr(7, p2 - 7), sum.count) || !ParseHex(msg.substr(p2 + 1), sum.checksum)) {
+            return std::monostate();
+        }
+        return sum;
+    }
+    if (StartsWith(msg, "SESSION|")) {
+        size_t p2 = msg.find('|', 8);
+        if (p2 == std::string_view::npos) {
+            return std::monostate();
+        }
+        SessionInfo session;
+        session.token = msg.substr(8, p2 - 8);
+        std::string_view next = msg.substr(p2 + 1);
+        size_t p3 = next.find('|');
+        if (p3 != std::string_view::npos) {
+            if (!ParseNumber(next.substr(p3 + 1), session.received)) {
+                return std::monostate();
+            }
+            next = next.substr(0, p3);
+        }
+        if (!ParseNumber(next, session.nextSeq)) {
+            return std::monostate();
+        }
+        return session;
+    }
+    if (StartsWith(msg, "SYS|")) {
+        // we treat system messages as informational and non-interactive
+        SystemNotice notice;
+        notice.text = trimView(msg.substr(4));
+        if (notice.text.empty()) {
+            return std::monostate();
+        }
+        return notice;
+    }
+
+    // we process regular global chat messages, very short lines carry nothing worth showing
+    if (msg.size() <= 2) {
+        return std::monostate();
+    }
+    ChatLine chat;
+    chat.line = msg;
+    size_t colon = msg.find(':');
+    if (colon != std::string_view::npos) {
+        chat.sender = msg.substr(0, colon);
+        chat.text = trimView(msg.substr(colon + 1));
+    }
+    else {
+        chat.text = msg;
+    }
+    return chat;
+}
+
+}
+
+ServerMessage ParseServerLine(std::string_view line) {
+    return Parse(line, trimView(line), nullptr, 0);
+}
+
+ServerMessage ParseServerLine(const FramedLine& line) {
+    return Parse(line.text, trimView(line.text), line.separators, line.separatorCount);
+}
+
+ServerMessage ParseServerLine(const FramedLine& line, uint64_t& seq) {
+    // the separator offsets stay relative to line.text, Parse() works out how far the message starts into it
+    return Parse(line.text, trimView(StripSequence(line.text, seq)), line.separators, line.separatorCount);
+}
+
+std::string_view StripSequence(std::string_view line, uint64_t& seq) {
+    seq = 0;
+    if (line.empty() || line[0] != '#') {
+        return line;
+    }
+    size_t space = line.find(' ', 1);
+    if (space == std::string_view::npos || !ParseNumber(line.substr(1, space - 1), seq)) {
+        seq = 0;
+        return line;
+    }
+    return line.substr(space + 1);
+}
+
+namespace {
+
+// appends text with its line breaks turned into spaces
+void AppendSingleLine(std::string& packet, std::string_view text) {
+    size_t start = packet.size();
+    packet.append(text);
+    for (size_t i = start; i < packet.size(); i++) {
+        if (packet[i] == '\n' || packet[i] == '\r') {
+            packet[i] = ' ';
+        }
+    }
+}
+
+}
+
+std::string SingleLine(std::string_view text) {
+    std::string line;
+    AppendSingleLine(line, text);
+    return line;
+}
+
+std::string FormatGlobalMessage(std::string_view text) {
+    std::string packet;
+    packet.reserve(text.size() + 1);
+    AppendSingleLine(packet, text);
+    packet.append("\n");
+    return packet;
+}
+
+std::string FormatDirectMessage(std::string_view target, std::string_view text) {
+    std::string packet;
+    packet.reserve(5 + target.size() + text.size());
+    packet.append("DM|");
+    AppendSingleLine(packet, target);
+    packet.append("|");
+    AppendSingleLine(packet, text);
+    packet.append("\n");
+    return packet;
+}
+
+std::string FormatHello(const HelloRequest& hello) {
+    std::string packet = "HELLO|";
+    packet.append(hello.token).append("|").append(std::to_string(hello.lastSeq)).append("|");
+    if (hello.sequenced) {
+        packet.append("seq");
+    }
+    if (hello.userDeltas) {
+        packet.append(hello.sequenced ? ",udelta" : "udelta");
+    }
+    packet.append("\n");
+    return packet;
+}
+
+bool ParseHello(std::string_view line, HelloRequest& hello) {
+    std::string_view msg = trimView(line);
+    if (!StartsWith(msg, "HELLO|")) {
+        return false;
+    }
+    size_t p2 = msg.find('|', 6);
+    if (p2 == std::string_view::npos) {
+        return false;
+    }
+    hello = HelloRequest();
+    hello.token = msg.substr(6, p2 - 6);
+    size_t p3 = msg.find('|', p2 + 1);
+    if (!ParseNumber(msg.substr(p2 + 1, p3 == std::string_view::npos ? std::string_view::npos : p3 - p2 - 1), hello.lastSeq)) {
+        return false;
+    }
+    if (p3 == std::string_view::npos) {
+        // the first version of HELLO had no capability list and always meant sequenced lines
+        hello.sequenced = true;
+        return true;
+    }
+    std::string_view caps = msg.substr(p3 + 1);
+    while (!caps.empty()) {
+        size_t comma = caps.find(',');
+        std::string_view cap = trimView(caps.substr(0, comma));
+        if (cap == "seq") {
+            hello.sequenced = true;
+        }
+        else if (cap == "udelta") {
+            hello.userDeltas = true;
+        }
+        caps = comma == std::string_view::npos ? std::string_view() : caps.substr(comma + 1);
+    }
+    return true;
+}
+
+std::string FormatUserListRequest() {
+    return "USERS|?\n";
+}
+
+ClientMessage ParseClientLine(std::string_view line) {
+    std::string_view msg = trimView(line);
+    if (msg.empty()) {
+        return std::monostate();
+    }
+    if (StartsWith(msg, "DM|")) {
+        size_t p2 = msg.find('|', 3);
+        if (p2 == std::string_view::npos) {
+            return std::monostate();
+        }
+        DirectRequest dm;
+        dm.target = trimView(msg.substr(3, p2 - 3));
+        dm.text = msg.substr(p2 + 1);
+        if (dm.target.empty() || dm.text.empty()) {
+            return std::monostate();
+        }
+        return dm;
+    }
+    if (msg == "USERS|?") {
+        return UserListRequest();
+    }
+    GlobalText global;
+    global.text = msg;
+    return global;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "chat_framer.h"
+
+// i needed a helper function to trim whitespace from incoming messages to avoid processing empty or whitespace-only messages which could cause issues with the chat display and notification system
+std::string trim(const std::string& str);
+
+// same trimming rules as trim() but it only narrows the view so no string is allocated
+std::string_view trimView(std::string_view str);
+
+// ASCII case insensitive comparison, the portable replacement for _stricmp on usernames
+bool EqualsIgnoreCase(std::string_view a, std::string_view b);
+
+// these are the messages the server can send us, every field is a view into the line we parsed
+// so parsing never allocates and the views stay valid only as long as the framer buffer does
+// anything that has to outlive the current line is copied when it is committed to the chat history
+
+// "USERS|alice,bob,carol" the full list of connected users
+struct UsersUpdate {
+    std::string_view names; // the comma separated part after "USERS|"
+    // comma positions from the structural scan relative to names.data(), null when the line was not indexed
+    const uint32_t* separators = nullptr;
+    size_t separatorCount = 0;
+    size_t separatorBias = 0; // added to every separator offset to make it relative to names.data()
+};
+
+// "USERS+|name" and "USERS-|name" one user joined or left, only sent to clients that asked for deltas in HELLO
+struct UserAdded {
+    std::string_view name;
+};
+
+struct UserRemoved {
+    std::string_view name;
+};
+
+// "USERS=|count|checksum" the server's view of the user list, checksum is the hex sum of UserNameHash() over all names
+// a client whose own directory disagrees asks for a fresh snapshot with "USERS|?"
+struct UserListChecksum {
+    uint64_t count = 0;
+    uint64_t checksum = 0;
+};
+
+// "DM|sender|text" a private message sent to us
+struct DirectMessage {
+    std::string_view sender;
+    std::string_view text;
+};
+
+// "SYS|text" informational notices such as joins and leaves
+struct SystemNotice {
+    std::string_view text;
+};
+
+// "sender: text" a regular global chat line, line is the whole trimmed message as it is shown in the chat
+struct ChatLine {
+    std::string_view sender;
+    std::string_view text;
+    std::string_view line;
+};
+
+// "SESSION|token|nextSeq|received" the answer to our HELLO, the token lets us resume this session after a dropped
+// connection, nextSeq is the sequence number the next history line will carry and received counts the lines
+// the server got from us in this session, so after a resume we know which of our own lines to send again
+struct SessionInfo {
+    std::string_view token;
+    uint64_t nextSeq = 0;
+    uint64_t received = 0;
+};
+
+// std::monostate means the line carried nothing to show (empty, too short or a malformed DM)
+using ServerMessage = std::variant<std::monostate, UsersUpdate, DirectMessage, SystemNotice, ChatLine, SessionInfo,
+    UserAdded, UserRemoved, UserListChecksum>;
+
+// these are the lines a client sends to the server once it joined
+// "DM|target|text" a private message for target
+struct DirectRequest {
+    std::string_view target;
+    std::string_view text;
+};
+
+// anything else is a message for the global chat
+struct GlobalText {
+    std::string_view text;
+};
+
+// "USERS|?" asks for a full user list snapshot after a checksum mismatch
+struct UserListRequest {};
+
+using ClientMessage = std::variant<std::monostate, DirectRequest, GlobalText, UserListRequest>;
+
+// these build the lines the Send buttons put on the wire, including the newline delimiter
+// a '\n' inside target or text would end the line early and the server would take the rest for another message
+// (and count one more line from us than we sent), so every '\r' and '\n' in them goes out as a space
+std::string FormatGlobalMessage(std::string_view text);
+std::string FormatDirectMessage(std::string_view target, std::string_view text);
+
+// text with every '\r' and '\n' replaced by a space, what the Format functions above put on the wire
+std::string SingleLine(std::string_view text);
+
+// "HELLO|token|lastSeq|caps" is sent before the username to turn on protocol extensions
+// caps is a comma separated list: "seq" asks for sequenced history lines (without it token and lastSeq are ignored)
+// and "udelta" for USERS+| and USERS-| deltas instead of repeated full USERS| snapshots
+// an empty token starts a new session, otherwise the server replays everything after lastSeq if it still has it
+struct HelloRequest {
+    std::string_view token;
+    uint64_t lastSeq = 0;
+    bool sequenced = false;
+    bool userDeltas = false;
+};
+
+std::string FormatHello(const HelloRequest& hello);
+bool ParseHello(std::string_view line, HelloRequest& hello);
+std::string FormatUserListRequest();
+
+// history lines on a sequenced connection start with "#<seq> ", we return the rest of the line and the number
+// a line without the prefix (USERS| snapshots, or any line from a server that does not sequence) gives seq 0
+std::string_view StripSequence(std::string_view line, uint64_t& seq);
+
+// we classify a single line received from a client, used by the reference server and the load generator
+ClientMessage ParseClientLine(std::string_view line);
+
+// we classify a single line received from the server without copying any of it
+ServerMessage ParseServerLine(std::string_view line);
+
+// same as above but it reuses the '|' and ',' positions the framer already found instead of searching the line again
+ServerMessage ParseServerLine(const FramedLine& line);
+
+// strips the "#<seq> " prefix first and hands the sequence number back, see StripSequence()
+ServerMessage ParseServerLine(const FramedLine& line, uint64_t& seq);
+
+// we walk the comma separated user list and call fn with every trimmed non empty name
+template <typename Fn>
+void ForEachUserName(const UsersUpdate& users, Fn&& fn) {
+    size_t start = 0;
+    if (users.separators) {
+        for (size_t i = 0; i < users.separatorCount; i++) {
+            size_t p = (size_t)users.separators[i] - users.separatorBias;
+            if (p < start || p >= users.names.size() || users.names[p] != ',') {
+                continue;
+            }
+            std::string_view name = trimView(users.names.substr(start, p - start));
+            if (!name.empty()) {
+                fn(name);
+            }
+            start = p + 1;
+        }
+    }
+    else {
+        size_t p;
+        while ((p = users.names.find(',', start)) != std::string_view::npos) {
+            std::string_view name = trimView(users.names.substr(start, p - start));
+            if (!name.empty()) {
+                fn(name);
+            }
+            start = p + 1;
+        }
+    }
+    // we add the last username after the final comma if it's not empty
+    std::string_view last = trimView(users.names.substr(start));
+    if (!last.empty()) {
+        fn(last);
+    }
+}
@@ -0,0 +1,181 @@
+#include "chat_samples.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "chat_mmap.h"
+
+namespace {
+
+uint16_t ReadU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// one sample of the file cut to 16 bits, 8 bit PCM is the only unsigned one
+int32_t DecodeSample(const uint8_t* p, uint16_t bits) {
+    switch (bits) {
+    case 8: return ((int32_t)p[0] - 128) * 256;
+    case 16: return (int16_t)ReadU16(p);
+    case 24: return (int16_t)ReadU16(p + 1);
+    case 32: return (int16_t)ReadU16(p + 2);
+    }
+    return 0;
+}
+
+}
+
+bool ParseWav(const uint8_t* data, size_t size, WavInfo& info) {
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const uint8_t* chunk = data + pos;
+        size_t chunkSize = ReadU32(chunk + 4);
+        size_t body = pos + 8;
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            // 1 is PCM, WAVE_FORMAT_EXTENSIBLE files are not worth the trouble for three notification sounds
+            if (chunkSize < 16 || body + 16 > size || ReadU16(data + body) != 1) {
+                return false;
+            }
+            info.channels = ReadU16(data + body + 2);
+            info.sampleRate = ReadU32(data + body + 4);
+            info.bitsPerSample = ReadU16(data + body + 14);
+            haveFormat = info.channels > 0 && info.sampleRate > 0 && info.bitsPerSample > 0;
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                return false;
+            }
+            info.dataOffset = body;
+            info.dataBytes = std::min(chunkSize, size - body);
+            return true;
+        }
+        // chunks are padded to an even size
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+bool ConvertWav(const uint8_t* data, size_t size, const SampleFormat& format, std::vector<int16_t>& samples, std::string& error) {
+    WavInfo info;
+    if (!ParseWav(data, size, info)) {
+        error = "not a PCM WAV file";
+        return false;
+    }
+    uint16_t bits = info.bitsPerSample;
+    if (bits != 8 && bits != 16 && bits != 24 && bits != 32) {
+        error = "unsupported sample size " + std::to_string(bits);
+        return false;
+    }
+    if (format.channels < 1 || format.channels > 2 || format.sampleRate == 0) {
+        error = "unsupported output format";
+        return false;
+    }
+    size_t frameBytes = (size_t)info.channels * (bits / 8);
+    size_t frames = info.dataBytes / frameBytes;
+    if (frames == 0) {
+        error = "no samples";
+        return false;
+    }
+    const uint8_t* in = data + info.dataOffset;
+    size_t channels = format.channels;
+
+    // the sounds shipped with the client are already in the output format, a copy is all they need
+    // the samples are little endian in the file, which every platform the client builds for is
+    if (bits == 16 && info.channels == channels && info.sampleRate == format.sampleRate) {
+        samples.resize(frames * channels);
+        memcpy(samples.data(), in, frames * frameBytes);
+        return true;
+    }
+
+    // the channels first at the file's rate, a file with more channels than two keeps its first two
+    std::vector<int16_t> mixed(frames * channels);
+    size_t sampleBytes = bits / 8;
+    for (size_t f = 0; f < frames; f++) {
+        const uint8_t* frame = in + f * frameBytes;
+        if (channels == 1) {
+            int32_t sum = 0;
+            for (size_t c = 0; c < info.channels; c++) {
+                sum += DecodeSample(frame + c * sampleBytes, bits);
+            }
+            mixed[f] = (int16_t)(sum / (int32_t)info.channels);
+        }
+        else {
+            int32_t left = DecodeSample(frame, bits);
+            int32_t right = info.channels > 1 ? DecodeSample(frame + sampleBytes, bits) : left;
+            mixed[2 * f] = (int16_t)left;
+            mixed[2 * f + 1] = (int16_t)right;
+        }
+    }
+    if (info.sampleRate == format.sampleRate) {
+        samples = std::move(mixed);
+        return true;
+    }
+
+    size_t outFrames = (size_t)((uint64_t)frames * format.sampleRate / info.sampleRate);
+    double step = (double)info.sampleRate / (double)format.sampleRate;
+    samples.resize(outFrames * channels);
+    for (size_t f = 0; f < outFrames; f++) {
+        double position = (double)f * step;
+        size_t a = std::min((size_t)position, frames - 1);
+        size_t b = std::min(a + 1, frames - 1);
+        double t = position - (double)a;
+        for (size_t c = 0; c < channels; c++) {
+            double from = mixed[a * channels + c];
+            double to = mixed[b * channels + c];
+            samples[f * channels + c] = (int16_t)(from + (to - from) * t);
+        }
+    }
+    return true;
+}
+
+SampleCache::SampleCache(SampleFormat format) : m_format(format) {}
+
+SampleCache::~SampleCache() {
+    Wait();
+}
+
+void SampleCache::LoadAsync(std::string directory, std::function<void(const SampleCache&)> then) {
+    Wait();
+    m_thread = std::thread([this, directory = std::move(directory), then = std::move(then)] {
+        Load(directory);
+        if (then) {
+            then(*this);
+        }
+    });
+}
+
+bool SampleCache::Load(const std::string& directory) {
+    m_began = Clock::now();
+    m_loaded = true;
+    for (NotificationSound sound : { NotificationSound::Message, NotificationSound::DirectMessage, NotificationSound::Send }) {
+        Sound& entry = m_sounds[(size_t)sound];
+        entry.path = directory.empty() ? NotificationSoundFile(sound) : directory + "/" + NotificationSoundFile(sound);
+        entry.samples.clear();
+        entry.error.clear();
+        // the mapping only lives while we convert, the cache keeps the converted samples and not the file
+        MappedFile file;
+        if (!file.Map(entry.path)) {
+            entry.error = "cannot open the file";
+        }
+        else {
+            ConvertWav((const uint8_t*)file.data(), file.size(), m_format, entry.samples, entry.error);
+        }
+        m_loaded = m_loaded && entry.error.empty();
+    }
+    m_ended = Clock::now();
+    return m_loaded;
+}
+
+bool SampleCache::Wait() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    return m_loaded;
+}
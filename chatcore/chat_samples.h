@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chat_notify.h"
+
+// the format of a PCM WAV file and where its samples are, as ParseWav() finds them in the file's bytes
+struct WavInfo {
+    uint16_t channels = 0;
+    uint32_t sampleRate = 0;
+    uint16_t bitsPerSample = 0;
+    size_t dataOffset = 0; // of the first sample in the file
+    size_t dataBytes = 0;
+};
+
+// walks the RIFF chunks of a WAV file in memory, false unless it is uncompressed PCM with a data chunk
+// a data chunk that claims more bytes than the file has is cut to what is there
+bool ParseWav(const uint8_t* data, size_t size, WavInfo& info);
+
+// what every sound is converted to once, so playing it is a copy or an add: interleaved signed 16 bit samples
+struct SampleFormat {
+    uint32_t sampleRate = 48000;
+    uint16_t channels = 2; // 1 or 2
+};
+
+// decodes the PCM in a WAV file (8, 16, 24 or 32 bit, any number of channels, any rate) into format
+// a mono file is played on both channels, a mono format gets the average of the file's channels and a stereo one
+// the first two, another rate is resampled linearly, which is plenty for a notification beep
+// false with a reason in error when the file is not a WAV file this can read
+bool ConvertWav(const uint8_t* data, size_t size, const SampleFormat& format, std::vector<int16_t>& samples, std::string& error);
+
+// SampleCache holds the notification sounds converted to the output format, ready to be mixed or handed to a voice
+// LoadAsync() maps the WAV files and converts them on a thread of its own, so a front-end brings its window and device
+// up meanwhile instead of reading files before it shows anything
+// the cache is read-only after loading, nothing may look at it before Wait() returned
+class SampleCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SampleCache(SampleFormat format = SampleFormat());
+    ~SampleCache();
+
+    SampleCache(const SampleCache&) = delete;
+    SampleCache& operator=(const SampleCache&) = delete;
+
+    // loads NotificationSoundFile() of every sound from directory, then runs then on the loading thread, a front-end
+    // whose audio system needs the files itself loads it there too
+    void LoadAsync(std::string directory, std::function<void(const SampleCache&)> then = {});
+    // the same on the calling thread, true when every sound loaded
+    bool Load(const std::string& directory);
+    // joins the loading thread, true when every sound loaded
+    bool Wait();
+
+    const SampleFormat& Format() const { return m_format; }
+    // empty when the sound did not load
+    const std::vector<int16_t>& Samples(NotificationSound sound) const { return m_sounds[(size_t)sound].samples; }
+    const std::string& Path(NotificationSound sound) const { return m_sounds[(size_t)sound].path; }
+    const std::string& Error(NotificationSound sound) const { return m_sounds[(size_t)sound].error; }
+
+    // when the loading ran, for a startup trace
+    Clock::time_point LoadBegan() const { return m_began; }
+    Clock::time_point LoadEnded() const { return m_ended; }
+
+private:
+    struct Sound {
+        std::string path;
+        std::vector<int16_t> samples;
+        std::string error;
+    };
+
+    SampleFormat m_format;
+    std::array<Sound, 3> m_sounds;
+    std::thread m_thread;
+    bool m_loaded = false;
+    Clock::time_point m_began;
+    Clock::time_point m_ended;
+};
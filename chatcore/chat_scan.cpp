@@ -0,0 +1,126 @@
+#include "chat_scan.h"
+
+#include "chat_cpu.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define CHAT_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define CHAT_SCAN_TARGET_AVX2
+#else
+#define CHAT_SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+// we turn every set bit of a movemask result into an absolute offset
+inline void EmitBits(uint32_t mask, uint32_t offset, std::vector<uint32_t>& out) {
+    while (mask) {
+#if defined(_MSC_VER)
+        unsigned long bit;
+        _BitScanForward(&bit, mask);
+#else
+        unsigned bit = (unsigned)__builtin_ctz(mask);
+#endif
+        out.push_back(offset + (uint32_t)bit);
+        mask &= mask - 1;
+    }
+}
+
+void ScanTail(const char* data, size_t begin, size_t length, uint32_t base, StructuralIndex& index) {
+    for (size_t i = begin; i < length; i++) {
+        char c = data[i];
+        if (c == '\n') {
+            index.newlines.push_back(base + (uint32_t)i);
+        }
+        else if (c == '|' || c == ',') {
+            index.separators.push_back(base + (uint32_t)i);
+        }
+    }
+}
+
+#if CHAT_SCAN_X86
+void ScanSSE2(const char* data, size_t length, uint32_t base, StructuralIndex& index) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i pipe = _mm_set1_epi8('|');
+    const __m128i comma = _mm_set1_epi8(',');
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        uint32_t nlMask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        uint32_t sepMask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, pipe), _mm_cmpeq_epi8(v, comma)));
+        EmitBits(nlMask, base + (uint32_t)i, index.newlines);
+        EmitBits(sepMask, base + (uint32_t)i, index.separators);
+    }
+    ScanTail(data, i, length, base, index);
+}
+
+CHAT_SCAN_TARGET_AVX2 void ScanAVX2(const char* data, size_t length, uint32_t base, StructuralIndex& index) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i pipe = _mm256_set1_epi8('|');
+    const __m256i comma = _mm256_set1_epi8(',');
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        uint32_t nlMask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        uint32_t sepMask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, pipe), _mm256_cmpeq_epi8(v, comma)));
+        EmitBits(nlMask, base + (uint32_t)i, index.newlines);
+        EmitBits(sepMask, base + (uint32_t)i, index.separators);
+    }
+    ScanTail(data, i, length, base, index);
+}
+#endif
+
+using ScanFn = void (*)(const char*, size_t, uint32_t, StructuralIndex&);
+
+struct ScannerChoice {
+    ScanFn fn;
+    const char* name;
+};
+
+ScannerChoice PickScanner() {
+#if CHAT_SCAN_X86
+    if (CpuHasAVX2()) {
+        return { ScanAVX2, "avx2" };
+    }
+    return { ScanSSE2, "sse2" };
+#else
+    return { ScanStructuralScalar, "scalar" };
+#endif
+}
+
+// we resolve the implementation once, function local statics are thread safe to initialise
+const ScannerChoice& Scanner() {
+    static const ScannerChoice choice = PickScanner();
+    return choice;
+}
+
+}
+
+void ScanStructuralScalar(const char* data, size_t length, uint32_t base, StructuralIndex& index) {
+    ScanTail(data, 0, length, base, index);
+}
+
+void ScanStructural(const char* data, size_t length, uint32_t base, StructuralIndex& index) {
+    Scanner().fn(data, length, base, index);
+}
+
+const char* StructuralScannerName() {
+    return Scanner().name;
+}
+
+std::vector<StructuralScanner> StructuralScanners() {
+    std::vector<StructuralScanner> scanners = { { "scalar", ScanStructuralScalar } };
+#if CHAT_SCAN_X86
+    scanners.push_back({ "sse2", ScanSSE2 });
+    if (CpuHasAVX2()) {
+        scanners.push_back({ "avx2", ScanAVX2 });
+    }
+#endif
+    return scanners;
+}
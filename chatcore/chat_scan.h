@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// StructuralIndex holds the positions of every protocol delimiter found in a received buffer
+// newlines frame the lines and separators ('|' and ',') split the USERS| and DM| payloads
+// so the framer and the parser never have to search the same bytes again
+struct StructuralIndex {
+    std::vector<uint32_t> newlines;
+    std::vector<uint32_t> separators;
+
+    void Clear() {
+        newlines.clear();
+        separators.clear();
+    }
+};
+
+// we scan data in a single pass and append base + offset of every '\n' to index.newlines
+// and of every '|' and ',' to index.separators, both lists stay sorted
+// the implementation is picked once at runtime: AVX2 or SSE2 on x86 and a scalar loop everywhere else
+void ScanStructural(const char* data, size_t length, uint32_t base, StructuralIndex& index);
+
+// the scalar version is always available, the benchmarks and the fallback path use it directly
+void ScanStructuralScalar(const char* data, size_t length, uint32_t base, StructuralIndex& index);
+
+// returns "avx2", "sse2" or "scalar" depending on which implementation ScanStructural() dispatches to
+const char* StructuralScannerName();
+
+// every implementation this cpu can run, scalar first and the one ScanStructural() dispatches to last
+// the benchmarks run them one after the other on the same data
+struct StructuralScanner {
+    const char* name;
+    void (*scan)(const char* data, size_t length, uint32_t base, StructuralIndex& index);
+};
+std::vector<StructuralScanner> StructuralScanners();
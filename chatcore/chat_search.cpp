@@ -0,0 +1,226 @@
+#include "chat_search.h"
+
+#include <algorithm>
+
+namespace {
+
+void PutVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+// walks a posting list front to back, the ids come out in increasing order
+class PostingReader {
+public:
+    explicit PostingReader(const std::string& bytes) : m_p((const unsigned char*)bytes.data()), m_end(m_p + bytes.size()) {}
+
+    bool Next(uint64_t& id) {
+        if (m_p == m_end) {
+            return false;
+        }
+        uint64_t gap = 0;
+        int shift = 0;
+        while (*m_p & 0x80) {
+            gap |= (uint64_t)(*m_p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        gap |= (uint64_t)*m_p++ << shift;
+        m_id += gap;
+        id = m_id;
+        return true;
+    }
+
+private:
+    const unsigned char* m_p;
+    const unsigned char* m_end;
+    uint64_t m_id = 0;
+};
+
+}
+
+void SearchIndex::Add(uint64_t id, std::string_view text) {
+    m_messages++;
+    m_lastId = id;
+    Tokenize(text, m_word, [this, id](const std::string& word) {
+        auto slot = m_words.try_emplace(word, (uint32_t)m_lists.size());
+        if (slot.second) {
+            m_lists.emplace_back();
+            m_lists.back().word = word;
+        }
+        PostingList& list = m_lists[slot.first->second];
+        if (list.count != 0 && list.last == id) {
+            // the word came up earlier in the same message
+            return;
+        }
+        PutVarint(list.bytes, id - list.last);
+        list.last = id;
+        list.count++;
+        m_postings++;
+    });
+    uint64_t oldest = Oldest();
+    if (!m_compacting && oldest - m_compactedTo >= std::max<size_t>(m_horizon / 2, 1)) {
+        m_compacting = true;
+        m_cutoff = oldest;
+        m_cursor = 0;
+    }
+    // a pass has half a horizon of messages to get through lists of at most 1.5 horizons, reading four times what
+    // this message added each time is done well before the next pass is due
+    CompactSome(4 * text.size() + 256);
+}
+
+uint64_t SearchIndex::Oldest() const {
+    if (m_horizon == 0 || m_messages == 0 || m_lastId + 1 <= m_horizon) {
+        return m_compactedTo;
+    }
+    return std::max(m_compactedTo, m_lastId + 1 - m_horizon);
+}
+
+bool SearchIndex::Trim(PostingList& list, uint64_t cutoff) {
+    if (list.last < cutoff) {
+        m_postings -= list.count;
+        return false;
+    }
+    uint64_t first = 0;
+    if (PostingReader(list.bytes).Next(first) && first >= cutoff) {
+        return true;
+    }
+    // the first id we keep is stored as its gap from 0, as in a list that started with it
+    std::string bytes;
+    uint32_t count = 0;
+    uint64_t previous = 0;
+    PostingReader reader(list.bytes);
+    for (uint64_t id; reader.Next(id);) {
+        if (id >= cutoff) {
+            PutVarint(bytes, id - previous);
+            previous = id;
+            count++;
+        }
+    }
+    m_postings -= list.count - count;
+    list.bytes = std::move(bytes);
+    list.count = count;
+    return true;
+}
+
+void SearchIndex::CompactSome(size_t budget) {
+    while (m_compacting) {
+        if (m_cursor >= m_lists.size()) {
+            m_compacting = false;
+            m_compactedTo = m_cutoff;
+            break;
+        }
+        if (budget == 0) {
+            break;
+        }
+        PostingList& list = m_lists[m_cursor];
+        budget -= std::min(budget, list.bytes.size() + 16);
+        if (Trim(list, m_cutoff)) {
+            m_cursor++;
+            continue;
+        }
+        // the last list takes the place of the empty one and is looked at next
+        m_words.erase(list.word);
+        if (m_cursor + 1 != m_lists.size()) {
+            list = std::move(m_lists.back());
+            m_words[list.word] = (uint32_t)m_cursor;
+        }
+        m_lists.pop_back();
+    }
+}
+
+void SearchIndex::SetHorizon(size_t messages) {
+    m_horizon = messages;
+    uint64_t oldest = Oldest();
+    if (oldest > m_compactedTo) {
+        // a pass under way may have passed lists with an older cutoff, we start over from the first one
+        m_compacting = true;
+        m_cutoff = oldest;
+        m_cursor = 0;
+        CompactSome(SIZE_MAX);
+    }
+}
+
+size_t SearchIndex::Search(std::string_view query, size_t maxResults, std::vector<uint64_t>& results) const {
+    results.clear();
+    std::vector<const PostingList*> lists;
+    bool missing = false;
+    std::string word;
+    Tokenize(query, word, [this, &lists, &missing](const std::string& token) {
+        auto it = m_words.find(token);
+        if (it == m_words.end()) {
+            missing = true;
+        }
+        else if (std::find(lists.begin(), lists.end(), &m_lists[it->second]) == lists.end()) {
+            lists.push_back(&m_lists[it->second]);
+        }
+    });
+    if (missing || lists.empty()) {
+        return 0;
+    }
+
+    // we start from the rarest word, every other list only has to confirm its candidates and we stop reading
+    // a list as soon as it has passed the last one
+    std::sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) { return a->count < b->count; });
+    std::vector<uint64_t> candidates;
+    candidates.reserve(lists[0]->count);
+    PostingReader first(lists[0]->bytes);
+    uint64_t oldest = Oldest();
+    for (uint64_t id; first.Next(id);) {
+        if (id >= oldest) {
+            candidates.push_back(id);
+        }
+    }
+    if (candidates.empty()) {
+        return 0;
+    }
+    // a list marks its ids in a bitmap over the candidates' range and the candidates keep themselves by their bit
+    // when two common words interleave, a merge of the sorted lists mispredicts a branch on almost every id
+    uint64_t low = candidates.front();
+    uint64_t high = candidates.back();
+    std::vector<uint64_t> bits;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+        bits.assign((size_t)((high - low) / 64 + 1), 0);
+        PostingReader reader(lists[i]->bytes);
+        for (uint64_t id; reader.Next(id) && id <= high;) {
+            if (id >= low) {
+                bits[(size_t)((id - low) / 64)] |= 1ull << ((id - low) % 64);
+            }
+        }
+        size_t kept = 0;
+        for (uint64_t id : candidates) {
+            candidates[kept] = id;
+            kept += (size_t)(bits[(size_t)((id - low) / 64)] >> ((id - low) % 64)) & 1;
+        }
+        candidates.resize(kept);
+    }
+
+    for (size_t i = candidates.size(); i-- > 0 && results.size() < maxResults;) {
+        results.push_back(candidates[i]);
+    }
+    return candidates.size();
+}
+
+void SearchIndex::Clear() {
+    m_lists.clear();
+    m_words.clear();
+    m_messages = 0;
+    m_postings = 0;
+    m_lastId = 0;
+    m_compactedTo = 0;
+    m_compacting = false;
+}
+
+SearchIndex::Stats SearchIndex::GetStats() const {
+    Stats stats;
+    stats.messages = m_messages;
+    stats.oldest = Oldest();
+    stats.words = m_lists.size();
+    stats.postings = m_postings;
+    for (const PostingList& list : m_lists) {
+        stats.postingBytes += list.bytes.size();
+    }
+    return stats;
+}
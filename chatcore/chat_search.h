@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// what a byte turns into inside a word of SearchIndex::Tokenize(), 0 for the bytes that separate words
+struct WordFoldTable {
+    unsigned char bytes[256];
+    constexpr WordFoldTable() : bytes() {
+        for (int c = 0; c < 256; c++) {
+            bool word = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+            bytes[c] = !word ? 0 : (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : (unsigned char)c;
+        }
+    }
+};
+inline constexpr WordFoldTable kWordFold;
+
+// SearchIndex is an inverted index over the messages of one conversation, it maps every word to the list of
+// message numbers it appears in so finding a word never looks at the messages themselves
+//   a word is a run of ASCII letters and digits (compared case-insensitively) or of UTF-8 bytes, longer than
+//   MaxTokenLength it is cut there, the same rule splits the messages and the query
+//   message numbers only grow, so a posting list stores the gap to the previous number as a varint,
+//   most gaps fit in one or two bytes instead of the eight of a plain uint64_t
+// messages evicted from the history stay findable and are read back from the spill file, so without a horizon the
+// index grows with the conversation: about 1.5 bytes per word of every message plus ~150 bytes per distinct word
+// SetHorizon() bounds it to the newest messages, older ids drop out of the search right away and out of memory in
+// passes: once they make up half the horizon every list is rewritten without them and the words left with no message
+// are forgotten, a few lists per Add() so no single message pays for the whole pass, and the index holds about 1.5
+// times the horizon
+class SearchIndex {
+public:
+    static constexpr size_t MaxTokenLength = 32;
+
+    // adds the words of text as message number id, ids must be handed in increasing order
+    void Add(uint64_t id, std::string_view text);
+
+    // the ids of the messages that contain every word of query, newest first and at most maxResults of them
+    // returns how many messages matched in total, an empty query matches nothing
+    size_t Search(std::string_view query, size_t maxResults, std::vector<uint64_t>& results) const;
+
+    // a search only covers the ids from the newest one back to messages ids before it, 0 covers every message
+    void SetHorizon(size_t messages);
+
+    void Clear();
+
+    struct Stats {
+        size_t messages = 0;      // added since Clear(), including the ones past the horizon
+        uint64_t oldest = 0;      // the oldest id a search can still return
+        size_t words = 0;         // distinct words
+        size_t postings = 0;      // (word, message) pairs
+        size_t postingBytes = 0;  // what the encoded lists fill
+    };
+    Stats GetStats() const;
+
+    // calls visit(word) for every word of text in order, lowercased
+    template <typename Visit>
+    static void Tokenize(std::string_view text, std::string& word, Visit&& visit) {
+        const unsigned char* p = (const unsigned char*)text.data();
+        const unsigned char* end = p + text.size();
+        while (p != end) {
+            while (p != end && kWordFold.bytes[*p] == 0) {
+                p++;
+            }
+            const unsigned char* start = p;
+            while (p != end && kWordFold.bytes[*p] != 0) {
+                p++;
+            }
+            if (p != start) {
+                word.assign((const char*)start, std::min<size_t>(p - start, MaxTokenLength));
+                for (char& c : word) {
+                    c = (char)kWordFold.bytes[(unsigned char)c];
+                }
+                visit(word);
+            }
+        }
+    }
+
+private:
+    struct PostingList {
+        std::string word;
+        std::string bytes; // varint gaps, the first one is counted from 0
+        uint64_t last = 0;
+        uint32_t count = 0;
+    };
+
+    uint64_t Oldest() const;
+    // rewrites lists of the running compaction pass until about budget bytes of them were read
+    void CompactSome(size_t budget);
+    // drops the ids below cutoff from list, false if none are left
+    bool Trim(PostingList& list, uint64_t cutoff);
+
+    // the lists sit in a vector the word map points into, so a compaction pass can walk them by position while
+    // Add() inserts new words, a list left empty is replaced by the last one
+    std::vector<PostingList> m_lists;
+    std::unordered_map<std::string, uint32_t> m_words;
+    size_t m_messages = 0;
+    size_t m_postings = 0;
+    size_t m_horizon = 0;
+    uint64_t m_lastId = 0;
+    uint64_t m_compactedTo = 0; // no list holds an id below it
+    bool m_compacting = false;  // a pass towards m_cutoff is under way, it has got as far as m_cursor
+    uint64_t m_cutoff = 0;
+    size_t m_cursor = 0;
+    std::string m_word; // tokenizer scratch for Add()
+};
@@ -0,0 +1,295 @@
+#include "chat_socket.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+
+#if defined(_WIN32)
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+bool NetStartup() {
+#if defined(_WIN32)
+    WSADATA wsa;
+    return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+#else
+    // a peer closing while we write must surface as an error from send() and not kill the process
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+void NetCleanup() {
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+bool ResolveAddress(const char* host, uint16_t port, std::vector<ChatAddress>& addresses, std::string* error) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+
+    addrinfo* result = nullptr;
+    int status = getaddrinfo(host, service, &hints, &result);
+    if (status != 0 || !result) {
+        if (error) {
+            *error = std::string("could not resolve ") + host;
+        }
+        return false;
+    }
+    addresses.clear();
+    for (addrinfo* info = result; info; info = info->ai_next) {
+        if (info->ai_addrlen > sizeof(sockaddr_storage)) {
+            continue;
+        }
+        ChatAddress address;
+        memcpy(&address.storage, info->ai_addr, info->ai_addrlen);
+        address.length = (int)info->ai_addrlen;
+        addresses.push_back(address);
+    }
+    freeaddrinfo(result);
+    if (addresses.empty() && error) {
+        *error = std::string("could not resolve ") + host;
+    }
+    return !addresses.empty();
+}
+
+namespace {
+
+void SetBlocking(ChatSocket s, bool blocking) {
+#if defined(_WIN32)
+    u_long nonBlocking = blocking ? 0 : 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+}
+
+int LastSocketError() {
+#if defined(_WIN32)
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+// waits at most timeoutMs for the pending connect to finish, returns 1 when it did, 0 on timeout and -1 on error
+int WaitWritable(ChatSocket s, int timeoutMs) {
+#if defined(_WIN32)
+    fd_set writeSet, errorSet;
+    FD_ZERO(&writeSet);
+    FD_ZERO(&errorSet);
+    FD_SET(s, &writeSet);
+    FD_SET(s, &errorSet);
+    timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    int ready = select(0, nullptr, &writeSet, &errorSet, &tv);
+    return ready < 0 ? -1 : (ready > 0 ? 1 : 0);
+#else
+    pollfd pfd{};
+    pfd.fd = s;
+    pfd.events = POLLOUT;
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready < 0 && errno == EINTR) {
+        return 0;
+    }
+    return ready < 0 ? -1 : (ready > 0 ? 1 : 0);
+#endif
+}
+
+}
+
+ChatSocket ConnectWithTimeout(const ChatAddress& address, int timeoutMs, const std::atomic<bool>* cancel, std::string* error) {
+    ChatSocket s = socket(address.storage.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (s == CHAT_INVALID_SOCKET) {
+        if (error) {
+            *error = "could not create a socket";
+        }
+        return CHAT_INVALID_SOCKET;
+    }
+
+    SetBlocking(s, false);
+    if (connect(s, (const sockaddr*)&address.storage, address.length) != 0) {
+        int code = LastSocketError();
+#if defined(_WIN32)
+        bool pending = code == WSAEWOULDBLOCK;
+#else
+        bool pending = code == EINPROGRESS;
+#endif
+        if (!pending) {
+            if (error) {
+                *error = "connection refused";
+            }
+            CloseSocket(s);
+            return CHAT_INVALID_SOCKET;
+        }
+
+        // we wait in small slices so a cancelled login does not have to sit out the whole timeout
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (true) {
+            if (cancel && cancel->load()) {
+                if (error) {
+                    *error = "cancelled";
+                }
+                CloseSocket(s);
+                return CHAT_INVALID_SOCKET;
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) {
+                if (error) {
+                    *error = "timed out";
+                }
+                CloseSocket(s);
+                return CHAT_INVALID_SOCKET;
+            }
+            int ready = WaitWritable(s, (int)(left < 50 ? left : 50));
+            if (ready < 0) {
+                if (error) {
+                    *error = "connection failed";
+                }
+                CloseSocket(s);
+                return CHAT_INVALID_SOCKET;
+            }
+            if (ready > 0) {
+                break;
+            }
+        }
+
+        // writable only means the handshake finished, SO_ERROR tells us whether it succeeded
+        int soError = 0;
+        socklen_t length = sizeof(soError);
+        getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&soError, &length);
+        if (soError != 0) {
+            if (error) {
+                *error = "connection refused";
+            }
+            CloseSocket(s);
+            return CHAT_INVALID_SOCKET;
+        }
+    }
+
+    SetBlocking(s, true);
+    return s;
+}
+
+ChatSocket ConnectWithTimeout(const std::vector<ChatAddress>& addresses, int timeoutMs, const std::atomic<bool>* cancel, std::string* error) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (size_t i = 0; i < addresses.size(); i++) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) {
+            if (error) {
+                *error = "timed out";
+            }
+            break;
+        }
+        long long share = left / (long long)(addresses.size() - i);
+        ChatSocket s = ConnectWithTimeout(addresses[i], (int)(share > 0 ? share : 1), cancel, error);
+        if (s != CHAT_INVALID_SOCKET) {
+            return s;
+        }
+        if (cancel && cancel->load()) {
+            break;
+        }
+    }
+    if (addresses.empty() && error) {
+        *error = "no address to connect to";
+    }
+    return CHAT_INVALID_SOCKET;
+}
+
+ChatSocket ConnectTcp(const char* host, uint16_t port, int timeoutMs) {
+    std::vector<ChatAddress> addresses;
+    if (!ResolveAddress(host, port, addresses)) {
+        return CHAT_INVALID_SOCKET;
+    }
+    return ConnectWithTimeout(addresses, timeoutMs);
+}
+
+void ShutdownSocket(ChatSocket socket) {
+#if defined(_WIN32)
+    shutdown(socket, SD_BOTH);
+#else
+    shutdown(socket, SHUT_RDWR);
+#endif
+}
+
+void CloseSocket(ChatSocket socket) {
+#if defined(_WIN32)
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+int RecvSome(ChatSocket socket, char* buffer, size_t capacity) {
+    return (int)recv(socket, buffer, (int)capacity, 0);
+}
+
+bool SendAll(ChatSocket socket, const char* data, size_t length) {
+#if defined(_WIN32)
+    const int flags = 0;
+#else
+    const int flags = MSG_NOSIGNAL;
+#endif
+    while (length > 0) {
+        int sent = (int)send(socket, data, (int)length, flags);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+long long SendSlices(ChatSocket socket, const SendSlice* slices, size_t count) {
+    if (count > kMaxSendSlices) {
+        count = kMaxSendSlices;
+    }
+#if defined(_WIN32)
+    WSABUF buffers[kMaxSendSlices];
+    for (size_t i = 0; i < count; i++) {
+        buffers[i].buf = const_cast<char*>(slices[i].data);
+        buffers[i].len = (ULONG)slices[i].length;
+    }
+    DWORD sent = 0;
+    if (WSASend(socket, buffers, (DWORD)count, &sent, 0, nullptr, nullptr) != 0) {
+        return -1;
+    }
+    return (long long)sent;
+#else
+    iovec buffers[kMaxSendSlices];
+    for (size_t i = 0; i < count; i++) {
+        buffers[i].iov_base = const_cast<char*>(slices[i].data);
+        buffers[i].iov_len = slices[i].length;
+    }
+    // sendmsg is writev with flags, we need MSG_NOSIGNAL so a closed peer does not raise SIGPIPE
+    msghdr msg{};
+    msg.msg_iov = buffers;
+    msg.msg_iovlen = count;
+    ssize_t sent;
+    do {
+        sent = sendmsg(socket, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    return (long long)sent;
+#endif
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// this is a thin shim over Winsock and POSIX sockets so the chat core builds on Windows and Linux
+// it only covers what the client and the tools need: blocking TCP connect, send and receive
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET ChatSocket;
+#define CHAT_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <sys/socket.h>
+typedef int ChatSocket;
+#define CHAT_INVALID_SOCKET (-1)
+#endif
+
+// a resolved server address, big enough for IPv4 and IPv6
+struct ChatAddress {
+    sockaddr_storage storage{};
+    int length = 0;
+};
+
+// we initialise the socket library once per process, WSAStartup on Windows and ignoring SIGPIPE on POSIX
+bool NetStartup();
+void NetCleanup();
+
+// resolves host:port with getaddrinfo(), this may block on DNS so the client calls it from its connect thread
+// addresses gets every result in the order getaddrinfo() gave them, "localhost" is often ::1 first and 127.0.0.1 second
+bool ResolveAddress(const char* host, uint16_t port, std::vector<ChatAddress>& addresses, std::string* error = nullptr);
+
+// starts a non-blocking connect and waits up to timeoutMs for it to complete, checking cancel every 50 ms
+// the returned socket is switched back to blocking mode, CHAT_INVALID_SOCKET means it failed, timed out or was cancelled
+ChatSocket ConnectWithTimeout(const ChatAddress& address, int timeoutMs, const std::atomic<bool>* cancel = nullptr, std::string* error = nullptr);
+
+// the same over every resolved address in turn until one connects, all within timeoutMs
+// each attempt gets an equal share of the time left, so an address that never answers cannot starve the ones after it
+// while a refused one costs next to nothing, error is the reason the last address failed
+ChatSocket ConnectWithTimeout(const std::vector<ChatAddress>& addresses, int timeoutMs, const std::atomic<bool>* cancel = nullptr, std::string* error = nullptr);
+
+// opens a TCP connection to host:port and returns CHAT_INVALID_SOCKET on failure
+ChatSocket ConnectTcp(const char* host, uint16_t port, int timeoutMs = 10000);
+
+// wakes up any thread blocked in RecvSome() on this socket, the socket still has to be closed afterwards
+void ShutdownSocket(ChatSocket socket);
+void CloseSocket(ChatSocket socket);
+
+// receives whatever is available (up to capacity bytes), returns 0 when the peer closed and a negative value on error
+int RecvSome(ChatSocket socket, char* buffer, size_t capacity);
+
+// sends the whole buffer, looping over partial sends, returns false if the connection failed
+bool SendAll(ChatSocket socket, const char* data, size_t length);
+
+// one piece of a scatter-gather write
+struct SendSlice {
+    const char* data;
+    size_t length;
+};
+
+// the most slices SendSlices() takes per call, comfortably below IOV_MAX everywhere
+const size_t kMaxSendSlices = 64;
+
+// writes up to kMaxSendSlices slices with a single writev()/WSASend() call, returns the number of bytes the kernel
+// accepted which may end in the middle of a slice, or a negative value on error
+long long SendSlices(ChatSocket socket, const SendSlice* slices, size_t count);
@@ -0,0 +1,111 @@
+#include "chat_spill.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+SpillFile::~SpillFile() {
+    if (m_file.is_open()) {
+        m_file.close();
+        std::remove(m_path.c_str());
+    }
+}
+
+bool SpillFile::Open(const std::string& directory) {
+    std::error_code error;
+    std::filesystem::path dir = directory.empty() ? std::filesystem::temp_directory_path(error) : std::filesystem::path(directory);
+    if (error) {
+        return false;
+    }
+    // a random name keeps two clients on the same machine (and two histories in one client) apart
+    std::random_device random;
+    for (int attempt = 0; attempt < 4 && !m_file.is_open(); attempt++) {
+        char name[64];
+        snprintf(name, sizeof(name), "chatspill-%08x%08x.tmp", random(), random());
+        std::filesystem::path path = dir / name;
+        if (std::filesystem::exists(path, error)) {
+            continue;
+        }
+        m_path = path.string();
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+    return m_file.is_open();
+}
+
+bool SpillFile::Append(const ChatMessage& message) {
+    if (!m_file.is_open()) {
+        return false;
+    }
+    if (m_reading) {
+        m_file.clear();
+        m_file.seekp((std::streamoff)m_bytes);
+        m_reading = false;
+    }
+    if (m_count % IndexStride == 0) {
+        m_index.push_back(m_bytes);
+    }
+
+    char header[HeaderSize];
+    memcpy(header, &message.textLength, 4);
+    memcpy(header + 4, &message.sender, 4);
+    memcpy(header + 8, &message.timestamp, 8);
+    memcpy(header + 16, &message.bodyOffset, 2);
+    header[18] = (char)message.kind;
+    header[19] = (char)message.flags;
+    m_file.write(header, HeaderSize);
+    m_file.write(message.text, message.textLength);
+    if (!m_file) {
+        // a full disk or a removed temp directory, we stop spilling and the history stops offering older messages
+        m_file.close();
+        std::remove(m_path.c_str());
+        return false;
+    }
+    m_count++;
+    m_bytes += HeaderSize + message.textLength;
+    return true;
+}
+
+bool SpillFile::Read(uint64_t first, uint64_t count, const std::function<bool(const ChatMessage&)>& visit) {
+    if (!m_file.is_open() || first >= m_count) {
+        return false;
+    }
+    // the stream buffers our appends, they have to reach the file before we read it back
+    if (!m_reading) {
+        m_file.flush();
+        m_reading = true;
+    }
+    m_file.clear();
+    m_file.seekg((std::streamoff)m_index[first / IndexStride]);
+
+    uint64_t end = std::min(first + count, m_count);
+    for (uint64_t i = first - first % IndexStride; i < end; i++) {
+        char header[HeaderSize];
+        if (!m_file.read(header, HeaderSize)) {
+            return false;
+        }
+        ChatMessage message;
+        memcpy(&message.textLength, header, 4);
+        if (i < first) {
+            // ignore() reads through the stream buffer, a relative seek would throw the buffer away for every record
+            m_file.ignore(message.textLength);
+            continue;
+        }
+        memcpy(&message.sender, header + 4, 4);
+        memcpy(&message.timestamp, header + 8, 8);
+        memcpy(&message.bodyOffset, header + 16, 2);
+        message.kind = (MessageKind)header[18];
+        message.flags = (uint8_t)header[19];
+        m_buffer.resize(message.textLength);
+        if (!m_file.read(m_buffer.data(), message.textLength)) {
+            return false;
+        }
+        message.text = m_buffer.data();
+        if (!visit(message)) {
+            break;
+        }
+    }
+    return true;
+}
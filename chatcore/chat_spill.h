@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat_history.h"
+
+// SpillFile is the on-disk tail of a ChatHistory, messages that no longer fit the retention limits are appended here
+// in order and read back when the user scrolls up past what is still in memory
+// it is scratch space for this process only (sender ids refer to the client's NameTable), the file is deleted
+// when the SpillFile goes away
+//   every record is a fixed 20 byte header (length, sender, timestamp, body offset, kind, flags) followed by the text
+//   we remember the file offset of every 256th record, so finding message n costs a seek and at most 255 skipped
+//   headers while the index stays at 8 bytes per 256 spilled messages
+class SpillFile {
+public:
+    SpillFile() = default;
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // creates a uniquely named file in directory, the system temp directory if it is empty
+    bool Open(const std::string& directory);
+    bool IsOpen() const { return m_file.is_open(); }
+
+    // appends message as record number Count()
+    bool Append(const ChatMessage& message);
+    uint64_t Count() const { return m_count; }
+    uint64_t Bytes() const { return m_bytes; }
+
+    // reads records [first, first + count) in order, message.text points into a buffer that is only valid during the call
+    // visit returns false to stop early
+    bool Read(uint64_t first, uint64_t count, const std::function<bool(const ChatMessage&)>& visit);
+
+private:
+    static constexpr uint64_t IndexStride = 256;
+    static constexpr size_t HeaderSize = 20;
+
+    std::fstream m_file;
+    std::string m_path;
+    uint64_t m_count = 0;
+    uint64_t m_bytes = 0;
+    std::vector<uint64_t> m_index; // file offset of record i * IndexStride
+    bool m_reading = false;        // the stream was last positioned for reading, the next append has to seek back
+    std::string m_buffer;
+};
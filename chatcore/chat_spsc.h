@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// SpscQueue is a bounded lock-free ring for exactly one producer thread and one consumer thread
+// the client uses it to hand parsed messages from the receive thread to the UI thread without a mutex
+// head and tail only ever grow, a slot is tail & mask, and each side keeps a cached copy of the other side's index
+// so it only touches the shared cache line when the ring looks full (producer) or empty (consumer)
+template <typename T>
+class SpscQueue {
+public:
+    // the capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer only, returns false and leaves value alone when the ring is full
+    bool TryPush(T&& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_slots.size()) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_slots.size()) {
+                return false;
+            }
+        }
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, returns false when the ring is empty
+    bool TryPop(T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // a snapshot that may be stale by the time the caller looks at it, fine for statistics
+    size_t SizeApprox() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const { return m_slots.size(); }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask = 0;
+
+    // the two sides live on their own cache lines so pushing does not keep invalidating the consumer's line
+    alignas(64) std::atomic<size_t> m_head{ 0 }; // next slot to pop, written by the consumer
+    size_t m_cachedTail = 0;                      // the consumer's last look at m_tail
+    alignas(64) std::atomic<size_t> m_tail{ 0 }; // next slot to push, written by the producer
+    size_t m_cachedHead = 0;                      // the producer's last look at m_head
+};
@@ -0,0 +1,48 @@
+#include "chat_users.h"
+
+uint64_t UserNameHash(std::string_view name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool UserDirectory::Add(std::string_view name) {
+    auto result = m_slots.emplace(std::string(name), m_names.size());
+    if (!result.second) {
+        return false;
+    }
+    m_names.emplace_back(name);
+    m_checksum += UserNameHash(name);
+    return true;
+}
+
+bool UserDirectory::Remove(std::string_view name) {
+    auto it = m_slots.find(std::string(name));
+    if (it == m_slots.end()) {
+        return false;
+    }
+    size_t slot = it->second;
+    m_slots.erase(it);
+    m_checksum -= UserNameHash(name);
+
+    // we move the last name into the hole so removal never shifts the vector
+    if (slot + 1 != m_names.size()) {
+        m_names[slot] = std::move(m_names.back());
+        m_slots[m_names[slot]] = slot;
+    }
+    m_names.pop_back();
+    return true;
+}
+
+void UserDirectory::Clear() {
+    m_names.clear();
+    m_slots.clear();
+    m_checksum = 0;
+}
+
+bool UserDirectory::Contains(std::string_view name) const {
+    return m_slots.count(std::string(name)) != 0;
+}
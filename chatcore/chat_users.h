@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 64 bit FNV-1a of a username, the server and the client sum these up to compare their user lists cheaply
+uint64_t UserNameHash(std::string_view name);
+
+// UserDirectory is the client side set of online users
+// the names live in a dense vector so the UI can walk them like before, and a name -> slot map makes
+// applying a USERS+| or USERS-| delta O(1): removal moves the last name into the hole
+// the checksum is the sum of UserNameHash() over all names, so it does not depend on the order and
+// is updated in O(1) as well, the server sends its own sum from time to time and we resync on a mismatch
+class UserDirectory {
+public:
+    // returns false if the name was already there
+    bool Add(std::string_view name);
+    // returns false if the name was not there
+    bool Remove(std::string_view name);
+    void Clear();
+
+    bool Contains(std::string_view name) const;
+    size_t size() const { return m_names.size(); }
+    bool empty() const { return m_names.empty(); }
+    uint64_t Checksum() const { return m_checksum; }
+
+    std::vector<std::string>::const_iterator begin() const { return m_names.begin(); }
+    std::vector<std::string>::const_iterator end() const { return m_names.end(); }
+
+private:
+    std::vector<std::string> m_names;
+    std::unordered_map<std::string, size_t> m_slots; // name -> index in m_names
+    uint64_t m_checksum = 0;
+};
@@ -0,0 +1,242 @@
+#include "chat_ui.h"
+
+#include <cstring>
+
+#include "imgui.h"
+
+#include "chat_protocol.h"
+
+void ChatUi::ShowChat(const std::string& user) {
+    m_myUsername = user;
+    m_loggedIn = true;
+}
+
+void ChatUi::Draw() {
+    // the client reconnects on its own after a dropped connection, it only fails for good when the server refuses
+    // our username again (someone took it while we were away), then we go back to the login window which shows why
+    if (m_loggedIn && m_client.GetConnectionState() == ConnectionState::Failed) {
+        m_loggedIn = false;
+    }
+
+    if (!m_loggedIn) {
+        DrawLogin();
+    }
+    else {
+        DrawMainChat();
+        DrawDirectMessages();
+    }
+}
+
+void ChatUi::DrawLogin() {
+    // we get the ImGui IO object to access display size as I want make the login window and main chat window specifically positioned on the window
+    ImGuiIO& io = ImGui::GetIO();
+
+    // we set the next window position to be centered on the screen and set a fixed size for the login window
+    ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(300, 140));
+    // we create the login window with no title bar, no resizing, no moving, and no collapsing to keep it simple and focused on the login process
+    ImGui::Begin("Login", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar);
+
+    // the connection is made on a background thread so we only look at its state here and keep rendering every frame
+    ConnectionState connState = m_client.GetConnectionState();
+    bool connecting = connState == ConnectionState::Resolving || connState == ConnectionState::Connecting || connState == ConnectionState::Handshaking;
+
+    ImGui::Text("Enter Username:"); // we want the user to enter a username for the chat session
+    ImGui::BeginDisabled(connecting);
+    ImGui::InputText("##username", m_usernameBuffer, IM_ARRAYSIZE(m_usernameBuffer)); // we use a hidden label for the input text to keep the UI clean and simple
+
+    if (ImGui::Button("Connect", ImVec2(-1, 0))) { // when the user clicks the Connect button, we attempt to connect to the chat server using the provided username
+        if (strlen(m_usernameBuffer) > 0) { // we check if the username is not empty before attempting to connect to avoid sending invalid data to the server
+            // once the connection is up the client sends the username to the server to join the chat
+            // and starts the receive loop in a separate thread to listen for incoming messages
+            m_client.BeginConnect(host, port, std::string(m_usernameBuffer), connectTimeoutMs);
+        }
+    }
+    ImGui::EndDisabled();
+
+    if (connecting) { // we show which step we are in with a small animated ellipsis so the user knows the window is not frozen
+        const char* dots[] = { "", ".", "..", "..." };
+        ImGui::TextDisabled("%s%s", ConnectionStateName(connState), dots[(int)(ImGui::GetTime() * 3.0) % 4]);
+        if (frames) {
+            frames->RequestFrameAt(FrameScheduler::Clock::now() + std::chrono::milliseconds(100)); // the ellipsis animates
+        }
+    }
+    else if (connState == ConnectionState::Failed) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Could not connect: %s", m_client.LastError().c_str());
+    }
+    else if (connState == ConnectionState::Connected) {
+        ShowChat(m_client.Username());
+    }
+    ImGui::End(); // we end the login window and move on to rendering the main chat interface if the user is logged in
+}
+
+void ChatUi::DrawMainChat() {
+    // the main chat interface consists of a user list on the left and the global chat on the right with an input field at the bottom
+    ImGuiIO& io = ImGui::GetIO();
+    ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x * 0.35f, io.DisplaySize.y * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_Always); //we set the window size to be 800x600 and position it
+
+    // we create the main chat window with no resizing, no moving, and no collapsing to keep it simple
+    ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoBringToFrontOnFocus;
+    ImGui::Begin("Chat Client - Main Chat Room", nullptr, window_flags);
+
+    // we use ImGui columns to create a two-column layout for the user list and global chat, setting a fixed width for the user list column
+    ImGui::Columns(2, "ChatColumns", true);
+    ImGui::SetColumnWidth(0, 200);
+
+    // we render the user list in the left column, allowing the user to select a username to open a direct message window with that user
+    ImGui::Text("Users");
+    ImGui::Separator(); {
+        for (const auto& user : m_client.state.userList) {
+            if (trim(user) == m_myUsername) { // we skip rendering our own username in the user list to avoid confusion and prevent opening a DM with ourselves
+                continue;
+            }
+            if (ImGui::Selectable(user.c_str())) {
+                m_client.state.openDMs.insert(user);
+            }
+        }
+    }
+
+    // we move to the next column to render the global chat interface
+    ImGui::NextColumn();
+
+    // we render the global chat messages in a scrollable child window, applying different text colors for messages sent by ourselves to provide visual feedback and distinguish them from messages sent by other users
+    ImGui::Text("Global Chat");
+    if (m_client.GetConnectionState() == ConnectionState::Reconnecting) { // we tell the user that messages will arrive once the link is back
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "(connection lost, reconnecting...)");
+    }
+    // the search box sits at the right end of the header, it searches the global chat and every DM conversation
+    ImGui::SameLine(ImGui::GetContentRegionMax().x - 220);
+    ImGui::SetNextItemWidth(220);
+    ImGui::InputTextWithHint("##Search", "Search messages", m_searchBuffer, IM_ARRAYSIZE(m_searchBuffer));
+    ImGui::Separator();
+
+    DrawSearch();
+
+    ImGui::BeginChild("ScrollingRegion", ImVec2(0, -40), false, ImGuiWindowFlags_HorizontalScrollbar);
+    {
+        // only the lines inside the scrolling region are laid out, so a long history does not slow the frame down
+        // the client marks the messages sent by us when they arrive and we apply a different text color for them
+        // to provide visual feedback in the chat interface
+        // it also scrolls to the latest message when new messages arrive while the user is at the bottom of the chat
+        DrawChatLines(m_globalLayout, m_client.state.globalChat, MessageFromMe, m_globalScrollTo);
+        m_globalScrollTo = NoScrollTarget;
+    }
+    ImGui::EndChild();
+
+    // we render the input field for sending messages to the global chat, allowing the user to type a message and send it by clicking the Send button or pressing Enter
+    ImGui::Separator();
+    ImGui::PushItemWidth(-60);
+    ImGui::InputText("##GlobalInput", m_globalInputBuffer, IM_ARRAYSIZE(m_globalInputBuffer));
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+
+    if (ImGui::Button("Send", ImVec2(50, 0))) { // when the user clicks the Send button, we check if the input buffer is not empty and then send the message to the server
+        if (strlen(m_globalInputBuffer) > 0) {
+            m_client.SendGlobal(std::string(m_globalInputBuffer)); // the client adds the newline delimiter and records the message in our history
+            if (onSend) {
+                onSend();
+            }
+            m_globalInputBuffer[0] = '\0';
+        }
+    }
+    ImGui::End();
+}
+
+void ChatUi::DrawSearch() {
+    if (m_searchBuffer[0] == '\0') {
+        if (!m_searchHits.empty()) {
+            m_searchQuery.clear();
+            m_searchHits.clear();
+        }
+        return;
+    }
+
+    // the index answers in a few milliseconds even over a million messages, but there is no point asking it
+    // every frame, so we only search again when the query changed or new messages came in
+    uint64_t messageCount = m_client.state.globalChat.TotalCount();
+    for (const auto& dm : m_client.state.dmHistory) {
+        messageCount += dm.second.TotalCount();
+    }
+    if (m_searchQuery != m_searchBuffer || m_searchMessageCount != messageCount) {
+        m_searchQuery = m_searchBuffer;
+        m_searchMessageCount = messageCount;
+        m_searchMatches = m_client.Search(m_searchQuery, 100, m_searchHits);
+    }
+    ImGui::TextDisabled("%zu matches%s", m_searchMatches, m_searchMatches > m_searchHits.size() ? ", the newest 100 are shown" : "");
+    ImGui::BeginChild("SearchResults", ImVec2(0, 150), true);
+    for (size_t i = 0; i < m_searchHits.size(); i++) {
+        const SearchHit& hit = m_searchHits[i];
+        ImGui::PushID((int)i);
+        if (ImGui::Selectable(hit.conversation.empty() ? "[global]" : hit.conversation.c_str(), false, 0, ImVec2(90, 0))) {
+            // a DM hit opens its window, the jump happens once the window draws its lines
+            if (hit.conversation.empty()) {
+                m_globalScrollTo = hit.index;
+            }
+            else {
+                m_client.state.openDMs.insert(hit.conversation);
+                m_dmScrollTo[hit.conversation] = hit.index;
+            }
+        }
+        ImGui::SameLine();
+        ImGui::TextUnformatted(hit.line.data(), hit.line.data() + hit.line.size());
+        ImGui::PopID();
+    }
+    ImGui::EndChild();
+}
+
+void ChatUi::DrawDirectMessages() {
+    m_dmsToClose.clear();
+    // we render open direct message windows for each user in the openDMs set, allowing the user to have multiple private conversations simultaneously and manage them through the UI
+    for (const auto& targetUser : m_client.state.openDMs) {
+        // we create a separate window for each open DM with a title indicating the target user
+        bool open = true;
+        // we make the window title dynamic based on the target user to provide context for the conversation and set a default size for the DM windows
+        std::string windowTitle = "Private Chat with " + targetUser;
+        // we create a smaller window for DMs and it's movable and resizable
+        ImGui::SetNextWindowSize(ImVec2(400, 300), ImGuiCond_FirstUseEver);
+
+        if (ImGui::Begin(windowTitle.c_str(), &open)) {
+            ImGui::BeginChild("DMMessages", ImVec2(0, -40));
+            {
+                // our own messages are recorded with a "Me:" prefix and flagged, we apply a different text color for them in the DM window to provide visual feedback and distinguish them from messages sent by the other user
+                auto jump = m_dmScrollTo.find(targetUser);
+                DrawChatLines(m_dmLayouts[targetUser], m_client.DirectHistory(targetUser), MessageFromMe, jump != m_dmScrollTo.end() ? jump->second : NoScrollTarget);
+                if (jump != m_dmScrollTo.end()) {
+                    m_dmScrollTo.erase(jump);
+                }
+            }
+            ImGui::EndChild();
+
+            // we render the input field for sending messages in the DM window, allowing the user to type a private message and send it to the target user by clicking the Send button or pressing Enter
+            ImGui::PushID(targetUser.c_str());
+            ImGui::PushItemWidth(-60);
+            ImGui::InputText("##DMInput", m_dmInputBuffer, IM_ARRAYSIZE(m_dmInputBuffer));
+            ImGui::PopItemWidth();
+            ImGui::SameLine();
+
+            if (ImGui::Button("Send")) {
+                if (strlen(m_dmInputBuffer) > 0) {
+                    // the client sends "DM|targetUser|message\n" and records the message in the DM history with a "Me:" prefix
+                    m_client.SendDirect(targetUser, std::string(m_dmInputBuffer));
+                    m_dmInputBuffer[0] = '\0';
+                    // for DMs we play the same send sound
+                    if (onSend) {
+                        onSend();
+                    }
+                }
+            }
+            ImGui::PopID();
+        }
+        ImGui::End();
+        // if the user closes the DM window by clicking the close button, we mark it for removal from the openDMs set to stop rendering it
+        if (!open) {
+            m_dmsToClose.push_back(targetUser);
+        }
+    }
+
+    for (const auto& user : m_dmsToClose) {
+        m_client.state.openDMs.erase(user);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "chat_client.h"
+#include "chat_frame.h"
+#include "chat_view.h"
+
+// ChatUi draws the whole chat client with ImGui: the login window, the main chat room with the user list, the global
+// chat and the search box, and one window for every open DM
+// it knows nothing about the platform or the renderer, the front-end sets ImGui up, pumps the client's events and
+// calls Draw() between ImGui::NewFrame() and ImGui::Render(), so the Windows client and the headless runner in
+// example_null draw exactly the same windows
+// only the thread that draws may touch it, like the client's chat state
+class ChatUi {
+public:
+    explicit ChatUi(ChatClient& client) : m_client(client) {}
+
+    void Draw();
+
+    // skips the login window and shows the chat as user, for a front-end that filled the chat state itself
+    void ShowChat(const std::string& user);
+    bool LoggedIn() const { return m_loggedIn; }
+
+    // where the login window connects to
+    std::string host = "127.0.0.1";
+    uint16_t port = 65432;
+    int connectTimeoutMs = 5000; // how long the login window waits for the server before reporting a failure
+
+    // optional, the animations ask it for their next frame (the ellipsis while we connect)
+    FrameScheduler* frames = nullptr;
+    // called after we sent a global message or a DM, the Windows client plays its send sound
+    std::function<void()> onSend;
+
+private:
+    void DrawLogin();
+    void DrawMainChat();
+    void DrawSearch();
+    void DrawDirectMessages();
+
+    ChatClient& m_client;
+
+    bool m_loggedIn = false;
+    std::string m_myUsername;
+    char m_usernameBuffer[64] = "";
+    char m_globalInputBuffer[256] = "";
+    char m_dmInputBuffer[256] = "";
+
+    // the wrapped layout of the global chat and of every DM window
+    ChatListLayout m_globalLayout;
+    std::map<std::string, ChatListLayout> m_dmLayouts;
+
+    // the search box above the global chat, we look the query up again only when it changes or a message arrives
+    // clicking a hit sets the message the global chat or the DM window of the hit jumps to in the next frame
+    char m_searchBuffer[128] = "";
+    std::string m_searchQuery;
+    uint64_t m_searchMessageCount = 0;
+    size_t m_searchMatches = 0;
+    std::vector<SearchHit> m_searchHits;
+    uint64_t m_globalScrollTo = NoScrollTarget;
+    std::map<std::string, uint64_t> m_dmScrollTo;
+
+    std::vector<std::string> m_dmsToClose;
+};
@@ -0,0 +1,97 @@
+#include "chat_view.h"
+
+#include "imgui.h"
+
+void DrawChatLines(ChatListLayout& layout, ChatHistory& history, uint8_t highlightFlags, uint64_t scrollTo) {
+    // TextWrapped wraps at the right edge of the content region, so this is the width every line is measured with
+    float wrapWidth = ImGui::GetContentRegionAvail().x;
+    float spacing = ImGui::GetStyle().ItemSpacing.y;
+    auto sync = [&]() {
+        return layout.Sync(history.FirstIndex(), history.size(), wrapWidth, ImGui::GetFont(), ImGui::GetFontSize(), [&history, spacing](size_t index, float width) {
+            std::string_view line = history[index].Text();
+            return ImGui::CalcTextSize(line.data(), line.data() + line.size(), false, width).y + spacing;
+        });
+    };
+
+    float top = ImGui::GetCursorPosY();
+    float scrollY = ImGui::GetScrollY();
+    float scrollMaxY = ImGui::GetScrollMaxY();
+    bool atBottom = scrollY >= scrollMaxY;
+
+    // a bounded history has only a window of the conversation in memory, when the user scrolls into its top or bottom
+    // edge we move the window and scroll so the line they were looking at stays where it was
+    // we only page when the window overflows the view, otherwise both edges are reached without any scrolling
+    float restoreScrollY = -1.0f;
+    if (scrollTo != NoScrollTarget) {
+        if (history.Seek(scrollTo)) {
+            sync();
+            double middle = layout.Offset((size_t)(scrollTo - history.FirstIndex())) - ImGui::GetWindowHeight() * 0.5;
+            restoreScrollY = std::max(0.0f, top + (float)middle);
+            atBottom = false;
+        }
+    }
+    else if (scrollMaxY > 0.0f && scrollY <= 0.0f && history.HasOlder()) {
+        uint64_t anchor = history.FirstIndex();
+        if (history.PageOlder()) {
+            sync();
+            size_t line = (size_t)std::min<uint64_t>(anchor - history.FirstIndex(), layout.Count());
+            restoreScrollY = top + (float)layout.Offset(line);
+        }
+    }
+    else if (scrollMaxY > 0.0f && atBottom && !history.AtTail()) {
+        uint64_t anchor = history.FirstIndex() + history.size();
+        if (history.PageNewer()) {
+            sync();
+            size_t line = (size_t)std::min<uint64_t>(anchor - history.FirstIndex(), layout.Count());
+            restoreScrollY = std::max(0.0f, top + (float)layout.Offset(line) - ImGui::GetWindowHeight());
+            atBottom = false;
+        }
+    }
+
+    double removed = sync();
+    size_t count = layout.Count();
+    if (count == 0) {
+        return;
+    }
+
+    // we find the lines between the top and the bottom of the visible area with two binary searches
+    double visibleFrom = (double)scrollY - top;
+    double visibleTo = visibleFrom + ImGui::GetWindowHeight();
+    size_t first = layout.LineAt(visibleFrom);
+    size_t last = std::min(layout.LineAt(visibleTo) + 1, count);
+
+    ImGui::SetCursorPosY(top + (float)layout.Offset(first));
+    ImGui::PushTextWrapPos(0.0f);
+    for (size_t i = first; i < last; i++) {
+        // the text is drawn straight out of the history's arena, nothing is built per line
+        const ChatMessage& message = history[i];
+        std::string_view line = message.Text();
+        if (message.flags & highlightFlags) {
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 1.0f, 0.4f, 1.0f));
+            ImGui::TextUnformatted(line.data(), line.data() + line.size());
+            ImGui::PopStyleColor();
+        }
+        else {
+            ImGui::TextUnformatted(line.data(), line.data() + line.size());
+        }
+    }
+    ImGui::PopTextWrapPos();
+
+    // the lines below the visible area are not drawn, one dummy item stands in for them so the scrollbar stays right
+    if (last < count) {
+        ImGui::SetCursorPosY(top + (float)layout.Offset(last));
+        ImGui::Dummy(ImVec2(1.0f, (float)(layout.TotalHeight() - layout.Offset(last)) - spacing));
+    }
+
+    if (restoreScrollY >= 0.0f) {
+        ImGui::SetScrollY(restoreScrollY);
+    }
+    else if (atBottom && history.AtTail()) {
+        // the user is at the bottom of the chat, we automatically scroll to the latest message when new messages arrive
+        ImGui::SetScrollHereY(1.0f);
+    }
+    else if (removed > 0.0) {
+        // lines evicted above a reader who scrolled up would otherwise pull the text they are reading upwards
+        ImGui::SetScrollY(std::max(0.0f, scrollY - (float)removed));
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chat_history.h"
+
+// ChatListLayout remembers where every line of a chat history sits once it is word wrapped
+// so the chat window only lays out the lines that are actually on screen instead of the whole history
+//   offsets[i] is the y position of line i relative to the top of the list and offsets[count] the total height
+//   the first visible line is a binary search over offsets, so the cost per frame does not grow with the history
+// a line is measured once when it arrives, everything is measured again only when the wrap width or the font changes
+// or when the history jumps to a different window of the conversation
+// lines evicted from the front of a bounded history only move a start index, the dropped offsets are compacted
+// away once they outnumber the live ones
+// it knows nothing about ImGui, the caller passes the function that measures one line
+class ChatListLayout {
+public:
+    // follows a history whose lines firstLine .. firstLine + lineCount are in memory, measure(index, wrapWidth)
+    // returns the full height of line index of that window including the spacing to the next one
+    // returns the height of the lines that dropped off the front since the last call
+    template <typename Measure>
+    double Sync(uint64_t firstLine, size_t lineCount, float wrapWidth, const void* font, float fontSize, Measure&& measure) {
+        double removed = 0.0;
+        uint64_t lastLine = m_firstLine + Count();
+        if (wrapWidth != m_wrapWidth || font != m_font || fontSize != m_fontSize ||
+            firstLine < m_firstLine || firstLine > lastLine || firstLine + lineCount < lastLine) {
+            // a window that moved backwards or shrank at the end no longer lines up with the cached offsets
+            Reset();
+            m_wrapWidth = wrapWidth;
+            m_font = font;
+            m_fontSize = fontSize;
+            m_firstLine = firstLine;
+        }
+        else if (firstLine > m_firstLine) {
+            size_t dropped = (size_t)(firstLine - m_firstLine);
+            removed = m_offsets[m_start + dropped] - m_offsets[m_start];
+            m_start += dropped;
+            m_firstLine = firstLine;
+            if (m_start > m_offsets.size() / 2) {
+                double base = m_offsets[m_start];
+                m_offsets.erase(m_offsets.begin(), m_offsets.begin() + m_start);
+                for (double& offset : m_offsets) {
+                    offset -= base;
+                }
+                m_start = 0;
+            }
+        }
+        for (size_t i = Count(); i < lineCount; i++) {
+            m_offsets.push_back(m_offsets.back() + (double)measure(i, wrapWidth));
+        }
+        return removed;
+    }
+
+    size_t Count() const { return m_offsets.size() - 1 - m_start; }
+    double Offset(size_t line) const { return m_offsets[m_start + line] - m_offsets[m_start]; }
+    double TotalHeight() const { return m_offsets.back() - m_offsets[m_start]; }
+
+    // the line that covers y, Count() when y is below the last line
+    size_t LineAt(double y) const {
+        auto begin = m_offsets.begin() + m_start;
+        size_t after = (size_t)(std::upper_bound(begin, m_offsets.end(), y + m_offsets[m_start]) - begin);
+        return after == 0 ? 0 : std::min(after - 1, Count());
+    }
+
+    void Reset() {
+        m_offsets.assign(1, 0.0);
+        m_start = 0;
+        m_firstLine = 0;
+        m_wrapWidth = -1.0f;
+        m_font = nullptr;
+        m_fontSize = 0.0f;
+    }
+
+private:
+    // double because a million lines of ~17 px run past the 2^24 where float stops counting whole pixels
+    std::vector<double> m_offsets = std::vector<double>(1, 0.0);
+    size_t m_start = 0;       // m_offsets[m_start] belongs to line m_firstLine, the ones before it were evicted
+    uint64_t m_firstLine = 0; // the history index of the first line we keep
+    float m_wrapWidth = -1.0f;
+    const void* m_font = nullptr;
+    float m_fontSize = 0.0f;
+};
+
+// no message to jump to, see DrawChatLines()
+constexpr uint64_t NoScrollTarget = UINT64_MAX;
+
+// draws a wrapped chat history into the current child window, only the visible lines are submitted to ImGui
+// and a dummy item keeps the scroll range of the whole history, lines with any of highlightFlags set are drawn in green
+// it also keeps the view scrolled to the newest line while the user is at the bottom, and for a bounded history
+// it pages older or newer messages in when the user scrolls past the top or the bottom of what is in memory
+// scrollTo is a message number (a search hit), the history is moved to it and the view centred on it
+void DrawChatLines(ChatListLayout& layout, ChatHistory& history, uint8_t highlightFlags, uint64_t scrollTo = NoScrollTarget);
@@ -0,0 +1,184 @@
+// this is the Linux front-end of the chat client, GLFW opens the window and OpenGL 3 draws it
+// it runs the same ChatUi and ChatClient as the Windows client, so the two only differ in the window, the renderer
+// and the sounds (there are none here yet), it runs on Mesa's software renderer when there is no GPU driver
+// and can be profiled with the usual Linux tools (perf, heaptrack, valgrind)
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_opengl3.h"
+
+#include <GLFW/glfw3.h> // it includes the system's OpenGL headers for glClear() and friends
+
+#include "chat_client.h"
+#include "chat_frame.h"
+#include "chat_socket.h"
+#include "chat_ui.h"
+
+// Global variables for the chat connection and application state
+// the client owns the socket, the receive thread and the shared chat state (see chatcore/chat_client.h)
+ChatClient g_client;
+
+// the login window, the main chat room and the DM windows, shared with the other front-ends (see chatui/chat_ui.h)
+ChatUi g_ui(g_client);
+
+// the frame loop only draws when something changed
+// GLFW can only wait for its own events, so the client's threads wake it with an empty event, the flag makes a burst
+// of network lines post a single one
+FrameScheduler g_frames;
+CpuMeter g_cpu;
+std::atomic<bool> g_wakePending{ false };
+
+static void glfw_error_callback(int error, const char* description) {
+    fprintf(stderr, "GLFW Error %d: %s\n", error, description);
+}
+
+// installed before ImGui's, the backend calls them after handling the event itself
+// anything that can change the picture asks for a few frames, see FrameScheduler
+static void RequestFramesForInput() {
+    g_frames.RequestFrames();
+}
+static void OnCursorPos(GLFWwindow*, double, double) { RequestFramesForInput(); }
+static void OnMouseButton(GLFWwindow*, int, int, int) { RequestFramesForInput(); }
+static void OnScroll(GLFWwindow*, double, double) { RequestFramesForInput(); }
+static void OnKey(GLFWwindow*, int, int, int, int) { RequestFramesForInput(); }
+static void OnChar(GLFWwindow*, unsigned int) { RequestFramesForInput(); }
+static void OnCursorEnter(GLFWwindow*, int) { RequestFramesForInput(); }
+static void OnWindowFocus(GLFWwindow*, int) { RequestFramesForInput(); }
+static void OnFramebufferSize(GLFWwindow*, int, int) { RequestFramesForInput(); }
+static void OnWindowRefresh(GLFWwindow*) { RequestFramesForInput(); }
+
+int main(int, char**) {
+    glfwSetErrorCallback(glfw_error_callback);
+    if (!glfwInit()) {
+        return 1;
+    }
+
+    // GL 3.0 + GLSL 130, which Mesa's llvmpipe provides as well
+    const char* glsl_version = "#version 130";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // the same fixed 1280x800 window as the Windows client
+
+    GLFWwindow* window = glfwCreateWindow(1280, 800, "Chat Client", nullptr, nullptr);
+    if (window == nullptr) {
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(1); // vsync while we draw, the loop below decides whether we draw at all
+
+    glfwSetCursorPosCallback(window, OnCursorPos);
+    glfwSetMouseButtonCallback(window, OnMouseButton);
+    glfwSetScrollCallback(window, OnScroll);
+    glfwSetKeyCallback(window, OnKey);
+    glfwSetCharCallback(window, OnChar);
+    glfwSetCursorEnterCallback(window, OnCursorEnter);
+    glfwSetWindowFocusCallback(window, OnWindowFocus);
+    glfwSetFramebufferSizeCallback(window, OnFramebufferSize);
+    glfwSetWindowRefreshCallback(window, OnWindowRefresh);
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    // a blinking text cursor would need a frame twice a second whenever a text field has focus, which is most of the time
+    ImGui::GetIO().ConfigInputTextCursorBlink = false;
+    ImGui::StyleColorsDark();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init(glsl_version);
+
+    NetStartup();
+
+    g_client.onUpdate = [] {
+        if (!g_wakePending.exchange(true)) {
+            glfwPostEmptyEvent();
+        }
+    };
+    g_ui.frames = &g_frames;
+    // the client may run for weeks on an always-on machine, so only the newest part of every conversation is kept in memory
+    // and older messages are spilled to a temp file and paged back in when the user scrolls up
+    g_client.globalRetention.maxMessages = 20000;
+    g_client.globalRetention.maxBytes = 8 * 1024 * 1024;
+    g_client.dmRetention.maxMessages = 5000;
+    g_client.dmRetention.maxBytes = 2 * 1024 * 1024;
+    // search reaches the newest 500000 global and 50000 messages per DM, which holds its index to about 12 MiB
+    g_client.globalRetention.searchMessages = 500000;
+    g_client.dmRetention.searchMessages = 50000;
+    // the log on disk is held to 256 MiB, the oldest 16 MiB segment goes when a new one would not fit
+    g_client.logRetention.maxBytes = 256ull * 1024 * 1024;
+    // the log in the working directory keeps the conversations across restarts, a client that cannot open it simply runs without one
+    g_client.OpenLog("chatlog", g_client.globalRetention.maxMessages);
+
+    // the main loop sleeps in glfwWaitEventsTimeout() until there is something to draw: input, a wake-up from the
+    // client's threads or an animation frame, once a second it wakes up to put its CPU use and frame rate in the title bar
+    auto nextReport = FrameScheduler::Clock::now() + std::chrono::seconds(1);
+    uint64_t reportedFrames = 0;
+    while (!glfwWindowShouldClose(window)) {
+        auto now = FrameScheduler::Clock::now();
+        int timeout = g_frames.TimeoutMs(now);
+        int untilReport = nextReport > now ? (int)std::chrono::ceil<std::chrono::milliseconds>(nextReport - now).count() : 0;
+        if (timeout < 0 || timeout > untilReport) {
+            timeout = untilReport;
+        }
+        if (timeout > 0) {
+            glfwWaitEventsTimeout(timeout / 1000.0);
+        }
+        else {
+            glfwPollEvents();
+        }
+        // new chat events or a connection state change, PumpEvents() below picks them up
+        if (g_wakePending.exchange(false)) {
+            g_frames.RequestFrames(FrameScheduler::DataFrames);
+        }
+
+        now = FrameScheduler::Clock::now();
+        if (now >= nextReport) {
+            char title[128];
+            snprintf(title, sizeof(title), "Chat Client - %.1f%% CPU, %llu frames/s", g_cpu.Sample() * 100.0, (unsigned long long)(g_frames.FramesDrawn() - reportedFrames));
+            glfwSetWindowTitle(window, title);
+            reportedFrames = g_frames.FramesDrawn();
+            nextReport = now + std::chrono::seconds(1);
+        }
+        if (!g_frames.BeginFrame(now)) {
+            continue;
+        }
+        // a minimized window is not drawn, restoring it sends us events that bring the frames back
+        if (glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0) {
+            continue;
+        }
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        // we take everything the receive thread queued since the last frame, after this the chat state
+        // belongs to us for the whole frame and nothing below has to lock anything
+        g_client.PumpEvents();
+
+        // the login window until we are connected, then the main chat room and the DM windows
+        g_ui.Draw();
+
+        ImGui::Render();
+        int display_w, display_h;
+        glfwGetFramebufferSize(window, &display_w, &display_h);
+        glViewport(0, 0, display_w, display_h);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        glfwSwapBuffers(window);
+    }
+
+    // the client's threads may post an empty event until they are stopped, so they go before GLFW does
+    g_client.Disconnect();
+    NetCleanup();
+
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
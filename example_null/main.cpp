@@ -0,0 +1,495 @@
+// this is a headless front-end for the chat client, the same ChatUi as the Windows client (login window, main chat room,
+// user list, search box and DM windows) runs on a null platform and a null renderer: no window, no GPU
+//   the platform feeds ImGui a fixed display size, a fixed 1/60 s timestep and scripted mouse and keyboard events
+//   the renderer only walks the draw data and counts what a real one would upload
+// every scenario runs on a fresh ImGui context over a generated history of the given size and records per frame
+// the CPU time of the thread (NewFrame() to the end of the null render), vertices, indices, draw commands and
+// allocations (operator new and ImGui's own allocator), the results are printed as JSON on stdout so a CI job can
+// keep them and compare runs
+// --port connects the login scenario to a running chat_server instead of letting it fail on a closed port
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "imgui.h"
+
+#include "chat_client.h"
+#include "chat_socket.h"
+#include "chat_ui.h"
+
+namespace {
+
+// every allocation of the process, ImGui's go through its allocator functions and are counted apart
+std::atomic<uint64_t> g_newCalls{ 0 };
+std::atomic<uint64_t> g_newBytes{ 0 };
+std::atomic<uint64_t> g_imguiCalls{ 0 };
+std::atomic<uint64_t> g_imguiBytes{ 0 };
+
+void* CountedImGuiAlloc(size_t size, void*) {
+    g_imguiCalls.fetch_add(1, std::memory_order_relaxed);
+    g_imguiBytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size);
+}
+
+void CountedImGuiFree(void* ptr, void*) {
+    free(ptr);
+}
+
+}
+
+// out of line, once inlined into the library code GCC takes the free() below for a mismatch with the new that
+// allocated the block
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    g_newBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace {
+
+struct Options {
+    std::vector<size_t> messages = { 0, 1000, 20000, 100000 };
+    int frames = 300;           // measured frames per scenario
+    std::string scenario;       // empty runs all of them
+    const char* host = "127.0.0.1";
+    int port = 0;               // 0 lets the login scenario fail on a closed port
+    float width = 1280.0f;      // the size of the Windows client's window
+    float height = 800.0f;
+};
+
+// what one frame cost
+struct FrameSample {
+    double cpuUs = 0.0;
+    int vertices = 0;
+    int indices = 0;
+    int drawCommands = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+};
+
+double ThreadCpuUs() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec * 1e6 + (double)now.tv_nsec * 1e-3;
+}
+
+// the same limits the Windows client runs with, so a large history pages through the spill file as it does there
+void ApplyRetention(ChatClient& client) {
+    client.globalRetention.maxMessages = 20000;
+    client.globalRetention.maxBytes = 8 * 1024 * 1024;
+    client.dmRetention.maxMessages = 5000;
+    client.dmRetention.maxBytes = 2 * 1024 * 1024;
+    client.globalRetention.searchMessages = 500000;
+    client.dmRetention.searchMessages = 50000;
+    client.state.globalChat.SetRetention(client.globalRetention);
+}
+
+// a generated conversation, the same for every run: 200 users, sentences of 3 to 20 words and every tenth line ours
+const char* const kWords[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliet", "kilo", "lima",
+    "mike", "november", "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey",
+    "xray", "yankee", "zulu", "the", "a", "is", "and", "server", "message", "window", "frame", "later", "now",
+};
+const char* const kMe = "perf";
+const int kUsers = 200;
+
+std::string UserName(int i) {
+    return "user" + std::to_string(i);
+}
+
+void FillConversation(ChatClient& client, ChatHistory& history, const std::string& other, size_t count, uint32_t seed, MessageKind kind) {
+    int64_t timestamp = 1700000000000;
+    std::string body;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        int words = 3 + (int)((seed >> 8) % 18);
+        body.clear();
+        for (int w = 0; w < words; w++) {
+            seed = seed * 1664525u + 1013904223u;
+            if (w) {
+                body += ' ';
+            }
+            body += kWords[(seed >> 8) % (sizeof(kWords) / sizeof(kWords[0]))];
+        }
+        bool mine = i % 10 == 9;
+        std::string sender = mine ? std::string(kMe) : other.empty() ? UserName((int)(i % kUsers)) : other;
+        ChatMessage message;
+        message.timestamp = timestamp + (int64_t)i * 1000;
+        message.sender = client.state.names.Intern(sender);
+        message.kind = kind;
+        message.flags = mine ? MessageFromMe : 0;
+        std::string prefix = (mine && kind == MessageKind::Direct ? std::string("Me") : sender) + ": ";
+        history.Append(message, prefix, body);
+    }
+}
+
+// the state a logged in client would have after a long session: messages global chat lines, two DM conversations
+// of a tenth of that and the full user list
+void FillState(ChatClient& client, size_t messages) {
+    ApplyRetention(client);
+    for (int i = 0; i < kUsers; i++) {
+        client.state.userList.Add(UserName(i));
+    }
+    client.state.userList.Add(kMe);
+    FillConversation(client, client.state.globalChat, "", messages, 12345, MessageKind::Chat);
+    for (int i = 1; i <= 2; i++) {
+        ChatHistory& history = client.DirectHistory(UserName(i));
+        FillConversation(client, history, UserName(i), messages / 10, 777u * i, MessageKind::Direct);
+    }
+}
+
+// where ChatUi puts its widgets, derived from the fixed positions it gives its windows (see chatui/chat_ui.cpp),
+// the scenarios check through io.WantTextInput that a click landed in a text field
+struct Layout {
+    ImVec2 main;   // top left of the 800x600 main chat window
+    ImVec2 login;  // top left of the 300x140 login window
+
+    Layout(float width, float height)
+        : main(width * 0.35f - 400.0f, height * 0.5f - 300.0f), login(width * 0.5f - 150.0f, height * 0.5f - 70.0f) {}
+
+    ImVec2 SearchBox() const { return ImVec2(main.x + 800.0f - 8.0f - 110.0f, main.y + 36.0f); }
+    ImVec2 GlobalInput() const { return ImVec2(main.x + 400.0f, main.y + 600.0f - 18.0f); }
+    ImVec2 ChatArea() const { return ImVec2(main.x + 500.0f, main.y + 300.0f); }
+    ImVec2 UsernameBox() const { return ImVec2(login.x + 150.0f, login.y + 36.0f); }
+    ImVec2 ConnectButton() const { return ImVec2(login.x + 150.0f, login.y + 60.0f); }
+};
+
+// a scripted session, input runs before every frame and queues that frame's events
+struct Scenario {
+    const char* name;
+    bool loggedIn;   // starts in the chat instead of the login window
+    bool openDMs;    // with both DM windows open
+    std::function<void(int frame, ImGuiIO& io, const Layout& layout)> input;
+};
+
+void Click(ImGuiIO& io, int frame, int at, ImVec2 pos) {
+    if (frame == at) {
+        io.AddMousePosEvent(pos.x, pos.y);
+        io.AddMouseButtonEvent(0, true);
+    }
+    else if (frame == at + 1) {
+        io.AddMouseButtonEvent(0, false);
+    }
+}
+
+void Type(ImGuiIO& io, int frame, int from, const char* text) {
+    int i = frame - from;
+    if (i >= 0 && i < (int)strlen(text)) {
+        char c[2] = { text[i], '\0' };
+        io.AddInputCharactersUTF8(c);
+    }
+}
+
+void PressKey(ImGuiIO& io, int frame, int at, ImGuiKey key) {
+    if (frame == at) {
+        io.AddKeyEvent(key, true);
+    }
+    else if (frame == at + 1) {
+        io.AddKeyEvent(key, false);
+    }
+}
+
+std::vector<Scenario> MakeScenarios() {
+    std::vector<Scenario> scenarios;
+    // nothing happens, the cost of drawing the visible lines of a long history
+    scenarios.push_back({ "idle", true, false, [](int frame, ImGuiIO& io, const Layout&) {
+        if (frame == 0) {
+            io.AddMousePosEvent(-FLT_MAX, -FLT_MAX);
+        }
+    } });
+    // the wheel goes up for the first half and down for the second, past what is in memory for a large history
+    scenarios.push_back({ "scroll", true, false, [](int frame, ImGuiIO& io, const Layout& layout) {
+        if (frame == 0) {
+            io.AddMousePosEvent(layout.ChatArea().x, layout.ChatArea().y);
+        }
+        io.AddMouseWheelEvent(0.0f, frame % 200 < 100 ? 5.0f : -5.0f);
+    } });
+    // a query typed one key per frame, every key searches the global chat and both DMs again
+    scenarios.push_back({ "search", true, false, [](int frame, ImGuiIO& io, const Layout& layout) {
+        Click(io, frame, 0, layout.SearchBox());
+        Type(io, frame, 2, "delta echo foxtrot");
+    } });
+    // a message typed into the global chat input, then selected and deleted again
+    scenarios.push_back({ "typing", true, false, [](int frame, ImGuiIO& io, const Layout& layout) {
+        Click(io, frame, 0, layout.GlobalInput());
+        int cycle = frame < 2 ? -1 : (frame - 2) % 100;
+        Type(io, cycle, 0, "the quick brown fox jumps over the lazy dog and then over the server window again");
+        if (cycle == 90) {
+            io.AddKeyEvent(ImGuiMod_Ctrl, true);
+            io.AddKeyEvent(ImGuiKey_A, true);
+        }
+        else if (cycle == 91) {
+            io.AddKeyEvent(ImGuiKey_A, false);
+            io.AddKeyEvent(ImGuiMod_Ctrl, false);
+        }
+        PressKey(io, cycle, 92, ImGuiKey_Backspace);
+    } });
+    // both DM windows open over the main chat, the mouse moves over the user list
+    scenarios.push_back({ "dms", true, true, [](int frame, ImGuiIO& io, const Layout& layout) {
+        io.AddMousePosEvent(layout.main.x + 60.0f, layout.main.y + 50.0f + (float)(frame % 300));
+    } });
+    // the login window: a username typed and Connect pressed, the rest of the frames are the main chat or the error
+    scenarios.push_back({ "login", false, false, [](int frame, ImGuiIO& io, const Layout& layout) {
+        Click(io, frame, 0, layout.UsernameBox());
+        Type(io, frame, 2, kMe);
+        Click(io, frame, 8, layout.ConnectButton());
+    } });
+    return scenarios;
+}
+
+// the null renderer: it takes the textures ImGui asks for and counts what it would draw
+void RenderDrawData(ImDrawData* drawData, FrameSample& sample) {
+#if IMGUI_VERSION_NUM >= 19200
+    if (drawData->Textures) {
+        for (ImTextureData* texture : *drawData->Textures) {
+            if (texture->Status == ImTextureStatus_WantCreate || texture->Status == ImTextureStatus_WantUpdates) {
+                texture->SetTexID((ImTextureID)(intptr_t)(texture->UniqueID + 1));
+                texture->SetStatus(ImTextureStatus_OK);
+            }
+            else if (texture->Status == ImTextureStatus_WantDestroy) {
+                texture->SetTexID(ImTextureID_Invalid);
+                texture->SetStatus(ImTextureStatus_Destroyed);
+            }
+        }
+    }
+#endif
+    sample.vertices = drawData->TotalVtxCount;
+    sample.indices = drawData->TotalIdxCount;
+    for (int i = 0; i < drawData->CmdListsCount; i++) {
+        sample.drawCommands += drawData->CmdLists[i]->CmdBuffer.Size;
+    }
+}
+
+struct Result {
+    const char* scenario;
+    size_t messages;
+    double fillMs = 0.0;
+    FrameSample first;            // the first frame lays out the whole window of the history
+    std::vector<FrameSample> frames;
+    bool inputMissed = false;     // a scripted click did not give a text field the focus
+    bool loggedIn = false;
+};
+
+Result Run(const Scenario& scenario, size_t messages, const Options& opt) {
+    Result result;
+    result.scenario = scenario.name;
+    result.messages = messages;
+
+    ChatClient client;
+    auto fillStart = std::chrono::steady_clock::now();
+    FillState(client, messages);
+    result.fillMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fillStart).count();
+
+    ChatUi ui(client);
+    ui.host = opt.host;
+    ui.port = (uint16_t)(opt.port ? opt.port : 1); // nothing listens on port 1, the login fails right away
+    ui.connectTimeoutMs = 2000;
+    if (scenario.loggedIn) {
+        ui.ShowChat(kMe);
+    }
+    if (scenario.openDMs) {
+        client.state.openDMs.insert(UserName(1));
+        client.state.openDMs.insert(UserName(2));
+    }
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr; // no window positions from an earlier run
+    io.LogFilename = nullptr;
+    io.ConfigInputTextCursorBlink = false;
+    io.BackendPlatformName = "chat_null";
+    io.BackendRendererName = "chat_null";
+    io.DisplaySize = ImVec2(opt.width, opt.height);
+#if IMGUI_VERSION_NUM >= 19200
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+#else
+    unsigned char* pixels = nullptr;
+    int textureWidth = 0, textureHeight = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &textureWidth, &textureHeight);
+#endif
+    ImGui::StyleColorsDark();
+
+    Layout layout(opt.width, opt.height);
+    int textInputFrames = 0;
+    for (int frame = 0; frame <= opt.frames; frame++) {
+        io.DeltaTime = 1.0f / 60.0f;
+        scenario.input(frame, io, layout);
+
+        FrameSample sample;
+        uint64_t callsBefore = g_newCalls.load(std::memory_order_relaxed) + g_imguiCalls.load(std::memory_order_relaxed);
+        uint64_t bytesBefore = g_newBytes.load(std::memory_order_relaxed) + g_imguiBytes.load(std::memory_order_relaxed);
+        double cpuBefore = ThreadCpuUs();
+
+        ImGui::NewFrame();
+        client.PumpEvents();
+        ui.Draw();
+        ImGui::Render();
+        RenderDrawData(ImGui::GetDrawData(), sample);
+
+        sample.cpuUs = ThreadCpuUs() - cpuBefore;
+        sample.allocations = g_newCalls.load(std::memory_order_relaxed) + g_imguiCalls.load(std::memory_order_relaxed) - callsBefore;
+        sample.allocatedBytes = g_newBytes.load(std::memory_order_relaxed) + g_imguiBytes.load(std::memory_order_relaxed) - bytesBefore;
+        if (frame == 0) {
+            result.first = sample;
+        }
+        else {
+            result.frames.push_back(sample);
+        }
+        textInputFrames += io.WantTextInput ? 1 : 0;
+
+        // while the connection is made on its thread we give it real time, the frames stay on the fixed timestep
+        ConnectionState state = client.GetConnectionState();
+        if (state == ConnectionState::Resolving || state == ConnectionState::Connecting || state == ConnectionState::Handshaking) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    bool typesText = strcmp(scenario.name, "search") == 0 || strcmp(scenario.name, "typing") == 0 || strcmp(scenario.name, "login") == 0;
+    result.inputMissed = typesText && textInputFrames == 0;
+    result.loggedIn = ui.LoggedIn();
+
+    ImGui::DestroyContext();
+    client.Disconnect();
+    return result;
+}
+
+double Percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)(p / 100.0 * (double)(values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+void PrintResult(const Result& result, bool last) {
+    std::vector<double> cpu;
+    double vertices = 0.0, indices = 0.0, commands = 0.0, allocations = 0.0, bytes = 0.0;
+    for (const FrameSample& sample : result.frames) {
+        cpu.push_back(sample.cpuUs);
+        vertices += sample.vertices;
+        indices += sample.indices;
+        commands += sample.drawCommands;
+        allocations += (double)sample.allocations;
+        bytes += (double)sample.allocatedBytes;
+    }
+    double count = result.frames.empty() ? 1.0 : (double)result.frames.size();
+    double mean = 0.0;
+    for (double us : cpu) {
+        mean += us;
+    }
+    printf("    { \"scenario\": \"%s\", \"messages\": %zu, \"frames\": %zu, \"fill_ms\": %.1f, \"logged_in\": %s, \"input_missed\": %s,\n",
+        result.scenario, result.messages, result.frames.size(), result.fillMs, result.loggedIn ? "true" : "false", result.inputMissed ? "true" : "false");
+    printf("      \"first_frame\": { \"cpu_us\": %.1f, \"vertices\": %d, \"indices\": %d, \"allocations\": %llu },\n",
+        result.first.cpuUs, result.first.vertices, result.first.indices, (unsigned long long)result.first.allocations);
+    printf("      \"cpu_us\": { \"mean\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f },\n",
+        mean / count, Percentile(cpu, 50), Percentile(cpu, 99), Percentile(cpu, 100));
+    printf("      \"per_frame\": { \"vertices\": %.0f, \"indices\": %.0f, \"draw_commands\": %.1f, \"allocations\": %.1f, \"allocated_bytes\": %.0f } }%s\n",
+        vertices / count, indices / count, commands / count, allocations / count, bytes / count, last ? "" : ",");
+}
+
+void Usage(const char* exe) {
+    fprintf(stderr, "usage: %s [--messages n[,n...]] [--frames n] [--scenario idle|scroll|search|typing|dms|login]\n"
+        "          [--host ip] [--port port] [--size width,height]\n", exe);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--messages") {
+            opt.messages.clear();
+            for (const char* p = value; *p;) {
+                char* end = nullptr;
+                opt.messages.push_back((size_t)strtoull(p, &end, 10));
+                p = *end == ',' ? end + 1 : end;
+                if (end == p && *p) {
+                    break;
+                }
+            }
+        }
+        else if (arg == "--frames") opt.frames = atoi(value);
+        else if (arg == "--scenario") opt.scenario = value;
+        else if (arg == "--host") opt.host = value;
+        else if (arg == "--port") opt.port = atoi(value);
+        else if (arg == "--size") {
+            if (sscanf(value, "%f,%f", &opt.width, &opt.height) != 2) {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.frames < 1 || opt.messages.empty()) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    // counted from here on, before the first context exists
+    ImGui::SetAllocatorFunctions(CountedImGuiAlloc, CountedImGuiFree, nullptr);
+    NetStartup();
+
+    std::vector<Scenario> scenarios = MakeScenarios();
+    std::vector<Result> results;
+    for (const Scenario& scenario : scenarios) {
+        if (!opt.scenario.empty() && opt.scenario != scenario.name) {
+            continue;
+        }
+        for (size_t messages : opt.messages) {
+            results.push_back(Run(scenario, messages, opt));
+        }
+    }
+    if (results.empty()) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    bool missed = false;
+    printf("{\n");
+    printf("  \"imgui\": \"%s\",\n  \"display\": [%.0f, %.0f],\n  \"delta_time\": %.6f,\n", IMGUI_VERSION, opt.width, opt.height, 1.0 / 60.0);
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        PrintResult(results[i], i + 1 == results.size());
+        missed = missed || results[i].inputMissed;
+    }
+    printf("  ]\n}\n");
+
+    NetCleanup();
+    // a scripted click that missed its widget measured the wrong thing, a CI job should notice
+    return missed ? 2 : 0;
+}
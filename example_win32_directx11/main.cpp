@@ -1,7 +1,5 @@
 #define WIN32_LEAN_AND_MEAN
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <windows.h>
 #include <d3d11.h>
 #include <tchar.h>
@@ -13,37 +11,140 @@
 #include <set>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cwchar>
 #include <iostream>
 
 #include "imgui.h"
 #include "imgui_impl_win32.h"
 #include "imgui_impl_dx11.h"
 
-#include "GamesEngineeringBase.h"
+#include <xaudio2.h>
+
+#include "chat_audio.h"
+#include "chat_client.h"
+#include "chat_frame.h"
+#include "chat_mixer.h"
+#include "chat_notify.h"
+#include "chat_protocol.h"
+#include "chat_samples.h"
+#include "chat_ui.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
-#pragma comment(lib, "ws2_32.lib")
-
-// Global variables for socket communication, synchronization, and application state
-SOCKET g_socket = INVALID_SOCKET;
-std::mutex g_dataMutex;
-std::mutex g_soundMutex;
+#pragma comment(lib, "xaudio2.lib")
+
+// Global variables for the chat connection, synchronization, and application state
+// the client owns the socket, the receive thread and the shared chat state (see chatcore/chat_client.h)
+ChatClient g_client;
+
+// the frame loop only draws when something changed, the client's threads wake it through g_wake
+WakeSignal g_wake;
+FrameScheduler g_frames;
+CpuMeter g_cpu;
+
+// the login window, the main chat room and the DM windows, shared with the other front-ends (see chatui/chat_ui.h)
+ChatUi g_ui(g_client);
+
+// the notification sounds are mixed by a NotificationMixer (see chatcore/chat_mixer.h) into one stream that a single
+// XAudio2 source voice plays, so a sound is a queue push and never a source voice of its own
+// the worker only sees the mixer as an INotificationAudio (see chatcore/chat_audio.h), the Linux builds use the null
+// and capture sinks instead
+class XAudio2MixerOutput : public IXAudio2VoiceCallback {
+public:
+    static constexpr int BlockMs = 10;
+    static constexpr int Blocks = 3; // one playing, two queued behind it
+
+    explicit XAudio2MixerOutput(NotificationMixer& mixer) : m_mixer(mixer) {}
+    ~XAudio2MixerOutput() { Stop(); }
+
+    // false when there is no audio device, the sounds then stay silent
+    bool Start() {
+        const SampleFormat& format = m_mixer.Format();
+        if (FAILED(XAudio2Create(&m_xaudio, 0, XAUDIO2_DEFAULT_PROCESSOR)) ||
+            FAILED(m_xaudio->CreateMasteringVoice(&m_master))) {
+            Stop();
+            return false;
+        }
+        WAVEFORMATEX wave{};
+        wave.wFormatTag = WAVE_FORMAT_PCM;
+        wave.nChannels = format.channels;
+        wave.nSamplesPerSec = format.sampleRate;
+        wave.wBitsPerSample = 16;
+        wave.nBlockAlign = (WORD)(format.channels * sizeof(int16_t));
+        wave.nAvgBytesPerSec = wave.nSamplesPerSec * wave.nBlockAlign;
+        if (FAILED(m_xaudio->CreateSourceVoice(&m_source, &wave, 0, XAUDIO2_DEFAULT_FREQ_RATIO, this))) {
+            Stop();
+            return false;
+        }
+        m_frames = (size_t)format.sampleRate * BlockMs / 1000;
+        for (std::vector<int16_t>& block : m_blocks) {
+            block.resize(m_frames * format.channels);
+        }
+        for (size_t b = 0; b < Blocks; b++) {
+            Submit(b);
+        }
+        m_source->Start(0);
+        return true;
+    }
 
-std::vector<std::string> g_globalChat;
-std::vector<std::string> g_userList;
-std::map<std::string, std::vector<std::string>> g_dmHistory;
-std::set<std::string> g_openDMs;
+    void Stop() {
+        // DestroyVoice() waits for a callback that is running, none comes after it
+        if (m_source) {
+            m_source->DestroyVoice();
+            m_source = nullptr;
+        }
+        if (m_master) {
+            m_master->DestroyVoice();
+            m_master = nullptr;
+        }
+        if (m_xaudio) {
+            m_xaudio->Release();
+            m_xaudio = nullptr;
+        }
+    }
 
-// we track the login state and username in global variables for simplicity
-bool g_loggedIn = false;
-char g_usernameBuffer[64] = "";
-char g_globalInputBuffer[256] = "";
-std::string g_myUsername; // i made a login system for username selection and we store the username
-// in a global variable for easy access across the application also we fill a buffer for the login input and a buffer for the global chat input
+    // XAudio2's own thread: the block that finished playing is mixed again and queued behind the others
+    void STDMETHODCALLTYPE OnBufferEnd(void* context) override { Submit((size_t)context); }
+
+    void STDMETHODCALLTYPE OnVoiceProcessingPassStart(UINT32) override {}
+    void STDMETHODCALLTYPE OnVoiceProcessingPassEnd() override {}
+    void STDMETHODCALLTYPE OnStreamEnd() override {}
+    void STDMETHODCALLTYPE OnBufferStart(void*) override {}
+    void STDMETHODCALLTYPE OnLoopEnd(void*) override {}
+    void STDMETHODCALLTYPE OnVoiceError(void*, HRESULT) override {}
+
+private:
+    void Submit(size_t b) {
+        std::vector<int16_t>& block = m_blocks[b];
+        m_mixer.Render(block.data(), m_frames);
+        XAUDIO2_BUFFER buffer{};
+        buffer.AudioBytes = (UINT32)(block.size() * sizeof(int16_t));
+        buffer.pAudioData = (const BYTE*)block.data();
+        buffer.pContext = (void*)b;
+        m_source->SubmitSourceBuffer(&buffer);
+    }
 
-// this is the sound manager from the GamesEngineeringBase library we use it to play notification sounds for incoming messages and DMs
-GamesEngineeringBase::SoundManager* g_audio = nullptr;
+    NotificationMixer& m_mixer;
+    IXAudio2* m_xaudio = nullptr;
+    IXAudio2MasteringVoice* m_master = nullptr;
+    IXAudio2SourceVoice* m_source = nullptr;
+    size_t m_frames = 0;
+    std::vector<int16_t> m_blocks[Blocks];
+};
+NotificationMixer* g_mixer = nullptr;
+XAudio2MixerOutput* g_audioOutput = nullptr;
+// the sounds are mapped, checked and converted on the cache's own thread while the window and the device come up
+SampleCache g_samples;
+// the startup phases, printed once the first frame is on screen
+StartupTrace g_startup;
+// every sound is played on the notification worker's thread, the receive thread and the UI only queue a sound id
+// so neither of them ever waits for the mixer
+NotificationWorker g_notifications;
+// a busy chat would queue a sound for every line, the policy lets one through per conversation and window
+// (see chatcore/chat_notify.h), only the receive thread asks it, the UI thread notes its sends for it
+NotificationPolicy g_notificationPolicy;
 
 // Global variables for Direct3D 11 device and rendering
 static ID3D11Device* g_pd3dDevice = nullptr;
@@ -60,194 +161,163 @@ void CreateRenderTarget();
 void CleanupRenderTarget();
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-// i needed a helper function to trim whitespace from incoming messages to avoid processing empty or whitespace-only messages which could cause issues with the chat display and notification system
-std::string trim(const std::string& str) {
-    if (str.empty()) {
-        return "";
-    }
-    size_t first = str.find_first_not_of(" \t\r\n\0");
-    if (std::string::npos == first) {
-        return "";
-    }
-    size_t last = str.find_last_not_of(" \t\r\n\0");
-    return str.substr(first, (last - first + 1));
-}
-
-// this is the main loop that receives messages from the server asynchronously
-// in a separate thread to avoid blocking the main UI thread
-void ReceiveLoop() {
-    // we initialize COM because the audio library uses XAudio2 internally
+int main(int, char**) {
     CoInitializeEx(NULL, COINIT_MULTITHREADED);
 
-    // we use a buffer to receive data from the socket
-    char buffer[4096];
-    std::string accumulatedData = "";
-
-    // this loop runs until the server disconnects or an error occurs
-    while (true) {
-        // we clear the buffer before each receive to avoid leftover data
-        memset(buffer, 0, sizeof(buffer));
-
-        // we receive raw data from the socket
-        int bytes = recv(g_socket, buffer, sizeof(buffer) - 1, 0);
-        if (bytes <= 0) {
-            // connection closed or error occurred
-            break;
+    // we load the sounds in the background instead of before the window: message.wav for the global chat, dm.wav for
+    // a DM from another user and send.wav as local feedback for our own sends
+    // the mixer plays the cache's samples in place and its output voice is made on the cache's thread as well, the
+    // main thread keeps the process in the multithreaded apartment, so what XAudio2 made there outlives that thread's
+    // CoUninitialize()
+    g_samples.LoadAsync("", [](const SampleCache& samples) {
+        StartupTrace::Scope phase(g_startup, "audio device");
+        g_mixer = new NotificationMixer(samples.Format());
+        for (NotificationSound sound : { NotificationSound::Message, NotificationSound::DirectMessage, NotificationSound::Send }) {
+            g_mixer->LoadCached(sound, samples);
         }
+        // the global chat is the busiest and the least urgent, it plays quieter than the DMs
+        g_mixer->SetVolume(NotificationSound::Message, 0.6f);
+        CoInitializeEx(NULL, COINIT_MULTITHREADED);
+        g_audioOutput = new XAudio2MixerOutput(*g_mixer);
+        g_audioOutput->Start();
+        CoUninitialize();
+    });
 
-        // we accumulate received data to handle split TCP packets
-        accumulatedData += std::string(buffer, bytes);
-
-        size_t pos = 0;
-        // we process messages line by line using newline as a delimiter
-        while ((pos = accumulatedData.find('\n')) != std::string::npos) {
-            std::string incomingMsg = accumulatedData.substr(0, pos);
-            accumulatedData.erase(0, pos + 1);
-
-            // we trim whitespace and ignore empty messages
-            incomingMsg = trim(incomingMsg);
-            if (incomingMsg.empty()) {
-                continue;
-            }
-            // we parse incoming messages based on a simple text protocol
-            if (incomingMsg.rfind("USERS|", 0) == 0) {
-                // we received an updated user list from the server
-                std::lock_guard<std::mutex> lock(g_dataMutex);
-                g_userList.clear();
-
-                // we split the user list by commas and trim each username before adding it to the list
-                std::string content = incomingMsg.substr(6);
-                size_t p = 0;
-                while ((p = content.find(',')) != std::string::npos) {
-                    std::string u = content.substr(0, p);
-                    if (!trim(u).empty())
-                        g_userList.push_back(trim(u));
-                    content.erase(0, p + 1);
-                }
-                // we add the last username after the final comma if it's not empty
-                if (!trim(content).empty()) {
-                    g_userList.push_back(trim(content));
-                }     
-            }
-            else if (incomingMsg.rfind("DM|", 0) == 0) {
-                // we handle private messages separately from the global chat
-                size_t p1 = incomingMsg.find('|');
-                size_t p2 = incomingMsg.find('|', p1 + 1);
-
-                if (p2 != std::string::npos) {
-                    std::string sender = trim(incomingMsg.substr(p1 + 1, p2 - (p1 + 1)));
-                    std::string content = incomingMsg.substr(p2 + 1);
-                    {
-                        // we update private message history in a thread-safe manner
-                        std::lock_guard<std::mutex> lock(g_dataMutex);
-                        g_dmHistory[sender].push_back(sender + ": " + content);
-                        g_openDMs.insert(sender);
-                    }
-                    // we play a dm notification sound only for messages sent by other users
-                    if (_stricmp(sender.c_str(), g_myUsername.c_str()) != 0) {
-                        std::lock_guard<std::mutex> soundLock(g_soundMutex);
-                        if (g_audio)
-                            g_audio->play("dm.wav");
-                    }
-                }
-            }
-            else if (incomingMsg.rfind("SYS|", 0) == 0) {
-                // we treat system messages as informational and non-interactive
-                // system messages do not trigger audio notifications
-                std::string sysText = trim(incomingMsg.substr(4));
-                if (!sysText.empty()) {
-                    std::lock_guard<std::mutex> lock(g_dataMutex);
-                    g_globalChat.push_back("[System] " + sysText);
-                }
-                continue;
-            }
-            else {
-                // we process regular global chat messages
-                std::string cleanMsg = trim(incomingMsg);
-                if (cleanMsg.empty() || cleanMsg.size() <= 2) {
-                    continue;
-                }
-                // we ignore messages sent by ourselves to avoid duplicate local feedback
-                std::string myPrefix = g_myUsername + ":";
-                if (cleanMsg.find(myPrefix) == 0) {
-                    continue;
-                }
-                else {
-                    // we update the global chat history in a thread-safe manner
-                    std::lock_guard<std::mutex> lock(g_dataMutex);
-                    g_globalChat.push_back(cleanMsg);
-                }
-                // we play a notification sound only for messages received from other users
-                std::lock_guard<std::mutex> soundLock(g_soundMutex);
-                if (g_audio) {
-                    g_audio->play("message.wav");
-                }                
-            }
-        }
+    // we set up the window class and create the application window using the Win32 API
+    WNDCLASSEXW wc;
+    HWND hwnd;
+    {
+        StartupTrace::Scope phase(g_startup, "window");
+        ImGui_ImplWin32_EnableDpiAwareness();
+        wc = { sizeof(wc), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(nullptr), nullptr, nullptr, nullptr, nullptr, L"ChatClient", nullptr };
+        ::RegisterClassExW(&wc);
+
+        hwnd = ::CreateWindowW(wc.lpszClassName, L"Chat Client",
+            WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX,
+            100, 100, 1280, 800, nullptr, nullptr, wc.hInstance, nullptr);
     }
 
-    // we uninitialize COM when the receive loop exits
-    CoUninitialize();
-}
-
-
-int main(int, char**) {
-    CoInitializeEx(NULL, COINIT_MULTITHREADED);
-
-    // we initialise the audio system and preload all sound assets at startup
-    // the provided audio library manages its own internal source voices
-    // so sounds are only triggered explicitly during playback
-    g_audio = new GamesEngineeringBase::SoundManager();
-    g_audio->load("message.wav"); // this is the sound that plays when a new message is received in the global chat
-    g_audio->load("dm.wav"); // this is the sound that plays when a new direct message is received from another user
-    g_audio->load("send.wav"); // this is the sound that plays when we send a message to provide local feedback
-
-    // we set up the window class and create the application window using the Win32 API
-    ImGui_ImplWin32_EnableDpiAwareness();
-    WNDCLASSEXW wc = { sizeof(wc), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(nullptr), nullptr, nullptr, nullptr, nullptr, L"ChatClient", nullptr };
-    ::RegisterClassExW(&wc);
-
-    HWND hwnd = ::CreateWindowW(wc.lpszClassName, L"Chat Client",
-        WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX,
-        100, 100, 1280, 800, nullptr, nullptr, wc.hInstance, nullptr);
-
-    if (!CreateDeviceD3D(hwnd)) { // if Direct3D initialization fails, we clean up and exit the application
-        CleanupDeviceD3D();
-        ::UnregisterClassW(wc.lpszClassName, wc.hInstance);
-        return 1;
+    {
+        StartupTrace::Scope phase(g_startup, "device");
+        if (!CreateDeviceD3D(hwnd)) { // if Direct3D initialization fails, we clean up and exit the application
+            CleanupDeviceD3D();
+            ::UnregisterClassW(wc.lpszClassName, wc.hInstance);
+            g_samples.Wait();
+            delete g_audioOutput;
+            delete g_mixer;
+            return 1;
+        }
     }
 
     // we show the window and update it to trigger the initial paint message which will set up our Direct3D render target
     ::ShowWindow(hwnd, SW_SHOWDEFAULT);
     ::UpdateWindow(hwnd);
 
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGui::StyleColorsDark();
-    ImGui_ImplWin32_Init(hwnd);
-    ImGui_ImplDX11_Init(g_pd3dDevice, g_pd3dDeviceContext);
+    {
+        StartupTrace::Scope phase(g_startup, "imgui");
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        // a blinking text cursor would need a frame twice a second whenever a text field has focus, which is most of the time
+        ImGui::GetIO().ConfigInputTextCursorBlink = false;
+        ImGui::StyleColorsDark();
+        ImGui_ImplWin32_Init(hwnd);
+        ImGui_ImplDX11_Init(g_pd3dDevice, g_pd3dDeviceContext);
+    }
+    {
+        // the font atlas is built and uploaded here rather than inside the first frame, so it has a line of its own in
+        // the trace (ImGui 1.92 and later bake the glyphs a frame needs while drawing it, they count to the first frame)
+        StartupTrace::Scope phase(g_startup, "fonts");
+#if IMGUI_VERSION_NUM < 19200
+        ImGui_ImplDX11_CreateDeviceObjects();
+#endif
+    }
+
+    NetStartup();
 
-    WSADATA wsa;
-    WSAStartup(MAKEWORD(2, 2), &wsa);
+    // the receive thread calls this for every message from another user, it only queues the matching sound if the policy lets it through
+    g_client.onNotification = [](ChatNotification notification, std::string_view peer) {
+        NotificationSound sound = notification == ChatNotification::DirectMessage ? NotificationSound::DirectMessage : NotificationSound::Message;
+        if (g_notificationPolicy.Allow(sound, peer, NotificationPolicy::Clock::now())) {
+            g_notifications.Post(sound);
+        }
+    };
+    g_client.onUpdate = [] { g_wake.Notify(); };
+    // we play a send sound whenever we send a global message or a DM, giving the user an audible confirmation that it went out
+    // the sound plays right away and the send takes one of the policy's voices the next time the receive thread asks it
+    g_ui.onSend = [] {
+        g_notifications.Post(NotificationSound::Send);
+        g_notificationPolicy.NoteSend(NotificationPolicy::Clock::now());
+    };
+    g_ui.frames = &g_frames;
+    // the client may run for weeks on an always-on machine, so only the newest part of every conversation is kept in memory
+    // and older messages are spilled to a temp file and paged back in when the user scrolls up
+    g_client.globalRetention.maxMessages = 20000;
+    g_client.globalRetention.maxBytes = 8 * 1024 * 1024;
+    g_client.dmRetention.maxMessages = 5000;
+    g_client.dmRetention.maxBytes = 2 * 1024 * 1024;
+    // search reaches the newest 500000 global and 50000 messages per DM, which holds its index to about 12 MiB
+    g_client.globalRetention.searchMessages = 500000;
+    g_client.dmRetention.searchMessages = 50000;
+    // the log on disk is held to 256 MiB, the oldest 16 MiB segment goes when a new one would not fit
+    g_client.logRetention.maxBytes = 256ull * 1024 * 1024;
+    // the log in the working directory keeps the conversations across restarts, the newest messages are back
+    // before we even connect, a client that cannot open it simply runs without one
+    g_client.OpenLog("chatlog", g_client.globalRetention.maxMessages);
 
     // this is the main application loop that handles window messages, rendering, and user input
+    // it sleeps until there is something to draw: window input, a wake-up from the client's threads or an animation frame,
+    // so an idle client draws nothing at all, once a second it wakes up to put its CPU use and frame rate in the title bar
+    auto nextReport = FrameScheduler::Clock::now() + std::chrono::seconds(1);
+    uint64_t reportedFrames = 0;
     bool done = false;
+    bool firstFrame = true;
+    auto firstFrameBegan = StartupTrace::Clock::now();
     while (!done) {
+        auto now = FrameScheduler::Clock::now();
+        int timeout = g_frames.TimeoutMs(now);
+        int untilReport = nextReport > now ? (int)std::chrono::ceil<std::chrono::milliseconds>(nextReport - now).count() : 0;
+        if (timeout < 0 || timeout > untilReport) {
+            timeout = untilReport;
+        }
+        if (timeout > 0) {
+            // MWMO_INPUTAVAILABLE makes the wait return for input that is already queued, not only for input that arrives later
+            HANDLE wake = g_wake.Handle();
+            ::MsgWaitForMultipleObjectsEx(1, &wake, (DWORD)timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        }
+
         // we process all pending window messages using PeekMessage to avoid blocking the main thread and allow for smooth rendering and input handling
         MSG msg;
         while (::PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE)) { // we use PeekMessage in a loop to process all messages in the queue before rendering the next frame
             ::TranslateMessage(&msg);
             ::DispatchMessage(&msg);
             if (msg.message == WM_QUIT) done = true;
+            g_frames.RequestFrames();
         }
         // if the application is marked as done which means that when the user closes the window we close everything down and exit the main loop
         if (done) {
             break;
         }
+        // new chat events or a connection state change, PumpEvents() below picks them up
+        if (g_wake.Consume()) {
+            g_frames.RequestFrames(FrameScheduler::DataFrames);
+        }
+
+        now = FrameScheduler::Clock::now();
+        if (now >= nextReport) {
+            wchar_t title[128];
+            swprintf(title, 128, L"Chat Client - %.1f%% CPU, %llu frames/s", g_cpu.Sample() * 100.0, (unsigned long long)(g_frames.FramesDrawn() - reportedFrames));
+            ::SetWindowTextW(hwnd, title);
+            reportedFrames = g_frames.FramesDrawn();
+            nextReport = now + std::chrono::seconds(1);
+        }
+        if (!g_frames.BeginFrame(now)) {
+            continue;
+        }
 
         // if the window is minimized or occluded, we skip rendering to save resources and avoid unnecessary GPU work
+        // and look again a little later, restoring the window also sends us messages that bring the frames back
         if (g_SwapChainOccluded && g_pSwapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED) {
-            ::Sleep(10);
+            g_frames.RequestFrameAt(now + std::chrono::milliseconds(100));
             continue;
         }
         g_SwapChainOccluded = false;
@@ -265,193 +335,12 @@ int main(int, char**) {
         ImGui_ImplWin32_NewFrame();
         ImGui::NewFrame();
 
-        // we get the ImGui IO object to access display size as I want make the login window and main chat window specifically positioned on the window
-        ImGuiIO& io = ImGui::GetIO();
-
-        if (!g_loggedIn) { // if the user is nopt logged in we start
-            // we set the next window position to be centered on the screen and set a fixed size for the login window
-            ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
-            ImGui::SetNextWindowSize(ImVec2(300, 120));
-            // we create the login window with no title bar, no resizing, no moving, and no collapsing to keep it simple and focused on the login process
-            ImGui::Begin("Login", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar);
-
-            ImGui::Text("Enter Username:"); // we want the user to enter a username for the chat session
-            ImGui::InputText("##username", g_usernameBuffer, IM_ARRAYSIZE(g_usernameBuffer)); // we use a hidden label for the input text to keep the UI clean and simple
-
-            if (ImGui::Button("Connect", ImVec2(-1, 0))) { // when the user clicks the Connect button, we attempt to connect to the chat server using the provided username
-                if (strlen(g_usernameBuffer) > 0) { // we check if the username is not empty before attempting to connect to avoid sending invalid data to the server
-                    g_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-                    sockaddr_in server{};
-                    server.sin_family = AF_INET;
-                    server.sin_port = htons(65432); // this is the servers port 
-                    inet_pton(AF_INET, "127.0.0.1", &server.sin_addr); // this is the localhost
-
-                    if (connect(g_socket, (sockaddr*)&server, sizeof(server)) != SOCKET_ERROR) { // if the connection is successful, we send the username to the server to join the chat and start the receive loop in a separate thread to listen for incoming messages
-                        std::string joinMsg = std::string(g_usernameBuffer);
-                        send(g_socket, joinMsg.c_str(), (int)joinMsg.size(), 0);
-
-                        g_myUsername = trim(std::string(g_usernameBuffer));
-                        g_loggedIn = true;
-                        std::thread(ReceiveLoop).detach();
-                    }
-                }
-            }
-            ImGui::End(); // we end the login window and move on to rendering the main chat interface if the user is logged in
-        }
-        else { // if the user is logged in, we render the main chat interface which consists of a user list on the left and the global chat on the right with an input field at the bottom
-            ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x * 0.35f, io.DisplaySize.y * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
-            ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_Always); //we set the window size to be 800x600 and position it
-
-            // we create the main chat window with no resizing, no moving, and no collapsing to keep it simple
-            ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoBringToFrontOnFocus;;
-            ImGui::Begin("Chat Client - Main Chat Room", nullptr, window_flags);
-
-            // we use ImGui columns to create a two-column layout for the user list and global chat, setting a fixed width for the user list column
-            ImGui::Columns(2, "ChatColumns", true);
-            ImGui::SetColumnWidth(0, 200);
-
-            // we render the user list in the left column, allowing the user to select a username to open a direct message window with that user
-            ImGui::Text("Users");
-            ImGui::Separator(); {
-                std::lock_guard<std::mutex> lock(g_dataMutex); // we lock the mutex to safely access the shared user list and render it in the UI
-                for (const auto& user : g_userList) {
-                    if (trim(user) == g_myUsername) { // we skip rendering our own username in the user list to avoid confusion and prevent opening a DM with ourselves
-                        continue;
-                    }
-                    if (ImGui::Selectable(user.c_str())) {
-                        g_openDMs.insert(user); 
-                    }
-                }
-            }
-
-            // we move to the next column to render the global chat interface
-            ImGui::NextColumn();
-
-            // we render the global chat messages in a scrollable child window, applying different text colors for messages sent by ourselves to provide visual feedback and distinguish them from messages sent by other users
-            ImGui::Text("Global Chat");
-            ImGui::Separator();
-            ImGui::BeginChild("ScrollingRegion", ImVec2(0, -40), false, ImGuiWindowFlags_HorizontalScrollbar);
-            {
-                std::lock_guard<std::mutex> lock(g_dataMutex); // we lock the mutex to safely access the shared global chat history and render it in the UI
-                for (const auto& msg : g_globalChat) { // we check if the message starts with our username followed by a colon to determine
-                    //if it was sent by us and apply a different text color for our messages to provide visual feedback in the chat interface
-                    std::string myPrefix = g_myUsername + ":";
-                    if (msg.find(myPrefix) == 0 || msg.find(g_myUsername + " :") == 0) {
-                        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 1.0f, 0.4f, 1.0f));
-                        ImGui::TextWrapped("%s", msg.c_str());
-                        ImGui::PopStyleColor();
-                    }
-                    else {
-                        ImGui::TextWrapped("%s", msg.c_str());
-                    }
-                }
-                if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY()) { // we check if the user has scrolled to the bottom of the chat and if so,
-                    //we automatically scroll to the latest message when new messages arrive to keep the user updated with the most recent activity in the chat
-                    ImGui::SetScrollHereY(1.0f);
-                }
-            }
-            ImGui::EndChild();
-
-            // we render the input field for sending messages to the global chat, allowing the user to type a message and send it by clicking the Send button or pressing Enter
-            ImGui::Separator();
-            ImGui::PushItemWidth(-60);
-            ImGui::InputText("##GlobalInput", g_globalInputBuffer, IM_ARRAYSIZE(g_globalInputBuffer));
-            ImGui::PopItemWidth();
-            ImGui::SameLine();
-
-            if (ImGui::Button("Send", ImVec2(50, 0))) { // when the user clicks the Send button, we check if the input buffer is not empty and then send the message to the server, adding a newline character as a message delimiter
-                if (strlen(g_globalInputBuffer) > 0) {
-                    std::string rawMsg = std::string(g_globalInputBuffer);
-                    std::string msgToSend = rawMsg + "\n"; //
-                    send(g_socket, msgToSend.c_str(), (int)msgToSend.size(), 0); {
-                        std::lock_guard<std::mutex> lock(g_dataMutex);
-                        g_globalChat.push_back(g_myUsername + ": " + rawMsg); 
-                    }
-                    // we play a send sound to provide local feedback when we send a message to the global chat, giving the user an audible confirmation that their message was sent successfully
-                    std::lock_guard<std::mutex> soundLock(g_soundMutex);
-                    if (g_audio) {
-                        // we play the send sound for messages sent to the global chat
-                        g_audio->play("send.wav");
-                    }
-                    g_globalInputBuffer[0] = '\0';
-                }
-            }
-            ImGui::End();
-
-            std::vector<std::string> dmsToClose;
-            // we render open direct message windows for each user in the g_openDMs set, allowing the user to have multiple private conversations simultaneously and manage them through the UI
-            for (const auto& targetUser : g_openDMs) {
-                // we create a separate window for each open DM with a title indicating the target user
-                bool open = true;
-                // we make the window title dynamic based on the target user to provide context for the conversation and set a default size for the DM windows
-                std::string windowTitle = "Private Chat with " + targetUser;
-                // we create a smaller window for DMs and it's movable and resizable
-                ImGui::SetNextWindowSize(ImVec2(400, 300), ImGuiCond_FirstUseEver);
-
-                if (ImGui::Begin(windowTitle.c_str(), &open)) {
-                    ImGui::BeginChild("DMMessages", ImVec2(0, -40));
-                    {
-                        // same message sending process for DMs
-                        std::lock_guard<std::mutex> lock(g_dataMutex);
-                        for (const auto& msg : g_dmHistory[targetUser]) {
-                            // we check if the message starts with "Me:" to determine if it was sent by us and apply a different text color for our messages in the DM window to provide visual feedback and distinguish them from messages sent by the other user
-                            if (msg.rfind("Me:", 0) == 0) {
-                                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 1.0f, 0.4f, 1.0f));
-                                ImGui::TextWrapped("%s", msg.c_str());
-                                ImGui::PopStyleColor();
-                            }
-                            else { // this means the message was sent by the other user so we render it with the default text color to visually differentiate it from our messages in the DM conversation
-                                ImGui::TextWrapped("%s", msg.c_str());
-                            }
-                        }
-                        if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY()) {
-                            ImGui::SetScrollHereY(1.0f);
-                        }
-                    }
-                    ImGui::EndChild();
-
-                    // we render the input field for sending messages in the DM window, allowing the user to type a private message and send it to the target user by clicking the Send button or pressing Enter
-                    ImGui::PushID(targetUser.c_str());
-                    static char dmInput[256] = "";
-                    ImGui::PushItemWidth(-60);
-                    ImGui::InputText("##DMInput", dmInput, IM_ARRAYSIZE(dmInput));
-                    ImGui::PopItemWidth();
-                    ImGui::SameLine();
-
-                    // when the user clicks the Send button in the DM window, we check if the input buffer is not empty and then send a DM message to the server in the format "DM|targetUser|message\n" to indicate that it's a direct message to the specified target user
-                    if (ImGui::Button("Send")) {
-                        if (strlen(dmInput) > 0) {
-                            // we construct the DM message with the appropriate format and send it to the server, then we update the local DM history for the target user to include the sent message with a "Me:" prefix for visual feedback in the DM conversation
-                            std::string packet = "DM|" + targetUser + "|" + std::string(dmInput) + "\n";
-                            send(g_socket, packet.c_str(), (int)packet.size(), 0);
-                            {
-                                std::lock_guard<std::mutex> lock(g_dataMutex);
-                                g_dmHistory[targetUser].push_back("Me: " + std::string(dmInput));
-                            }
-                            dmInput[0] = '\0';
-
-                            std::lock_guard<std::mutex> soundLock(g_soundMutex);
-                            // for DMs we play the same send sound
-                            if (g_audio) {
-                                g_audio->play("send.wav");
-                            }
-
-                        }
-                    }
-                    ImGui::PopID();
-                }
-                ImGui::End();
-                // if the user closes the DM window by clicking the close button, we mark it for removal from the g_openDMs set to stop rendering it and free up resources associated with that DM conversation
-                if (!open) {
-                    dmsToClose.push_back(targetUser);
-                }
-            }
+        // we take everything the receive thread queued since the last frame, after this the chat state
+        // belongs to us for the whole frame and nothing below has to lock anything
+        g_client.PumpEvents();
 
-            for (const auto& user : dmsToClose) {
-                // we remove the closed DM from the g_openDMs set to stop rendering it and clean up the DM history for that user if needed
-                g_openDMs.erase(user);
-            }
-        }
+        // the login window until we are connected, then the main chat room and the DM windows
+        g_ui.Draw();
 
         ImGui::Render();
         const float clear_color[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
@@ -459,6 +348,23 @@ int main(int, char**) {
         g_pd3dDeviceContext->ClearRenderTargetView(g_mainRenderTargetView, clear_color);
         ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
         g_pSwapChain->Present(1, 0);
+
+        // the window is up, only now do we wait for the sounds if they are not loaded yet, no sound can be due before
+        // the user has logged in and the ones posted meanwhile wait in the worker's queue
+        if (firstFrame) {
+            firstFrame = false;
+            g_startup.Record("first frame", firstFrameBegan, StartupTrace::Clock::now());
+            {
+                StartupTrace::Scope phase(g_startup, "audio wait");
+                g_samples.Wait();
+            }
+            g_startup.Record("audio files", g_samples.LoadBegan(), g_samples.LoadEnded());
+            // from here on the notification worker's thread queues the sounds on g_mixer and XAudio2's thread renders it
+            g_notifications.Start(*g_mixer);
+            std::string report = "startup trace, ms since the process started\n" + g_startup.Report();
+            printf("%s", report.c_str());
+            ::OutputDebugStringA(report.c_str());
+        }
     }
 
     // we clean up ImGui resources, Direct3D resources, and socket resources before exiting the application to ensure a graceful shutdown and free up system resources
@@ -468,13 +374,15 @@ int main(int, char**) {
     CleanupDeviceD3D();
     ::DestroyWindow(hwnd);
     ::UnregisterClassW(wc.lpszClassName, wc.hInstance);
-    closesocket(g_socket);
-    WSACleanup();
-
-    // we clean up the audio system by deleting the sound manager instance which will release all loaded sounds and XAudio2 resources, ensuring that we free up memory and properly shut down the audio subsystem when the application exits
-    if (g_audio) {
-        delete g_audio;
-    }
+    g_client.Disconnect();
+    NetCleanup();
+    g_notifications.Stop();
+    // a window closed before its first frame leaves the sounds loading
+    g_samples.Wait();
+
+    // we stop the output voice before the mixer it renders goes away, that releases XAudio2 as well
+    delete g_audioOutput;
+    delete g_mixer;
     CoUninitialize();
 
     return 0;